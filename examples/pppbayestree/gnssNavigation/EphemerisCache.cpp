@@ -0,0 +1,329 @@
+/**
+ *  @file   EphemerisCache.cpp
+ *  @brief  Implementation file for the Chebyshev table of satellite positions and clocks
+ **/
+
+#include "EphemerisCache.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+using namespace gpstk;
+
+namespace minisam
+{
+
+EphemerisCache::EphemerisCache(const XvtStore<SatID>& source, double arcLength, int degree,
+                               double posTolerance, double clockTolerance)
+    : source_(&source), arcLength_(arcLength), degree_(degree), posTolerance_(posTolerance),
+      clockTolerance_(clockTolerance), span_(0.0), arcs_(0), maxPosResidual_(0.0), maxClockResidual_(0.0)
+{
+    if (!(arcLength > 0.0))
+    {
+        throw std::invalid_argument("EphemerisCache: arc length must be positive");
+    }
+    if (degree < 1 || degree > maxDegree)
+    {
+        throw std::invalid_argument("EphemerisCache: degree must be in [1, 31]");
+    }
+}
+
+void EphemerisCache::build()
+{
+    std::vector<SatID> sats;
+    for (int prn = 1; prn <= 32; prn++)
+    {
+        SatID sat(prn, SatID::systemGPS);
+        if (source_->isPresent(sat))
+            sats.push_back(sat);
+    }
+    build(sats, source_->getInitialTime(), source_->getFinalTime());
+}
+
+void EphemerisCache::build(const std::vector<SatID>& sats, const CommonTime& tmin, const CommonTime& tmax)
+{
+    clear();
+    const double span = tmax - tmin;
+    if (!(span > 0.0) || sats.empty())
+        return;
+
+    sats_ = sats;
+    for (size_t s = 0; s < sats.size(); s++)
+    {
+        satIndex_[sats[s]] = (int)s;
+    }
+    tmin_ = tmin;
+    span_ = span;
+    arcs_ = (size_t)ceil(span / arcLength_);
+
+    const int n = degree_ + 1;
+    const size_t stride = 4 * n;
+    coef_.assign(arcs_ * sats.size() * stride, 0.0);
+    fitted_.assign(arcs_ * sats.size(), 0);
+
+    // fit at the roots of T_n, check at its extrema, where the error of the fit peaks
+    std::vector<double> nodes(n), checks(n + 1), Tn(n * n), Tc((n + 1) * n), dT(n);
+    for (int j = 0; j < n; j++)
+    {
+        nodes[j] = cos(M_PI * (j + 0.5) / n);
+    }
+    for (int j = 0; j <= n; j++)
+    {
+        checks[j] = cos(M_PI * j / n);
+    }
+    for (int j = 0; j < n; j++)
+    {
+        double* T = &Tn[j * n];
+        T[0] = 1.0;
+        if (n > 1)
+            T[1] = nodes[j];
+        for (int k = 2; k < n; k++)
+            T[k] = 2.0 * nodes[j] * T[k - 1] - T[k - 2];
+    }
+    for (int j = 0; j <= n; j++)
+    {
+        double* T = &Tc[j * n];
+        T[0] = 1.0;
+        if (n > 1)
+            T[1] = checks[j];
+        for (int k = 2; k < n; k++)
+            T[k] = 2.0 * checks[j] * T[k - 1] - T[k - 2];
+    }
+    std::fill(dT.begin(), dT.end(), 0.0);
+
+    std::vector<double> f(4 * n);
+    for (size_t a = 0; a < arcs_; a++)
+    {
+        double start, length;
+        arcBounds(a, &start, &length);
+        for (size_t s = 0; s < sats.size(); s++)
+        {
+            double* c = &coef_[(a * sats.size() + s) * stride];
+            try
+            {
+                for (int j = 0; j < n; j++)
+                {
+                    Xvt xvt = source_->getXvt(sats[s], tmin + (start + 0.5 * (nodes[j] + 1.0) * length));
+                    f[j] = xvt.x[0];
+                    f[n + j] = xvt.x[1];
+                    f[2 * n + j] = xvt.x[2];
+                    f[3 * n + j] = xvt.clkbias;
+                }
+                // c_k = 2/n sum_j f(nodes_j) T_k(nodes_j), halved for k = 0
+                for (int i = 0; i < 4; i++)
+                {
+                    for (int k = 0; k < n; k++)
+                    {
+                        double sum = 0.0;
+                        for (int j = 0; j < n; j++)
+                            sum += f[i * n + j] * Tn[j * n + k];
+                        c[i * n + k] = (k == 0 ? 1.0 : 2.0) * sum / n;
+                    }
+                }
+
+                double posResidual = 0.0, clockResidual = 0.0;
+                for (int j = 0; j <= n; j++)
+                {
+                    Xvt xvt = source_->getXvt(sats[s], tmin + (start + 0.5 * (checks[j] + 1.0) * length));
+                    Xvt fit;
+                    evaluate(a, (int)s, &Tc[j * n], &dT[0], &fit);
+                    for (int i = 0; i < 3; i++)
+                        posResidual = std::max(posResidual, fabs(fit.x[i] - xvt.x[i]));
+                    clockResidual = std::max(clockResidual, fabs(fit.clkbias - xvt.clkbias));
+                }
+                if (posResidual <= posTolerance_ && clockResidual <= clockTolerance_)
+                {
+                    fitted_[a * sats.size() + s] = 1;
+                    maxPosResidual_ = std::max(maxPosResidual_, posResidual);
+                    maxClockResidual_ = std::max(maxClockResidual_, clockResidual);
+                }
+            }
+            catch (gpstk::Exception& e)
+            {
+                // not in the source over the whole arc, which then serves it
+            }
+        }
+    }
+}
+
+void EphemerisCache::arcBounds(size_t arc, double* start, double* length) const
+{
+    *start = arc * arcLength_;
+    *length = std::min(arcLength_, span_ - *start);
+}
+
+bool EphemerisCache::basis(const CommonTime& t, size_t* arc, double* T, double* dT) const
+{
+    if (arcs_ == 0)
+        return false;
+    double dt;
+    try
+    {
+        dt = t - tmin_;
+    }
+    catch (gpstk::Exception& e)
+    {
+        return false;
+    }
+    if (!(dt >= 0.0 && dt <= span_))
+        return false;
+    size_t a = std::min((size_t)(dt / arcLength_), arcs_ - 1);
+    double start, length;
+    arcBounds(a, &start, &length);
+
+    const int n = degree_ + 1;
+    const double tau = 2.0 * (dt - start) / length - 1.0;
+    const double scale = 2.0 / length;
+    T[0] = 1.0;
+    dT[0] = 0.0;
+    if (n > 1)
+    {
+        T[1] = tau;
+        dT[1] = scale;
+    }
+    for (int k = 2; k < n; k++)
+    {
+        T[k] = 2.0 * tau * T[k - 1] - T[k - 2];
+        dT[k] = 2.0 * scale * T[k - 1] + 2.0 * tau * dT[k - 1] - dT[k - 2];
+    }
+    *arc = a;
+    return true;
+}
+
+void EphemerisCache::evaluate(size_t arc, int sat, const double* T, const double* dT, Xvt* xvt) const
+{
+    const int n = degree_ + 1;
+    const double* c = &coef_[(arc * sats_.size() + sat) * 4 * n];
+    double value[4], rate[4];
+    for (int i = 0; i < 4; i++)
+    {
+        const double* ci = c + i * n;
+        double v = 0.0, r = 0.0;
+        for (int k = 0; k < n; k++)
+        {
+            v += ci[k] * T[k];
+            r += ci[k] * dT[k];
+        }
+        value[i] = v;
+        rate[i] = r;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        xvt->x[i] = value[i];
+        xvt->v[i] = rate[i];
+    }
+    xvt->clkbias = value[3];
+    xvt->clkdrift = rate[3];
+    xvt->computeRelativityCorrection();
+}
+
+Xvt EphemerisCache::getXvt(const SatID& id, const CommonTime& t) const
+{
+    std::map<SatID, int>::const_iterator it = satIndex_.find(id);
+    if (it != satIndex_.end())
+    {
+        double T[maxDegree + 1], dT[maxDegree + 1];
+        size_t arc;
+        if (basis(t, &arc, T, dT) && fitted_[arc * sats_.size() + it->second])
+        {
+            Xvt xvt;
+            evaluate(arc, it->second, T, dT, &xvt);
+            return xvt;
+        }
+    }
+    return source_->getXvt(id, t);
+}
+
+void EphemerisCache::getXvt(const std::vector<SatID>& sats, const CommonTime& t,
+                            std::vector<Xvt>& xvt, std::vector<bool>& valid) const
+{
+    getXvt(sats, std::vector<CommonTime>(sats.size(), t), xvt, valid);
+}
+
+void EphemerisCache::getXvt(const std::vector<SatID>& sats, const std::vector<CommonTime>& times,
+                            std::vector<Xvt>& xvt, std::vector<bool>& valid) const
+{
+    if (times.size() != sats.size())
+    {
+        throw std::invalid_argument("EphemerisCache: one time per satellite is needed");
+    }
+    xvt.resize(sats.size());
+    valid.assign(sats.size(), false);
+
+    // the polynomials are evaluated again only when the time changes
+    double T[maxDegree + 1], dT[maxDegree + 1];
+    size_t arc = 0;
+    bool inTable = false;
+    for (size_t i = 0; i < sats.size(); i++)
+    {
+        if (i == 0 || times[i] != times[i - 1])
+            inTable = basis(times[i], &arc, T, dT);
+        std::map<SatID, int>::const_iterator it = satIndex_.find(sats[i]);
+        if (inTable && it != satIndex_.end() && fitted_[arc * sats_.size() + it->second])
+        {
+            evaluate(arc, it->second, T, dT, &xvt[i]);
+            valid[i] = true;
+            continue;
+        }
+        try
+        {
+            xvt[i] = source_->getXvt(sats[i], times[i]);
+            valid[i] = true;
+        }
+        catch (gpstk::Exception& e)
+        {
+        }
+    }
+}
+
+size_t EphemerisCache::fittedArcs() const
+{
+    return (size_t)std::count(fitted_.begin(), fitted_.end(), 1);
+}
+
+void EphemerisCache::dump(std::ostream& s, short detail) const
+{
+    s << "EphemerisCache: " << sats_.size() << " satellites, " << arcs_ << " arcs of " << arcLength_
+      << " s, degree " << degree_ << ", " << fittedArcs() << " of " << fitted_.size()
+      << " satellite arcs tabulated" << endl;
+    s << "  largest residuals: position " << maxPosResidual_ << " m, clock " << maxClockResidual_ << " s" << endl;
+    if (detail > 0 && arcs_ > 0)
+    {
+        for (size_t k = 0; k < sats_.size(); k++)
+        {
+            s << "  " << sats_[k] << ":";
+            for (size_t a = 0; a < arcs_; a++)
+                s << (fitted_[a * sats_.size() + k] ? " +" : " -");
+            s << endl;
+        }
+    }
+    if (detail > 1)
+        source_->dump(s, detail);
+}
+
+void EphemerisCache::edit(const CommonTime& tmin, const CommonTime& tmax)
+{
+    for (size_t a = 0; a < arcs_; a++)
+    {
+        double start, length;
+        arcBounds(a, &start, &length);
+        if (tmin_ + (start + length) < tmin || tmax < tmin_ + start)
+        {
+            std::fill(fitted_.begin() + a * sats_.size(), fitted_.begin() + (a + 1) * sats_.size(), 0);
+        }
+    }
+}
+
+void EphemerisCache::clear(void)
+{
+    sats_.clear();
+    satIndex_.clear();
+    coef_.clear();
+    fitted_.clear();
+    span_ = 0.0;
+    arcs_ = 0;
+    maxPosResidual_ = 0.0;
+    maxClockResidual_ = 0.0;
+}
+};
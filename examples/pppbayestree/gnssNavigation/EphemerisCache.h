@@ -0,0 +1,152 @@
+/**
+ *  @file   EphemerisCache.h
+ *  @brief  Header file for the Chebyshev table of satellite positions and clocks
+ **/
+
+#pragma once
+
+#include "../gpstk/XvtStore.hpp"
+#include "../gpstk/SatID.hpp"
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace minisam
+{
+
+/**
+ * The satellite positions and clocks of an ephemeris store, tabulated once
+ * as Chebyshev series over arcs of fixed length, for the modelers of the
+ * processing chain in its place. An SP3EphemerisStore interpolates a
+ * Lagrange polynomial through the tabulated samples at every request, and
+ * the light-time iterations of BasicModel, ComputeSatPCenter and
+ * ComputeWindUp request every satellite several times an epoch; from the
+ * table a request is the evaluation of four series of degree+1 terms.
+ * The defaults are arcs of the 15 minute samples of an SP3 file and degree
+ * 9: an SP3EphemerisStore built on that file, with its default Lagrange
+ * interpolation of order 10 for positions and clocks, is a single polynomial
+ * of degree 9 between two samples, which the series then reproduces to
+ * rounding. Longer arcs fit the joins of those polynomials only
+ * approximately, and are kept where the tolerances below allow.
+ *
+ * build() samples the source at the Chebyshev nodes of every arc of every
+ * satellite and checks the fit against it at the arc ends and between the
+ * nodes. An arc is tabulated only if those samples are within posTolerance
+ * (meters) and clockTolerance (seconds); velocity and clock drift are the
+ * derivatives of the series. Requests out of the table, of an arc that was
+ * not tabulated or of a satellite that was not built, are those of the
+ * source, which must outlive the cache; edit() and clear() apply to the
+ * table, not to the source.
+ *
+ * The batch getXvt evaluates the Chebyshev polynomials once for the
+ * satellites sharing a time, e.g. all the satellites of an epoch at its
+ * receive time, and then a fixed-length dot product per coordinate: the
+ * coefficients of an arc are stored contiguously, satellite by satellite.
+ */
+class EphemerisCache : public gpstk::XvtStore<gpstk::SatID>
+{
+private:
+    const gpstk::XvtStore<gpstk::SatID>* source_;
+    double arcLength_;
+    int degree_;
+    double posTolerance_;
+    double clockTolerance_;
+
+    std::vector<gpstk::SatID> sats_;
+    std::map<gpstk::SatID, int> satIndex_;
+    gpstk::CommonTime tmin_;
+    double span_;                   // seconds from tmin_ to the end of the table
+    size_t arcs_;
+    std::vector<double> coef_;      // arcs x sats x (x, y, z, clock) x (degree+1)
+    std::vector<char> fitted_;      // arcs x sats
+    double maxPosResidual_;
+    double maxClockResidual_;
+
+public:
+
+    /// largest degree of the series
+    static const int maxDegree = 31;
+
+    EphemerisCache(const gpstk::XvtStore<gpstk::SatID>& source, double arcLength = 900.0, int degree = 9,
+                   double posTolerance = 1e-3, double clockTolerance = 1e-12);
+
+    virtual ~EphemerisCache() {}
+
+    /// tabulate \c sats over [tmin, tmax] in arcs starting at tmin, replacing the table
+    void build(const std::vector<gpstk::SatID>& sats, const gpstk::CommonTime& tmin, const gpstk::CommonTime& tmax);
+
+    /// tabulate the GPS satellites present in the source from its initial to its final time
+    void build();
+
+    virtual gpstk::Xvt getXvt(const gpstk::SatID& id, const gpstk::CommonTime& t) const;
+
+    /**
+     * The Xvt of every satellite of \c sats at \c t; valid[i] is false, and
+     * xvt[i] unset, where the source cannot give it.
+     */
+    void getXvt(const std::vector<gpstk::SatID>& sats, const gpstk::CommonTime& t,
+                std::vector<gpstk::Xvt>& xvt, std::vector<bool>& valid) const;
+
+    /// getXvt of sats[i] at times[i], e.g. the transmit times of an epoch
+    void getXvt(const std::vector<gpstk::SatID>& sats, const std::vector<gpstk::CommonTime>& times,
+                std::vector<gpstk::Xvt>& xvt, std::vector<bool>& valid) const;
+
+    virtual void dump(std::ostream& s = std::cout, short detail = 0) const;
+
+    virtual void edit(const gpstk::CommonTime& tmin,
+                      const gpstk::CommonTime& tmax = gpstk::CommonTime::END_OF_TIME);
+
+    virtual void clear(void);
+
+    virtual gpstk::TimeSystem getTimeSystem(void) const
+    {
+        return source_->getTimeSystem();
+    }
+
+    virtual gpstk::CommonTime getInitialTime(void) const
+    {
+        return source_->getInitialTime();
+    }
+
+    virtual gpstk::CommonTime getFinalTime(void) const
+    {
+        return source_->getFinalTime();
+    }
+
+    virtual bool hasVelocity(void) const
+    {
+        return true;
+    }
+
+    virtual bool isPresent(const gpstk::SatID& id) const
+    {
+        return source_->isPresent(id);
+    }
+
+    /// number of arcs, and of (arc, satellite) pairs served from the table
+    size_t arcs() const
+    {
+        return arcs_;
+    }
+    size_t fittedArcs() const;
+
+    /// largest fit residuals of the tabulated arcs at the check samples
+    double maxPositionResidual() const
+    {
+        return maxPosResidual_;
+    }
+    double maxClockResidual() const
+    {
+        return maxClockResidual_;
+    }
+
+private:
+    /// the arc of \c t and its Chebyshev polynomials and their time derivatives, false out of the table
+    bool basis(const gpstk::CommonTime& t, size_t* arc, double* T, double* dT) const;
+
+    void evaluate(size_t arc, int sat, const double* T, const double* dT, gpstk::Xvt* xvt) const;
+
+    void arcBounds(size_t arc, double* start, double* length) const;
+
+}; // EphemerisCache
+}; // namespace
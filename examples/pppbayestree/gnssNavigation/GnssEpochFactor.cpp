@@ -0,0 +1,210 @@
+/**
+ *  @file   GnssEpochFactor.cpp
+ *  @brief  Implementation file for the factor of all GNSS measurements of an epoch
+ **/
+
+#include "GnssEpochFactor.h"
+#include <stdexcept>
+
+using namespace std;
+
+namespace minisam
+{
+
+GnssEpochMeasurement GnssEpochMeasurement::Pseudorange(const minivector& satXYZ, double measured, double sigma)
+{
+    GnssEpochMeasurement m;
+    for (int i = 0; i < 3; i++)
+    {
+        m.satXYZ[i] = satXYZ.data[i * satXYZ.prd];
+    }
+    m.measured = measured;
+    m.sigma = sigma;
+    m.biasKey = -1;
+    m.switchKey = -1;
+    m.maxMixWeight = 0.0;
+    m.maxMixHypNoise = 0.0;
+    m.maxMixNullSigma = 0.0;
+    return m;
+}
+
+GnssEpochMeasurement GnssEpochMeasurement::Phase(const minivector& satXYZ, int biasKey, double measured,
+        double sigma)
+{
+    GnssEpochMeasurement m = Pseudorange(satXYZ, measured, sigma);
+    m.biasKey = biasKey;
+    return m;
+}
+
+/// index of \c key in \c keys, appended if absent
+static int keyIndex(std::vector<int>& keys, int key)
+{
+    for (size_t k = 1; k < keys.size(); k++)
+    {
+        if (keys[k] == key)
+            return (int)k;
+    }
+    if (key == keys[0])
+    {
+        throw std::invalid_argument("GnssEpochFactor: bias or switch key is the nonBiasStates key");
+    }
+    keys.push_back(key);
+    return (int)keys.size() - 1;
+}
+
+static GaussianNoiseModel* rowNoise(const std::vector<GnssEpochMeasurement>& measurements)
+{
+    minivector sigmas(measurements.size());
+    for (size_t r = 0; r < measurements.size(); r++)
+    {
+        sigmas.data[r * sigmas.prd] = measurements[r].sigma;
+    }
+    return new GaussianNoiseModel(sigmas);
+}
+
+GnssEpochFactor::GnssEpochFactor(int nonBiasKey, const minivector& nomXYZ,
+                                 const std::vector<GnssEpochMeasurement>& measurements, NoiseModelPool* pool)
+    : Base(std::vector<int>(1, nonBiasKey)), measurements_(measurements), pool_(pool)
+{
+    if (measurements.empty())
+    {
+        throw std::invalid_argument("GnssEpochFactor: no measurements");
+    }
+    const size_t m = measurements.size();
+    h_.resize(5 * m);
+    biasIndex_.resize(m);
+    switchIndex_.resize(m);
+    for (int i = 0; i < 3; i++)
+    {
+        nomXYZ_[i] = nomXYZ.data[i * nomXYZ.prd];
+    }
+    for (size_t r = 0; r < m; r++)
+    {
+        const GnssEpochMeasurement& g = measurements[r];
+        if (g.switchKey >= 0 && g.maxMixWeight > 0.0)
+        {
+            throw std::invalid_argument("GnssEpochFactor: row is both switchable and max-mixture");
+        }
+        minivector h = obsMap(minivector(g.satXYZ[0], g.satXYZ[1], g.satXYZ[2]), nomXYZ, 1);
+        for (int c = 0; c < 5; c++)
+        {
+            h_[5 * r + c] = h.data[c * h.prd];
+        }
+        biasIndex_[r] = g.biasKey >= 0 ? keyIndex(keys_, g.biasKey) : 0;
+        switchIndex_[r] = g.switchKey >= 0 ? keyIndex(keys_, g.switchKey) : 0;
+    }
+    noiseModel_ = NoiseModelPool_InternOrOwn(pool, rowNoise(measurements));
+}
+
+NoiseModelFactor* GnssEpochFactor::clone() const
+{
+    minivector nomXYZ(nomXYZ_[0], nomXYZ_[1], nomXYZ_[2]);
+    GnssEpochFactor* ngef = new GnssEpochFactor(keys_[0], nomXYZ, measurements_, pool_);
+    return ngef;
+}
+
+minivector GnssEpochFactor::unwhitenedError(const std::map<int, minimatrix*>& x) const
+{
+    minivector result(measurements_.size());
+    evaluate(x, result.data, NULL);
+    return result;
+}
+
+minivector GnssEpochFactor::unwhitenedError(const std::map<int, minimatrix*>& x,
+        std::vector<minimatrix>& H) const
+{
+    minivector result(measurements_.size());
+    evaluate(x, result.data, &H);
+    return result;
+}
+
+void GnssEpochFactor::evaluate(const std::map<int, minimatrix*>& x, double* e, std::vector<minimatrix>* H) const
+{
+    // one lookup per key, the values of bias and switch keys are 1-vectors
+    const size_t nkeys = keys_.size();
+    std::vector<double> scalar(nkeys, 0.0);
+    std::map<int, minimatrix*>::const_iterator it = x.find(keys_[0]);
+    if (it == x.end())
+    {
+        throw std::invalid_argument("GnssEpochFactor: no value for the nonBiasStates key");
+    }
+    const minimatrix* q = it->second;
+    const double q0 = q->data[0], q1 = q->data[q->prd], q2 = q->data[2 * q->prd],
+                 q3 = q->data[3 * q->prd], q4 = q->data[4 * q->prd];
+    for (size_t k = 1; k < nkeys; k++)
+    {
+        it = x.find(keys_[k]);
+        if (it == x.end())
+        {
+            throw std::invalid_argument("GnssEpochFactor: no value for a bias or switch key");
+        }
+        scalar[k] = it->second->data[0];
+    }
+
+    const size_t m = measurements_.size();
+    double* Hq = NULL;
+    if (H != NULL)
+    {
+        if (H->size() != nkeys)
+            H->resize(nkeys);
+        minimatrix_resize(&(*H)[0], m, 5);
+        Hq = (*H)[0].data;
+        for (size_t k = 1; k < nkeys; k++)
+        {
+            minimatrix_resize(&(*H)[k], m, 1);
+            minimatrix_set_zero(&(*H)[k]);
+        }
+    }
+    const size_t ldq = H != NULL ? (*H)[0].prd : 0;
+
+    for (size_t r = 0; r < m; r++)
+    {
+        const GnssEpochMeasurement& g = measurements_[r];
+        const double* h = &h_[5 * r];
+        double error = h[0] * q0 + h[1] * q1 + h[2] * q2 + h[3] * q3 + h[4] * q4 - g.measured;
+        if (biasIndex_[r] != 0)
+            error += scalar[biasIndex_[r]];
+
+        // the scale of the Jacobians of the row: s for PseudorangeSwitchFactor, w for PseudorangeMaxMix
+        double scale = 1.0;
+        if (switchIndex_[r] != 0)
+        {
+            scale = scalar[switchIndex_[r]];
+            error *= scale;
+        }
+        else if (g.maxMixWeight > 0.0)
+        {
+            // PseudorangeMaxMix: nu1 and nu2 are 1/sqrt(det(information)) of its models with
+            // information 1/hyp and w/hyp
+            const double w = g.maxMixWeight, hyp = g.maxMixHypNoise;
+            const double m1 = (error / g.sigma) * (error / g.sigma);
+            const double m2 = (error / g.maxMixNullSigma) * (error / g.maxMixNullSigma);
+            const double l1 = sqrt(hyp) * exp(-0.5 * m1);
+            const double l2 = sqrt(hyp / w) * exp(-0.5 * m2);
+            if (l2 > l1)
+            {
+                scale = w;
+                error *= sqrt(w);
+            }
+        }
+        e[r] = error;
+
+        if (Hq != NULL)
+        {
+            double* row = Hq + r * ldq;
+            for (int c = 0; c < 5; c++)
+                row[c] = h[c] * scale;
+            if (biasIndex_[r] != 0)
+            {
+                minimatrix& Hb = (*H)[biasIndex_[r]];
+                Hb.data[r * Hb.prd] = scale;
+            }
+            if (switchIndex_[r] != 0)
+            {
+                minimatrix& Hs = (*H)[switchIndex_[r]];
+                Hs.data[r * Hs.prd] = error;
+            }
+        }
+    }
+}
+};
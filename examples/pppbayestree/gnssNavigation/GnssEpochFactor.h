@@ -0,0 +1,106 @@
+/**
+ *  @file   GnssEpochFactor.h
+ *  @brief  Header file for the factor of all GNSS measurements of an epoch
+ **/
+
+#pragma once
+
+#include "../gnssNavigation/GnssTools.h"
+#include "minisam/nonlinear/NonlinearFactor.h"
+#include "minisam/linear/NoiseModelPool.h"
+#include <vector>
+
+namespace minisam
+{
+
+/**
+ * One pseudorange or carrier-phase row of a GnssEpochFactor, with the
+ * arguments of PseudorangeFactor or PhaseFactor and, optionally, the robust
+ * weighting of PseudorangeMaxMix or PseudorangeSwitchFactor.
+ */
+struct GnssEpochMeasurement
+{
+    double satXYZ[3];
+    double measured;        ///< the prefit residual
+    double sigma;           ///< standard deviation of the row
+    int biasKey;            ///< carrier-phase bias key, -1 for a pseudorange
+    int switchKey;          ///< switch variable of PseudorangeSwitchFactor, -1 for none
+    double maxMixWeight;    ///< weight w of PseudorangeMaxMix, 0 for none
+    double maxMixHypNoise;  ///< hypNoise of PseudorangeMaxMix
+    double maxMixNullSigma; ///< standard deviation of the null-hypothesis model of PseudorangeMaxMix
+
+    static GnssEpochMeasurement Pseudorange(const minivector& satXYZ, double measured, double sigma);
+    static GnssEpochMeasurement Phase(const minivector& satXYZ, int biasKey, double measured, double sigma);
+};
+
+/**
+ * The PseudorangeFactor and PhaseFactor rows of one receiver epoch as one
+ * factor on the nonBiasStates key and the bias (and switch) keys of its
+ * rows. The observation maps are computed once, at construction, and an
+ * evaluation is one pass over them: every row reads the same receiver
+ * state, and the Jacobian of that state is a single stacked block. The noise
+ * model is the diagonal of the row sigmas, so the whitened rows are those of
+ * the separate factors.
+ *
+ * A row with a switch key is that of PseudorangeSwitchFactor, error and
+ * Jacobians multiplied by the switch variable, and a row with a positive
+ * maxMixWeight that of PseudorangeMaxMix, whose error is multiplied by
+ * sqrt(w) and Jacobians by w when the null hypothesis is the more likely.
+ * Both are reproduced as the separate factors compute them, so either may
+ * also weight a phase row.
+ */
+class GnssEpochFactor : public NoiseModelFactor
+{
+private:
+    typedef NoiseModelFactor Base;
+    double nomXYZ_[3];
+    std::vector<GnssEpochMeasurement> measurements_;
+    std::vector<double> h_;         // rows x 5 observation maps
+    std::vector<int> biasIndex_;    // index in keys_ of the bias of each row, 0 for none
+    std::vector<int> switchIndex_;  // index in keys_ of the switch of each row, 0 for none
+    NoiseModelPool* pool_;          // holds the noise model when not NULL
+
+public:
+
+    typedef GnssEpochFactor This;
+
+    /**
+     * The factor builds its noise model from the row sigmas. Without \c pool
+     * the factor owns the model and deletes it; with one the model is interned
+     * in it and the factor only releases its reference, so the pool must
+     * outlive the factor.
+     */
+    GnssEpochFactor(int nonBiasKey, const minivector& nomXYZ,
+                    const std::vector<GnssEpochMeasurement>& measurements, NoiseModelPool* pool = NULL);
+
+    virtual ~GnssEpochFactor()
+    {
+        NoiseModelPool_ReleaseOrDelete(pool_, noiseModel_);
+    }
+
+    /// a copy would release the noise model a second time, use clone()
+    GnssEpochFactor(const GnssEpochFactor&) = delete;
+    GnssEpochFactor& operator=(const GnssEpochFactor&) = delete;
+
+    virtual NoiseModelFactor* clone() const;
+
+    size_t rows() const
+    {
+        return measurements_.size();
+    }
+
+    const std::vector<GnssEpochMeasurement>& measurements() const
+    {
+        return measurements_;
+    }
+
+    virtual minivector unwhitenedError(const std::map<int, minimatrix*>& x) const;
+
+    virtual minivector unwhitenedError(const std::map<int, minimatrix*>& x,
+                                       std::vector<minimatrix>& H) const;
+
+private:
+    void evaluate(const std::map<int, minimatrix*>& x, double* e, std::vector<minimatrix>* H) const;
+
+}; // GnssEpochFactor Factor
+}; // namespace
@@ -14,6 +14,8 @@
 #include "pppbayestree/gnssNavigation/GnssData.h"
 #include "pppbayestree/gnssNavigation/GnssTools.h"
 #include "pppbayestree/gnssNavigation/PhaseFactor.h"
+#include "pppbayestree/gnssNavigation/GnssEpochFactor.h"
+#include "pppbayestree/gnssNavigation/EphemerisCache.h"
 #include "pppbayestree/gnssNavigation/nonBiasStates.h"
 #include "pppbayestree/configReader/ConfDataReader.hpp"
 
@@ -275,6 +277,10 @@ int main(int argc, char* argv[])
     SP3EphList.rejectBadPositions(true);
     SP3EphList.rejectBadClocks(true);
 
+    // Tabulate the satellite positions and clocks once, for the modelers
+    EphemerisCache ephCache(SP3EphList);
+    ephCache.build();
+
     // Create the input observation file stream
     Rinex3ObsStream rin(obs_path);
 
@@ -317,11 +323,11 @@ int main(int argc, char* argv[])
     }
 
     // Declare a couple of basic modelers
-    BasicModel basic(nominalPos, SP3EphList);
+    BasicModel basic(nominalPos, ephCache);
     basic.setMinElev(minElev);
 
     // Object to correct for SP3 Sat Phase-center offset
-    ComputeSatPCenter svPcenter(SP3EphList, nominalPos);
+    ComputeSatPCenter svPcenter(ephCache, nominalPos);
 
     // Objects to mark cycle slips
     MWCSDetector markCSMW;  // Checks Merbourne-Wubbena cycle slip
@@ -370,7 +376,7 @@ int main(int argc, char* argv[])
     EclipsedSatFilter eclipsedSV;
 
     //Object to compute wind-up effect
-    ComputeWindUp windup( SP3EphList, nominalPos );
+    ComputeWindUp windup( ephCache, nominalPos );
 
     // Object to compute prefit-residuals
     ComputeLinear linear3(comb.pcPrefit);
@@ -449,6 +455,7 @@ int main(int argc, char* argv[])
         }
 
         // Loop over all observed sats at current epoch
+        std::vector<GnssEpochMeasurement> epochMeasurements;
         for (it = gRin.body.begin(); it!= gRin.body.end(); it++)
         {
 
@@ -499,26 +506,19 @@ int main(int argc, char* argv[])
                 initial_values.insert(std::make_pair(Symbol('B',bias_counter.data[svn]).key(), new minivector(biasb)));
                 phase_arc.data[svn] = phase_break;
             }
-            // Generate pseudorange factor
-            minivector gpsRangeFactorvec(1,sqrt(elDepWeight(satXYZ, nomXYZ, rangeWeight)));
-
-            //gpsRangeFactorvec<<elDepWeight(satXYZ, nomXYZ, rangeWeight);
-            //GaussianNoiseModel* ngpsrfn=new GaussianNoiseModel(gpsRangeFactorvec.cwiseSqrt());
-            GaussianNoiseModel* ngpsrfn=new GaussianNoiseModel(gpsRangeFactorvec);
-            PseudorangeFactor* ngpsrf=new PseudorangeFactor(Symbol('X',count).key(), rangeRes,
-             new minivector(satXYZ), new minivector(nomXYZ),ngpsrfn);
-
-            graph.push_back(ngpsrf);
-            gpsRangeFactorvec.data[0]=sqrt(elDepWeight(satXYZ, nomXYZ, phaseWeight));
-            GaussianNoiseModel* ngpspfn2=new GaussianNoiseModel(gpsRangeFactorvec);
-            //GaussianNoiseModel* ngpspfn2=new GaussianNoiseModel(gpsRangeFactorvec.cwiseSqrt());
-            PhaseFactor* ngpspf=new PhaseFactor(Symbol('X',count).key(),
-             Symbol('B',bias_counter.data[svn]).key(),phaseRes, new minivector(satXYZ),
-             new minivector( nomXYZ),ngpspfn2);
-            graph.push_back(ngpspf);
+            // Pseudorange and phase rows of the epoch factor
+            epochMeasurements.push_back(GnssEpochMeasurement::Pseudorange(satXYZ, rangeRes,
+             sqrt(elDepWeight(satXYZ, nomXYZ, rangeWeight))));
+            epochMeasurements.push_back(GnssEpochMeasurement::Phase(satXYZ,
+             Symbol('B',bias_counter.data[svn]).key(), phaseRes,
+             sqrt(elDepWeight(satXYZ, nomXYZ, phaseWeight))));
 
             prn_vec.push_back(svn);
         }
+        // One factor for the pseudorange and phase measurements of all satellites
+        GnssEpochFactor* ngef=new GnssEpochFactor(Symbol('X',count).key(), nomXYZ, epochMeasurements);
+        graph.push_back(ngef);
+        epochMeasurements.clear();
         if (count > startKey )
         {
            // GaussianNoiseModel* nonBias_ProcessNoise=
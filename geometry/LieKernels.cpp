@@ -0,0 +1,285 @@
+/**
+ * @file    LieKernels.cpp
+ * @brief   Fused SO3/Pose3 exponential and logarithm maps with derivatives
+ */
+
+#include "LieKernels.h"
+#include "../gmfconfig.h"
+#include <math.h>
+
+namespace minisam
+{
+
+/// Below this squared angle the coefficients use their Taylor series, exact to rounding.
+#define LIEKERNELS_TAYLOR_THETA2 1e-6
+
+/**
+ * The coefficients of the SO3 maps at omega, with W = [omega]x and
+ * W^2 = omega omega^T - theta^2 I:
+ *   exp(W)  = I + A W + B W^2
+ *   Jr      = I - B W + C W^2,   Jl = Jr^T
+ *   Jr^-1   = I + W / 2 + D W^2, Jl^-1 = Jr^-T
+ */
+struct SO3Coefficients
+{
+    double theta2, A, B, C, D;
+
+    explicit SO3Coefficients(const double* w)
+    {
+        theta2 = w[0] * w[0] + w[1] * w[1] + w[2] * w[2];
+        if (theta2 < LIEKERNELS_TAYLOR_THETA2)
+        {
+            A = 1.0 - theta2 / 6.0;
+            B = 0.5 - theta2 / 24.0;
+            C = 1.0 / 6.0 - theta2 / 120.0;
+            D = 1.0 / 12.0 + theta2 / 720.0;
+        }
+        else
+        {
+            const double theta = sqrt(theta2);
+            const double s = sin(theta), c = cos(theta);
+            A = s / theta;
+            B = (1.0 - c) / theta2;
+            C = (theta - s) / (theta2 * theta);
+            // (1 - theta / (2 tan(theta / 2))) / theta^2, finite up to theta = pi
+            const double half = 0.5 * theta;
+            D = (1.0 - half * cos(half) / sin(half)) / theta2;
+        }
+    }
+};
+
+/// M = I + a W + b W^2, row-major
+static inline void so3Matrix(const double* w, double theta2, double a, double b, double* M)
+{
+    const double d = 1.0 - b * theta2;
+    M[0] = d + b * w[0] * w[0];
+    M[4] = d + b * w[1] * w[1];
+    M[8] = d + b * w[2] * w[2];
+    M[1] = b * w[0] * w[1] - a * w[2];
+    M[3] = b * w[0] * w[1] + a * w[2];
+    M[2] = b * w[0] * w[2] + a * w[1];
+    M[6] = b * w[0] * w[2] - a * w[1];
+    M[5] = b * w[1] * w[2] - a * w[0];
+    M[7] = b * w[1] * w[2] + a * w[0];
+}
+
+/// r = M v
+static inline void mul3(const double* M, const double* v, double* r)
+{
+    const double x = M[0] * v[0] + M[1] * v[1] + M[2] * v[2];
+    const double y = M[3] * v[0] + M[4] * v[1] + M[5] * v[2];
+    const double z = M[6] * v[0] + M[7] * v[1] + M[8] * v[2];
+    r[0] = x;
+    r[1] = y;
+    r[2] = z;
+}
+
+/// C = A B for 3x3
+static inline void mul33(const double* A, const double* B, double* C)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            C[3 * i + j] = A[3 * i] * B[j] + A[3 * i + 1] * B[3 + j] + A[3 * i + 2] * B[6 + j];
+        }
+    }
+}
+
+static inline void skew(const double* w, double* W)
+{
+    W[0] = 0.0;
+    W[1] = -w[2];
+    W[2] = w[1];
+    W[3] = w[2];
+    W[4] = 0.0;
+    W[5] = -w[0];
+    W[6] = -w[1];
+    W[7] = w[0];
+    W[8] = 0.0;
+}
+
+/**
+ * The lower-left block of the Pose3 ExpmapDerivative, Barfoot14tro eq. (102)
+ * with the signs of the odd terms inverted for the right Jacobian.
+ */
+static void pose3Q(const double* w, const double* v, double* Q)
+{
+    double W[9], V[9];
+    skew(w, W);
+    skew(v, V);
+    const double phi2 = w[0] * w[0] + w[1] * w[1] + w[2] * w[2];
+    double a, b, c;
+    if (phi2 < LIEKERNELS_TAYLOR_THETA2)
+    {
+        a = 1.0 / 6.0 - phi2 / 120.0;
+        b = -1.0 / 24.0 + phi2 / 720.0;
+        c = 1.0 / 30.0 - phi2 / 1008.0;
+    }
+    else
+    {
+        const double phi = sqrt(phi2);
+        const double s = sin(phi), cs = cos(phi);
+        const double phi3 = phi2 * phi, phi4 = phi2 * phi2, phi5 = phi4 * phi;
+        a = (phi - s) / phi3;
+        b = (1.0 - phi2 / 2.0 - cs) / phi4;
+        c = -0.5 * (b - 3.0 * (phi - s - phi3 / 6.0) / phi5);
+    }
+    double WV[9], VW[9], WVW[9], WWV[9], VWW[9], WVWW[9], WWVW[9];
+    mul33(W, V, WV);
+    mul33(V, W, VW);
+    mul33(WV, W, WVW);
+    mul33(W, WV, WWV);
+    mul33(VW, W, VWW);
+    mul33(WVW, W, WVWW);
+    mul33(W, WVW, WWVW);
+    for (int k = 0; k < 9; k++)
+    {
+        Q[k] = -0.5 * V[k] + a * (WV[k] + VW[k] - WVW[k]) + b * (WWV[k] + VWW[k] - 3.0 * WVW[k])
+               + c * (WVWW[k] + WWVW[k]);
+    }
+}
+
+/// 6x6 H = [J 0; Q J]
+static inline void pose3Jacobian(const double* J, const double* Q, double* H)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            H[6 * i + j] = J[3 * i + j];
+            H[6 * i + j + 3] = 0.0;
+            H[6 * (i + 3) + j] = Q[3 * i + j];
+            H[6 * (i + 3) + j + 3] = J[3 * i + j];
+        }
+    }
+}
+
+void SO3_Expmap(const double* omega, double* R, double* H)
+{
+    const SO3Coefficients k(omega);
+    so3Matrix(omega, k.theta2, k.A, k.B, R);
+    if (H != NULL)
+        so3Matrix(omega, k.theta2, -k.B, k.C, H);
+}
+
+void SO3_Logmap(const double* R, double* omega, double* H)
+{
+    // sin(theta) n from the skew part, cos(theta) from the trace
+    const double sx = 0.5 * (R[7] - R[5]), sy = 0.5 * (R[2] - R[6]), sz = 0.5 * (R[3] - R[1]);
+    const double s = sqrt(sx * sx + sy * sy + sz * sz);
+    double c = 0.5 * (R[0] + R[4] + R[8] - 1.0);
+    c = c > 1.0 ? 1.0 : (c < -1.0 ? -1.0 : c);
+    const double theta = atan2(s, c);
+
+    if (c > -0.9)
+    {
+        // theta / sin(theta), the series where sin(theta) ~ theta
+        const double scale = s < 1e-7 ? 1.0 + s * s / 6.0 : theta / s;
+        omega[0] = scale * sx;
+        omega[1] = scale * sy;
+        omega[2] = scale * sz;
+    }
+    else
+    {
+        // near pi the skew part vanishes, the axis is in (R + R^T) / 2 - c I = (1 - c) n n^T
+        const double B[9] = {R[0] - c, 0.5 * (R[1] + R[3]), 0.5 * (R[2] + R[6]),
+                             0.5 * (R[1] + R[3]), R[4] - c, 0.5 * (R[5] + R[7]),
+                             0.5 * (R[2] + R[6]), 0.5 * (R[5] + R[7]), R[8] - c
+                            };
+        const int j = (B[0] >= B[4] && B[0] >= B[8]) ? 0 : (B[4] >= B[8] ? 1 : 2);
+        const double nj = sqrt(B[4 * j] / (1.0 - c));
+        double n[3] = {B[3 * j] / ((1.0 - c) * nj), B[3 * j + 1] / ((1.0 - c) * nj), B[3 * j + 2] / ((1.0 - c) * nj)};
+        if (n[0] * sx + n[1] * sy + n[2] * sz < 0.0)
+        {
+            n[0] = -n[0];
+            n[1] = -n[1];
+            n[2] = -n[2];
+        }
+        omega[0] = theta * n[0];
+        omega[1] = theta * n[1];
+        omega[2] = theta * n[2];
+    }
+    if (H != NULL)
+    {
+        const SO3Coefficients k(omega);
+        so3Matrix(omega, k.theta2, 0.5, k.D, H);
+    }
+}
+
+void Pose3_Expmap(const double* xi, double* T, double* H)
+{
+    const SO3Coefficients k(xi);
+    so3Matrix(xi, k.theta2, k.A, k.B, T);
+    // t = Jl(omega) v
+    double Jl[9];
+    so3Matrix(xi, k.theta2, k.B, k.C, Jl);
+    mul3(Jl, xi + 3, T + 9);
+    if (H != NULL)
+    {
+        double Jr[9], Q[9];
+        so3Matrix(xi, k.theta2, -k.B, k.C, Jr);
+        pose3Q(xi, xi + 3, Q);
+        pose3Jacobian(Jr, Q, H);
+    }
+}
+
+void Pose3_Logmap(const double* T, double* xi, double* H)
+{
+    SO3_Logmap(T, xi, NULL);
+    const SO3Coefficients k(xi);
+    // v = Jl^-1(omega) t
+    double JlInv[9];
+    so3Matrix(xi, k.theta2, -0.5, k.D, JlInv);
+    mul3(JlInv, T + 9, xi + 3);
+    if (H != NULL)
+    {
+        // [Jw 0; -Jw Q Jw Jw] with Jw = Jr^-1(omega)
+        double Jw[9], Q[9], JQ[9], Q2[9];
+        so3Matrix(xi, k.theta2, 0.5, k.D, Jw);
+        pose3Q(xi, xi + 3, Q);
+        mul33(Jw, Q, JQ);
+        mul33(JQ, Jw, Q2);
+        for (int i = 0; i < 9; i++)
+            Q2[i] = -Q2[i];
+        pose3Jacobian(Jw, Q2, H);
+    }
+}
+
+MINISAM_CLONES
+void SO3_ExpmapBatch(const double* omega, double* R, double* H, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        SO3_Expmap(omega + 3 * i, R + 9 * i, H != NULL ? H + 9 * i : NULL);
+    }
+}
+
+MINISAM_CLONES
+void SO3_LogmapBatch(const double* R, double* omega, double* H, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        SO3_Logmap(R + 9 * i, omega + 3 * i, H != NULL ? H + 9 * i : NULL);
+    }
+}
+
+MINISAM_CLONES
+void Pose3_ExpmapBatch(const double* xi, double* T, double* H, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        Pose3_Expmap(xi + 6 * i, T + 12 * i, H != NULL ? H + 36 * i : NULL);
+    }
+}
+
+MINISAM_CLONES
+void Pose3_LogmapBatch(const double* T, double* xi, double* H, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        Pose3_Logmap(T + 12 * i, xi + 6 * i, H != NULL ? H + 36 * i : NULL);
+    }
+}
+
+};
@@ -0,0 +1,37 @@
+#ifndef LIEKERNELS_H
+#define LIEKERNELS_H
+
+/**
+ * @file    LieKernels.h
+ * @brief   Fused SO3/Pose3 exponential and logarithm maps with derivatives
+ */
+
+#include <stddef.h>
+
+namespace minisam
+{
+
+/**
+ * The maps of SO3::Expmap/Logmap and Pose3::Expmap/Logmap, each computing
+ * the value and its derivative together on raw arrays: the trigonometric
+ * terms and the small-angle branch are evaluated once and shared, and nothing
+ * is allocated. Rotations are row-major double[9], poses double[12] in the
+ * Pose3 storage (rotation rows, then translation), tangent vectors
+ * omega[3] and xi[6] = [omega, v]. Derivatives are row-major, H may be NULL:
+ * - Expmap: H = ExpmapDerivative(omega or xi), the right Jacobian
+ * - Logmap: H = LogmapDerivative, its inverse at the result
+ */
+void SO3_Expmap(const double* omega, double* R, double* H);
+void SO3_Logmap(const double* R, double* omega, double* H);
+void Pose3_Expmap(const double* xi, double* T, double* H);
+void Pose3_Logmap(const double* T, double* xi, double* H);
+
+/// The maps above for n tangent vectors or values stored back to back, H may be NULL.
+void SO3_ExpmapBatch(const double* omega, double* R, double* H, size_t n);
+void SO3_LogmapBatch(const double* R, double* omega, double* H, size_t n);
+void Pose3_ExpmapBatch(const double* xi, double* T, double* H, size_t n);
+void Pose3_LogmapBatch(const double* T, double* xi, double* H, size_t n);
+
+};
+
+#endif // LIEKERNELS_H
@@ -0,0 +1,176 @@
+/**
+ * @file    PinholeBatch.cpp
+ * @brief   Projection of many points through one pinhole camera
+ */
+
+#include "PinholeBatch.h"
+#include "../gmfconfig.h"
+#include <algorithm>
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+// the body must be inlined into each clone to be vectorized for its target
+#define PINHOLEBATCH_INLINE __attribute__((always_inline)) inline
+#else
+#define PINHOLEBATCH_INLINE inline
+#endif
+
+namespace minisam
+{
+
+/// Points per block: the arithmetic runs over a block in structure-of-arrays
+/// form, which vectorizes, before the interleaved Jacobians are stored.
+#define PINHOLEBATCH_BLOCK 64
+
+/**
+ * Point i in camera coordinates q = R^T (p - t), its normalized coordinates
+ * (u, v) = (qx, qy) / qz and, if Dpose/Dpoint are given, their Jacobians
+ *   Dpose  = [uv, -1-uu, v, -d, 0, du; 1+vv, -uv, -u, 0, -d, dv]
+ *   Dpoint = d [R^T_0 - u R^T_2; R^T_1 - v R^T_2]
+ * with d = 1 / qz, then the pixel and the Jacobians through the calibration:
+ * A, the 2x2 Jacobian of the pixel in (u, v), times the rows above.
+ */
+template<bool DISTORTION>
+static PINHOLEBATCH_INLINE size_t projectBatch(const double* pose, const double* K, const double* points,
+                                               size_t n, double* uv, double* Dpose, double* Dpoint)
+{
+    // R^T row by row, i.e. the columns of R
+    const double r00 = pose[0], r01 = pose[3], r02 = pose[6];
+    const double r10 = pose[1], r11 = pose[4], r12 = pose[7];
+    const double r20 = pose[2], r21 = pose[5], r22 = pose[8];
+    const double tx = pose[9], ty = pose[10], tz = pose[11];
+    const double fx = K[0], fy = K[1], s = K[2], u0 = K[3], v0 = K[4];
+    const double k1 = DISTORTION ? K[5] : 0.0, k2 = DISTORTION ? K[6] : 0.0;
+    const double p1 = DISTORTION ? K[7] : 0.0, p2 = DISTORTION ? K[8] : 0.0;
+
+    double U[PINHOLEBATCH_BLOCK], V[PINHOLEBATCH_BLOCK], D[PINHOLEBATCH_BLOCK];
+    double A00[PINHOLEBATCH_BLOCK], A01[PINHOLEBATCH_BLOCK], A10[PINHOLEBATCH_BLOCK], A11[PINHOLEBATCH_BLOCK];
+    size_t behind = 0;
+    for (size_t begin = 0; begin < n; begin += PINHOLEBATCH_BLOCK)
+    {
+        const size_t m = std::min((size_t)PINHOLEBATCH_BLOCK, n - begin);
+        const double* p = points + 3 * begin;
+        double* z = uv + 2 * begin;
+        for (size_t i = 0; i < m; i++)
+        {
+            const double dx = p[3 * i] - tx, dy = p[3 * i + 1] - ty, dz = p[3 * i + 2] - tz;
+            const double qx = r00 * dx + r01 * dy + r02 * dz;
+            const double qy = r10 * dx + r11 * dy + r12 * dz;
+            const double qz = r20 * dx + r21 * dy + r22 * dz;
+            behind += qz <= 0.0 ? 1 : 0;
+            const double d = 1.0 / qz;
+            const double u = qx * d, v = qy * d;
+            double x = u, y = v;
+            double a00 = fx, a01 = s, a10 = 0.0, a11 = fy;
+            if (DISTORTION)
+            {
+                const double uu = u * u, vv = v * v, uv2 = 2.0 * u * v, rr = uu + vv;
+                const double g = 1.0 + (k1 + k2 * rr) * rr;
+                x = g * u + p1 * uv2 + p2 * (rr + 2.0 * uu);
+                y = g * v + p2 * uv2 + p1 * (rr + 2.0 * vv);
+                const double dg = 2.0 * (k1 + 2.0 * k2 * rr);
+                const double dxdu = g + uu * dg + 2.0 * p1 * v + 6.0 * p2 * u;
+                const double dxdv = u * v * dg + 2.0 * p1 * u + 2.0 * p2 * v;
+                const double dydu = u * v * dg + 2.0 * p2 * v + 2.0 * p1 * u;
+                const double dydv = g + vv * dg + 2.0 * p2 * u + 6.0 * p1 * v;
+                a00 = fx * dxdu + s * dydu;
+                a01 = fx * dxdv + s * dydv;
+                a10 = fy * dydu;
+                a11 = fy * dydv;
+            }
+            z[2 * i] = fx * x + s * y + u0;
+            z[2 * i + 1] = fy * y + v0;
+            U[i] = u;
+            V[i] = v;
+            D[i] = d;
+            A00[i] = a00;
+            A01[i] = a01;
+            A10[i] = a10;
+            A11[i] = a11;
+        }
+        if (Dpose != NULL)
+        {
+            double* H = Dpose + 12 * begin;
+            for (size_t i = 0; i < m; i++)
+            {
+                const double u = U[i], v = V[i], d = D[i];
+                const double n0[6] = {u * v, -1.0 - u * u, v, -d, 0.0, d * u};
+                const double n1[6] = {1.0 + v * v, -u * v, -u, 0.0, -d, d * v};
+                for (int c = 0; c < 6; c++)
+                {
+                    H[12 * i + c] = A00[i] * n0[c] + A01[i] * n1[c];
+                    H[12 * i + 6 + c] = A10[i] * n0[c] + A11[i] * n1[c];
+                }
+            }
+        }
+        if (Dpoint != NULL)
+        {
+            double* H = Dpoint + 6 * begin;
+            for (size_t i = 0; i < m; i++)
+            {
+                const double u = U[i], v = V[i], d = D[i];
+                const double n0[3] = {d * (r00 - u * r20), d * (r01 - u * r21), d * (r02 - u * r22)};
+                const double n1[3] = {d * (r10 - v * r20), d * (r11 - v * r21), d * (r12 - v * r22)};
+                for (int c = 0; c < 3; c++)
+                {
+                    H[6 * i + c] = A00[i] * n0[c] + A01[i] * n1[c];
+                    H[6 * i + 3 + c] = A10[i] * n0[c] + A11[i] * n1[c];
+                }
+            }
+        }
+    }
+    return behind;
+}
+
+MINISAM_CLONES
+size_t PinholeCal3S2_ProjectBatch(const double* pose, const double* K, const double* points, size_t n,
+                                  double* uv, double* Dpose, double* Dpoint)
+{
+    return projectBatch<false>(pose, K, points, n, uv, Dpose, Dpoint);
+}
+
+MINISAM_CLONES
+size_t PinholeCal3DS2_ProjectBatch(const double* pose, const double* K, const double* points, size_t n,
+                                   double* uv, double* Dpose, double* Dpoint)
+{
+    return projectBatch<true>(pose, K, points, n, uv, Dpose, Dpoint);
+}
+
+/// pose and calibration to contiguous arrays
+static void poseArray(const Pose3& pose, double* T)
+{
+    for (size_t i = 0; i < 4; i++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            T[3 * i + j] = pose.data[i * pose.prd + j];
+        }
+    }
+}
+
+static void calibrationArray(const minivector& K, size_t size, double* k)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        k[i] = K.data[i * K.prd];
+    }
+}
+
+size_t PinholeCal3S2_ProjectBatch(const Pose3& pose, const Cal3_S2& K, const double* points, size_t n,
+                                  double* uv, double* Dpose, double* Dpoint)
+{
+    double T[12], k[5];
+    poseArray(pose, T);
+    calibrationArray(K, 5, k);
+    return PinholeCal3S2_ProjectBatch(T, k, points, n, uv, Dpose, Dpoint);
+}
+
+size_t PinholeCal3DS2_ProjectBatch(const Pose3& pose, const Cal3DS2_Base& K, const double* points, size_t n,
+                                   double* uv, double* Dpose, double* Dpoint)
+{
+    double T[12], k[9];
+    poseArray(pose, T);
+    calibrationArray(K, 9, k);
+    return PinholeCal3DS2_ProjectBatch(T, k, points, n, uv, Dpose, Dpoint);
+}
+
+};
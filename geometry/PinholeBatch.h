@@ -0,0 +1,44 @@
+#ifndef PINHOLEBATCH_H
+#define PINHOLEBATCH_H
+
+/**
+ * @file    PinholeBatch.h
+ * @brief   Projection of many points through one pinhole camera
+ */
+
+#include "../geometry/Pose3.h"
+#include "../geometry/Cal3_S2.h"
+#include "../geometry/Cal3DS2_Base.h"
+#include <stddef.h>
+
+namespace minisam
+{
+
+/**
+ * Project n points through the camera at \c pose, the pixel coordinates and
+ * Jacobians of PinholeCameraCal3S2::projectPoint(point, Dpose, Dpoint) for
+ * each, with the pose and calibration terms computed once for all points and
+ * the loop over points vectorized (target_clones on x86-64 GCC).
+ * - pose: double[12] in the Pose3 storage (rotation rows, then translation)
+ * - K: Cal3_S2 (fx, fy, s, u0, v0), or Cal3DS2 (fx, fy, s, u0, v0, k1, k2, p1, p2)
+ * - points: n world points, double[3] each
+ * - uv: n pixels, double[2] each
+ * - Dpose: n row-major 2x6 Jacobians, Dpoint: n row-major 2x3 Jacobians,
+ *   either may be NULL
+ * Points are projected whatever their depth; the number of points with depth
+ * <= 0, where projectPoint may throw a CheiralityException, is returned.
+ */
+size_t PinholeCal3S2_ProjectBatch(const double* pose, const double* K, const double* points, size_t n,
+                                  double* uv, double* Dpose, double* Dpoint);
+size_t PinholeCal3DS2_ProjectBatch(const double* pose, const double* K, const double* points, size_t n,
+                                   double* uv, double* Dpose, double* Dpoint);
+
+/// The batch projections with the pose and calibration of the library types
+size_t PinholeCal3S2_ProjectBatch(const Pose3& pose, const Cal3_S2& K, const double* points, size_t n,
+                                  double* uv, double* Dpose, double* Dpoint);
+size_t PinholeCal3DS2_ProjectBatch(const Pose3& pose, const Cal3DS2_Base& K, const double* points, size_t n,
+                                   double* uv, double* Dpose, double* Dpoint);
+
+};
+
+#endif // PINHOLEBATCH_H
@@ -0,0 +1,217 @@
+/**
+ * @file    QuaternionKernels.cpp
+ * @brief   Allocation-free unit quaternion operations on raw arrays
+ */
+
+#include "QuaternionKernels.h"
+#include "../gmfconfig.h"
+#include <math.h>
+
+namespace minisam
+{
+
+static inline void compose(const double* g, const double* h, double* q)
+{
+    const double w = g[0] * h[0] - g[1] * h[1] - g[2] * h[2] - g[3] * h[3];
+    const double x = g[0] * h[1] + g[1] * h[0] + g[2] * h[3] - g[3] * h[2];
+    const double y = g[0] * h[2] - g[1] * h[3] + g[2] * h[0] + g[3] * h[1];
+    const double z = g[0] * h[3] + g[1] * h[2] - g[2] * h[1] + g[3] * h[0];
+    q[0] = w;
+    q[1] = x;
+    q[2] = y;
+    q[3] = z;
+}
+
+/// r = v + w t + u x t with t = 2 u x v, u the vector part of q
+static inline void rotate(const double* q, const double* v, double* r)
+{
+    const double tx = 2.0 * (q[2] * v[2] - q[3] * v[1]);
+    const double ty = 2.0 * (q[3] * v[0] - q[1] * v[2]);
+    const double tz = 2.0 * (q[1] * v[1] - q[2] * v[0]);
+    const double rx = v[0] + q[0] * tx + q[2] * tz - q[3] * ty;
+    const double ry = v[1] + q[0] * ty + q[3] * tx - q[1] * tz;
+    const double rz = v[2] + q[0] * tz + q[1] * ty - q[2] * tx;
+    r[0] = rx;
+    r[1] = ry;
+    r[2] = rz;
+}
+
+static inline void composePose(const double* g, const double* h, double* r)
+{
+    double t[3];
+    rotate(g, h + 4, t);
+    compose(g, h, r);
+    r[4] = g[4] + t[0];
+    r[5] = g[5] + t[1];
+    r[6] = g[6] + t[2];
+}
+
+void Quaternion4_Compose(const double* g, const double* h, double* q)
+{
+    compose(g, h, q);
+}
+
+void Quaternion4_Between(const double* g, const double* h, double* q)
+{
+    const double ginv[4] = {g[0], -g[1], -g[2], -g[3]};
+    compose(ginv, h, q);
+}
+
+void Quaternion4_Rotate(const double* q, const double* v, double* r)
+{
+    rotate(q, v, r);
+}
+
+void Quaternion4_Expmap(const double* omega, double* q)
+{
+    const double theta2 = omega[0] * omega[0] + omega[1] * omega[1] + omega[2] * omega[2];
+    double w, scale;
+    if (theta2 > 1e-8)
+    {
+        const double theta = sqrt(theta2);
+        w = cos(0.5 * theta);
+        scale = sin(0.5 * theta) / theta;
+    }
+    else
+    {
+        // second order, so the result stays a unit quaternion to rounding
+        w = 1.0 - theta2 / 8.0;
+        scale = 0.5 - theta2 / 48.0;
+    }
+    q[0] = w;
+    q[1] = scale * omega[0];
+    q[2] = scale * omega[1];
+    q[3] = scale * omega[2];
+}
+
+void Quaternion4_Logmap(const double* q, double* omega)
+{
+    // q and -q are the same rotation, w >= 0 gives the angle in [0, pi]
+    const double sign = q[0] < 0.0 ? -1.0 : 1.0;
+    const double w = sign * q[0];
+    const double s = sqrt(q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    double scale;
+    if (s > 1e-8)
+    {
+        scale = 2.0 * atan2(s, w) / s;
+    }
+    else
+    {
+        // angle / sin(angle / 2) at w = 1
+        scale = 2.0 / w * (1.0 - s * s / (3.0 * w * w));
+    }
+    scale *= sign;
+    omega[0] = scale * q[1];
+    omega[1] = scale * q[2];
+    omega[2] = scale * q[3];
+}
+
+void Quaternion4_Retract(const double* q, const double* omega, double* r)
+{
+    double d[4];
+    Quaternion4_Expmap(omega, d);
+    compose(q, d, r);
+}
+
+void Quaternion4_FromMatrix(const double* R, double* q)
+{
+    // Shepperd: divide by the largest of 4w^2, 4x^2, 4y^2, 4z^2
+    const double trace = R[0] + R[4] + R[8];
+    double w, x, y, z;
+    if (trace > 0.0)
+    {
+        const double s = 2.0 * sqrt(1.0 + trace);
+        w = 0.25 * s;
+        x = (R[7] - R[5]) / s;
+        y = (R[2] - R[6]) / s;
+        z = (R[3] - R[1]) / s;
+    }
+    else if (R[0] > R[4] && R[0] > R[8])
+    {
+        const double s = 2.0 * sqrt(1.0 + R[0] - R[4] - R[8]);
+        w = (R[7] - R[5]) / s;
+        x = 0.25 * s;
+        y = (R[1] + R[3]) / s;
+        z = (R[2] + R[6]) / s;
+    }
+    else if (R[4] > R[8])
+    {
+        const double s = 2.0 * sqrt(1.0 + R[4] - R[0] - R[8]);
+        w = (R[2] - R[6]) / s;
+        x = (R[1] + R[3]) / s;
+        y = 0.25 * s;
+        z = (R[5] + R[7]) / s;
+    }
+    else
+    {
+        const double s = 2.0 * sqrt(1.0 + R[8] - R[0] - R[4]);
+        w = (R[3] - R[1]) / s;
+        x = (R[2] + R[6]) / s;
+        y = (R[5] + R[7]) / s;
+        z = 0.25 * s;
+    }
+    const double n = (w < 0.0 ? -1.0 : 1.0) / sqrt(w * w + x * x + y * y + z * z);
+    q[0] = w * n;
+    q[1] = x * n;
+    q[2] = y * n;
+    q[3] = z * n;
+}
+
+void Quaternion4_ToMatrix(const double* q, double* R)
+{
+    const double w = q[0], x = q[1], y = q[2], z = q[3];
+    R[0] = 1.0 - 2.0 * (y * y + z * z);
+    R[1] = 2.0 * (x * y - w * z);
+    R[2] = 2.0 * (x * z + w * y);
+    R[3] = 2.0 * (x * y + w * z);
+    R[4] = 1.0 - 2.0 * (x * x + z * z);
+    R[5] = 2.0 * (y * z - w * x);
+    R[6] = 2.0 * (x * z - w * y);
+    R[7] = 2.0 * (y * z + w * x);
+    R[8] = 1.0 - 2.0 * (x * x + y * y);
+}
+
+void Quaternion4_FromRot3(const Rot3& R, double* q)
+{
+    double m[9];
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            m[3 * i + j] = R.data[i * R.prd + j];
+        }
+    }
+    Quaternion4_FromMatrix(m, q);
+}
+
+Rot3 Quaternion4_ToRot3(const double* q)
+{
+    double R[9];
+    Quaternion4_ToMatrix(q, R);
+    return Rot3(R[0], R[1], R[2], R[3], R[4], R[5], R[6], R[7], R[8]);
+}
+
+void Quaternion4_ComposePose(const double* g, const double* h, double* r)
+{
+    composePose(g, h, r);
+}
+
+MINISAM_CLONES
+void Quaternion4_ComposeBatch(const double* g, const double* h, double* q, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        compose(g + 4 * i, h + 4 * i, q + 4 * i);
+    }
+}
+
+MINISAM_CLONES
+void Quaternion4_ComposePoseBatch(const double* g, const double* h, double* r, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        composePose(g + 7 * i, h + 7 * i, r + 7 * i);
+    }
+}
+
+};
@@ -0,0 +1,66 @@
+#ifndef QUATERNIONKERNELS_H
+#define QUATERNIONKERNELS_H
+
+/**
+ * @file    QuaternionKernels.h
+ * @brief   Allocation-free unit quaternion operations on raw arrays
+ */
+
+#include "../geometry/Rot3.h"
+#include <stddef.h>
+
+namespace minisam
+{
+
+/**
+ * Unit quaternions as double[4] = (w, x, y, z), Hamilton product, the
+ * rotation R(q) of Rot3::Quaternion(w, x, y, z). Quaternion poses are
+ * double[7] = (w, x, y, z, tx, ty, tz) with the Pose3 group operation.
+ *
+ * Rot3 and Pose3 of the library store the 3x3 matrix, these kernels are the
+ * 4-double representation for code that composes many rotations, e.g.
+ * integrating IMU measurements, and converts to Rot3 at the end. None of them
+ * allocates. Expmap returns a unit quaternion to rounding at every angle, so
+ * Retract needs no renormalization. Outputs may alias inputs.
+ */
+
+/// q = g * h
+void Quaternion4_Compose(const double* g, const double* h, double* q);
+
+/// q = g^-1 * h
+void Quaternion4_Between(const double* g, const double* h, double* q);
+
+/// r = R(q) * v
+void Quaternion4_Rotate(const double* q, const double* v, double* r);
+
+/// q = exp(omega), omega the rotation vector as in Rot3::Expmap
+void Quaternion4_Expmap(const double* omega, double* q);
+
+/// omega = log(q) in [-pi, pi], as Rot3::Logmap
+void Quaternion4_Logmap(const double* q, double* omega);
+
+/// r = q * exp(omega), the retraction of Rot3 with the exponential chart
+void Quaternion4_Retract(const double* q, const double* omega, double* r);
+
+/// q from a row-major rotation matrix, w >= 0
+void Quaternion4_FromMatrix(const double* R, double* q);
+
+/// R(q), row-major
+void Quaternion4_ToMatrix(const double* q, double* R);
+
+/// Rot3 <-> quaternion
+void Quaternion4_FromRot3(const Rot3& R, double* q);
+Rot3 Quaternion4_ToRot3(const double* q);
+
+/// pose r = g * h
+void Quaternion4_ComposePose(const double* g, const double* h, double* r);
+
+/// q[i] = g[i] * h[i] for n quaternions stored back to back
+void Quaternion4_ComposeBatch(const double* g, const double* h, double* q, size_t n);
+
+/// r[i] = g[i] * h[i] for n poses stored back to back
+void Quaternion4_ComposePoseBatch(const double* g, const double* h, double* r, size_t n);
+
+};
+
+#endif // QUATERNIONKERNELS_H
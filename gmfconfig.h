@@ -15,5 +15,13 @@
 
 #define use2ndOrderCoriolis false
 
+// functions marked MINISAM_CLONES are built for AVX-512, AVX2 and the baseline
+// x86-64, the loader picks the widest the CPU supports
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define MINISAM_CLONES __attribute__((target_clones("arch=skylake-avx512", "arch=haswell", "default")))
+#else
+#define MINISAM_CLONES
+#endif
+
 
 #endif // GMFCONFIG_H_INCLUDED
@@ -41,6 +41,11 @@ public:
     /// Version of optimize for incomplete BayesNet, needs solution for missing variables
     std::map<int,minivector> optimize(const std::map<int,minivector>& solutionForMissing) const;
 
+    /// Solve \f$ R X = B \f$ for several right-hand sides at once. \c rhs holds the rows
+    /// of \f$ B \f$ for each frontal variable, all with the same number of columns, a
+    /// variable missing from \c rhs has zero right-hand sides.
+    std::map<int,minimatrix> optimize(const std::map<int,minimatrix>& rhs) const;
+
     ///@}
 
     ///@name Linear Algebra
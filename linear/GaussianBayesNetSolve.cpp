@@ -0,0 +1,93 @@
+/**
+ * @file    GaussianBayesNetSolve.cpp
+ * @brief   Back-substitution of a Bayes net with a matrix of right-hand sides
+ */
+
+#include "GaussianBayesNet.h"
+#include "../miniblas/miniblas_backend.h"
+
+namespace minisam
+{
+
+std::map<int, minimatrix> GaussianConditional::solve(const std::map<int, minimatrix> &parents, const minimatrix &rhs) const
+{
+    const minimatrix R = get_R();
+    if (rhs.size1 != R.size1)
+    {
+        throw std::invalid_argument("GaussianConditional::solve: rhs does not match R");
+    }
+    const size_t k = rhs.size2;
+    const miniblas_backend *backend = miniblas_get_backend();
+
+    // X = B - S*X_s
+    minimatrix X(rhs);
+    for (std::vector<int>::const_iterator it = cbeginParents(); it != cendParents(); ++it)
+    {
+        std::map<int, minimatrix>::const_iterator xs = parents.find(*it);
+        if (xs == parents.end())
+        {
+            throw std::invalid_argument("GaussianConditional::solve: parent is not solved");
+        }
+        const minimatrix S = get_S(it);
+        if (xs->second.size1 != S.size2 || xs->second.size2 != k)
+        {
+            throw std::invalid_argument("GaussianConditional::solve: parent has wrong dimensions");
+        }
+        backend->dgemm(blasNoTrans, blasNoTrans, -1.0, S, xs->second, 1.0, &X);
+    }
+
+    // X = R^-1 * X
+    backend->dtrsm(blasLeft, blasUpper, blasNoTrans, blasNonUnit, 1.0, R, &X);
+
+    std::map<int, minimatrix> result;
+    size_t row = 0;
+    for (std::vector<int>::const_iterator it = cbeginFrontals(); it != cendFrontals(); ++it)
+    {
+        const size_t dim = getDim(it);
+        result.insert(std::make_pair(*it, minimatrix_blockmatrix(X, row, 0, dim, k)));
+        row += dim;
+    }
+    return result;
+}
+
+std::map<int, minimatrix> GaussianBayesNet::optimize(const std::map<int, minimatrix>& rhs) const
+{
+    if (rhs.empty())
+    {
+        throw std::invalid_argument("GaussianBayesNet::optimize: no right-hand sides");
+    }
+    const size_t k = rhs.begin()->second.size2;
+
+    std::map<int, minimatrix> soln;
+    for (std::vector<GaussianConditional*>::const_reverse_iterator cg = factors_.rbegin(); cg != factors_.rend(); ++cg)
+    {
+        if (*cg == NULL)
+            continue;
+
+        // stack the right-hand sides of the frontal variables
+        minimatrix B((*cg)->get_R().size1, k);
+        minimatrix_set_zero(&B);
+        size_t row = 0;
+        for (std::vector<int>::const_iterator it = (*cg)->cbeginFrontals(); it != (*cg)->cendFrontals(); ++it)
+        {
+            const size_t dim = (*cg)->getDim(it);
+            std::map<int, minimatrix>::const_iterator b = rhs.find(*it);
+            if (b != rhs.end())
+            {
+                if (b->second.size1 != dim || b->second.size2 != k)
+                {
+                    throw std::invalid_argument("GaussianBayesNet::optimize: rhs has wrong dimensions");
+                }
+                minimatrix Bi = minimatrix_blockmatrix(B, row, 0, dim, k);
+                minimatrix_memcpy(&Bi, b->second);
+            }
+            row += dim;
+        }
+
+        std::map<int, minimatrix> frontals = (*cg)->solve(soln, B);
+        soln.insert(frontals.begin(), frontals.end());
+    }
+    return soln;
+}
+
+};
@@ -68,6 +68,17 @@ public:
     */
     std::map<int, minivector> solve(const std::map<int, minivector> &parents) const;
 
+    /**
+    * Multiple right-hand side version of solve: every column of \c rhs takes the
+    * place of \f$ d \f$ and the parents hold one solved column per right-hand side,
+    * so \f$ X_f = R^{-1} (B - S X_s) \f$ is computed with one dgemm per parent and
+    * one dtrsm instead of a back-substitution per column.
+    *
+    * @param parents solved parents \f$ X_s \f$, each with rhs.size2 columns.
+    * @param rhs stacked right-hand sides, one row per row of \f$ R \f$.
+    */
+    std::map<int, minimatrix> solve(const std::map<int, minimatrix> &parents, const minimatrix &rhs) const;
+
 
     // operators
 
@@ -122,6 +133,11 @@ std::pair<GaussianConditional*, JacobianFactor*> EliminateQR(const std::vector<c
 
 std::pair<GaussianConditional*, HessianFactor*> EliminateCholesky(const std::vector<const RealGaussianFactor*>&factors,
         const std::vector<int>& keys);
+
+/// Same as EliminateCholesky, but the joint factor is built by assembleHessian
+/// (see HessianFactor.h) without per-factor temporaries.
+std::pair<GaussianConditional*, HessianFactor*> EliminateCholeskyDirect(const std::vector<const RealGaussianFactor*>&factors,
+        const std::vector<int>& keys);
 /**
      *  In-place elimination that returns a conditional on (ordered) keys specified, and leaves
      *  this factor to be on the remaining keys (separator) only. Does dense partial Cholesky.
@@ -58,6 +58,24 @@ public:
     std::list<minivector> operator*(const std::map<int,minivector>& x) const;
     std::map<int,minivector> optimize(std::vector<int>& ordering,
     const Factorization Eliminatekind=CHOLESKY) const;
+
+    /**
+     * Mixed-precision solve of a small, dense system: the joint information
+     * matrix of the whole graph is assembled in double, factorized once by a
+     * dense float32 Cholesky and the solution is refined with residuals
+     * r = A'b - A'A x computed in double until the correction drops below
+     * \c tolerance relative to x. Sparsity is not exploited, the cost is the
+     * one of a dense O(n^3) factorization: it only pays off where the
+     * information matrix is nearly full anyway, e.g. small windows of
+     * high-rate odometry, while sparse graphs are faster with optimize().
+     * The elimination by cliques of optimize() and ISAM2 stays in double.
+     * Graphs of more than MIXEDPRECISION_MAX_DIM (2048) scalar variables are
+     * solved by optimize(), as are systems whose float32 factorization breaks
+     * down or whose refinement has not met the tolerance after
+     * \c maxRefinements corrections.
+     */
+    std::map<int,minivector> optimizeDenseMixedPrecision(const std::vector<int>& ordering,
+    int maxRefinements=10, double tolerance=1e-12) const;
     std::map<int,minivector> hessianDiagonal() const;
 
 };
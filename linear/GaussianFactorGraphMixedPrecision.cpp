@@ -0,0 +1,112 @@
+/**
+ * @file    GaussianFactorGraphMixedPrecision.cpp
+ * @brief   Dense float32 factorization with float64 iterative refinement
+ */
+
+#include "GaussianFactorGraph.h"
+#include "Scatter.h"
+#include "../miniblas/minilinalg.h"
+#include <math.h>
+
+namespace minisam
+{
+
+/// Largest dimension of the dense float32 system, larger graphs are solved by optimize()
+#define MIXEDPRECISION_MAX_DIM 2048
+
+std::map<int,minivector> GaussianFactorGraph::optimizeDenseMixedPrecision(const std::vector<int>& ordering,
+        int maxRefinements, double tolerance) const
+{
+    const std::vector<const RealGaussianFactor*> factors(factors_.begin(), factors_.end());
+    Scatter scatter(*this, ordering);
+    SlotMap slots(scatter);
+    const size_t n = slots.offset(slots.size());
+    if (n > MIXEDPRECISION_MAX_DIM)
+    {
+        std::vector<int> doubleOrdering(ordering);
+        return optimize(doubleOrdering, CHOLESKY);
+    }
+    HessianFactor joint(scatter);
+    assembleHessian(factors, slots, &joint);
+
+    // H = [info g; g' f] in the upper triangle
+    const minimatrix& H = joint.Ab_.matrix_;
+
+    std::vector<float> L(n * n);
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = 0; j <= i; j++)
+        {
+            L[i * n + j] = (float)H.data[j * H.prd + i];
+        }
+    }
+    if (minilinalg_cholesky_decomp_float(L.data(), n, n) != MINI_SUCCESS)
+    {
+        std::vector<int> doubleOrdering(ordering);
+        return optimize(doubleOrdering, CHOLESKY);
+    }
+
+    std::vector<double> x(n, 0.0);
+    std::vector<double> r(n);
+    std::vector<float> dx(n);
+    bool converged = false;
+    for (int iteration = 0; iteration <= maxRefinements; iteration++)
+    {
+        // r = g - H*x in double, H symmetric from its upper triangle
+        for (size_t i = 0; i < n; i++)
+        {
+            r[i] = H.data[i * H.prd + n];
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            const double * hi = H.data + i * H.prd;
+            double s = hi[i] * x[i];
+            for (size_t j = i + 1; j < n; j++)
+            {
+                s += hi[j] * x[j];
+                r[j] -= hi[j] * x[i];
+            }
+            r[i] -= s;
+        }
+
+        for (size_t i = 0; i < n; i++)
+        {
+            dx[i] = (float)r[i];
+        }
+        minilinalg_cholesky_solve_float(L.data(), n, n, dx.data());
+
+        double step = 0.0;
+        double size = 0.0;
+        for (size_t i = 0; i < n; i++)
+        {
+            x[i] += dx[i];
+            step = miniblas_max(step, fabs((double)dx[i]));
+            size = miniblas_max(size, fabs(x[i]));
+        }
+        if (step <= tolerance * size)
+        {
+            converged = true;
+            break;
+        }
+    }
+    // too ill-conditioned for float32 to converge, x is not trustworthy
+    if (!converged)
+    {
+        std::vector<int> doubleOrdering(ordering);
+        return optimize(doubleOrdering, CHOLESKY);
+    }
+
+    std::map<int,minivector> result;
+    for (int s = 0; s < slots.size(); s++)
+    {
+        minivector xs(slots.dim(s));
+        for (int k = 0; k < slots.dim(s); k++)
+        {
+            xs.data[k] = x[slots.offset(s) + k];
+        }
+        result.insert(std::make_pair(scatter[s].key, xs));
+    }
+    return result;
+}
+
+};
@@ -164,6 +164,19 @@ public:
 
 void _FromJacobianHelper(const RealGaussianFactor& jf,GaussianBlockMatrix& info);
 
+/**
+ * Single-pass assembly of the joint Hessian of \c factors into \c hf, which
+ * must have been allocated with HessianFactor(const Scatter&) for the scatter
+ * behind \c slots. Every A_i'*A_j is accumulated by dsyrk/dgemm straight into
+ * its block of the information matrix: the first contribution to a block
+ * overwrites it, so only blocks nobody touches are zeroed, and the only
+ * temporary is one whitening buffer shared by all factors. A key repeated
+ * within a factor contributes the sum of its blocks, as if their columns were
+ * added. The strictly lower triangle is left unspecified.
+ */
+void assembleHessian(const std::vector<const RealGaussianFactor*>& factors,
+                     const SlotMap& slots, HessianFactor* hf);
+
 };
 
 #endif // HESSIANFACTOR_H
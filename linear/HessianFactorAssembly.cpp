@@ -0,0 +1,276 @@
+/**
+ * @file    HessianFactorAssembly.cpp
+ * @brief   Direct scatter-add of factors into a preallocated joint Hessian
+ */
+
+#include "HessianFactor.h"
+#include "GaussianConditional.h"
+#include "../miniblas/miniblas_backend.h"
+#include <string.h>
+
+namespace minisam
+{
+
+SlotMap::SlotMap(const Scatter& scatter):minKey_(0)
+{
+    const int n = scatter.size();
+    dims_.reserve(n);
+    offsets_.reserve(n + 1);
+    int offset = 0;
+    int minKey = 0;
+    int maxKey = -1;
+    for (int i = 0; i < n; i++)
+    {
+        const SlotEntry& e = scatter[i];
+        dims_.push_back(e.dimension);
+        offsets_.push_back(offset);
+        offset += e.dimension;
+        if (i == 0 || e.key < minKey)
+            minKey = e.key;
+        if (i == 0 || e.key > maxKey)
+            maxKey = e.key;
+    }
+    offsets_.push_back(offset);
+
+    // a dense table as long as it is at most a few times the number of slots
+    if (n > 0 && (long long)maxKey - minKey < 4LL * n + 64)
+    {
+        minKey_ = minKey;
+        direct_.assign(maxKey - minKey + 1, -1);
+        for (int i = 0; i < n; i++)
+        {
+            direct_[scatter[i].key - minKey_] = i;
+        }
+    }
+    else
+    {
+        sparse_.reserve(n);
+        for (int i = 0; i < n; i++)
+        {
+            sparse_[scatter[i].key] = i;
+        }
+    }
+}
+
+int SlotMap::slot(int key) const
+{
+    if (!direct_.empty())
+    {
+        const long long i = (long long)key - minKey_;
+        return (i >= 0 && i < (long long)direct_.size()) ? direct_[i] : -1;
+    }
+    std::unordered_map<int, int>::const_iterator it = sparse_.find(key);
+    return (it == sparse_.end()) ? -1 : it->second;
+}
+
+/// Target block of the upper triangle, the first write overwrites it.
+class HessianAssembler
+{
+public:
+    HessianAssembler(const SlotMap& slots, minimatrix* info):
+        slots_(slots), info_(info), n_(slots.size() + 1), touched_(n_ * n_, 0)
+    {
+        backend_ = miniblas_get_backend();
+    }
+
+    int dim(int s) const
+    {
+        return (s == slots_.size()) ? 1 : slots_.dim(s);
+    }
+
+    minimatrix block(int si, int sj)
+    {
+        return minimatrix_blockmatrix_var(info_, slots_.offset(si), slots_.offset(sj), dim(si), dim(sj));
+    }
+
+    /// returns the beta for the next write to block (si,sj) and marks it written
+    double touch(int si, int sj)
+    {
+        char& t = touched_[si * n_ + sj];
+        const double beta = t ? 1.0 : 0.0;
+        t = 1;
+        return beta;
+    }
+
+    /// G(si,si) += Ai'*Ai
+    void addGram(int si, const minimatrix& Ai)
+    {
+        minimatrix G = block(si, si);
+        backend_->dsyrk(blasUpper, blasTrans, 1.0, Ai, touch(si, si), &G);
+    }
+
+    /// G(si,sj) += Ai'*Aj, or its transpose into G(sj,si) when sj comes first
+    void addCross(int si, const minimatrix& Ai, int sj, const minimatrix& Aj)
+    {
+        if (si > sj)
+        {
+            addCross(sj, Aj, si, Ai);
+            return;
+        }
+        minimatrix G = block(si, sj);
+        backend_->dgemm(blasTrans, blasNoTrans, 1.0, Ai, Aj, touch(si, sj), &G);
+        // a key repeated in the factor: its diagonal block also takes the transpose, Aj'*Ai
+        if (si == sj)
+        {
+            backend_->dgemm(blasTrans, blasNoTrans, 1.0, Aj, Ai, 1.0, &G);
+        }
+    }
+
+    /**
+     * G(si,sj) += S, S is a block of another information matrix. An
+     * off-diagonal S landing on a diagonal block comes from a key repeated in
+     * its factor, S' is then added too.
+     */
+    void addBlock(int si, int sj, const minimatrix& S, bool diagonal)
+    {
+        const bool transpose = si > sj;
+        const int r = transpose ? sj : si;
+        const int c = transpose ? si : sj;
+        minimatrix G = block(r, c);
+        const bool first = touch(r, c) == 0.0;
+        const bool both = r == c && !diagonal;
+        for (size_t i = 0; i < G.size1; i++)
+        {
+            // only the upper triangle of diagonal blocks is meaningful
+            const size_t j0 = (r == c) ? i : 0;
+            double* g = G.data + i * G.prd;
+            for (size_t j = j0; j < G.size2; j++)
+            {
+                double v = transpose ? S.data[j * S.prd + i] : S.data[i * S.prd + j];
+                if (both)
+                    v += S.data[j * S.prd + i];
+                g[j] = first ? v : g[j] + v;
+            }
+        }
+    }
+
+    /// zero the upper triangle of every block no factor wrote to
+    void zeroUntouched()
+    {
+        for (int si = 0; si < n_; si++)
+        {
+            for (int sj = si; sj < n_; sj++)
+            {
+                if (touched_[si * n_ + sj])
+                    continue;
+                minimatrix G = block(si, sj);
+                for (size_t i = 0; i < G.size1; i++)
+                {
+                    const size_t j0 = (si == sj) ? i : 0;
+                    memset(G.data + i * G.prd + j0, 0, (G.size2 - j0) * sizeof(double));
+                }
+            }
+        }
+    }
+
+private:
+    const SlotMap& slots_;
+    minimatrix* info_;
+    const int n_;
+    std::vector<char> touched_;
+    const miniblas_backend* backend_;
+};
+
+void assembleHessian(const std::vector<const RealGaussianFactor*>& factors,
+                     const SlotMap& slots, HessianFactor* hf)
+{
+    minimatrix& info = hf->Ab_.matrix_;
+    const int nSlots = slots.size();
+    if ((int)info.size1 != slots.offset(nSlots) + 1 || hf->Ab_.blockStart_ != 0)
+    {
+        throw std::invalid_argument("assembleHessian: factor is not allocated for this scatter");
+    }
+
+    HessianAssembler assembler(slots, &info);
+    std::vector<int> factorSlots;
+    std::vector<int> columns;
+    std::vector<double> whitened;
+
+    for (size_t f = 0; f < factors.size(); f++)
+    {
+        const RealGaussianFactor* factor = factors[f];
+        if (factor == NULL || factor->empty())
+            continue;
+
+        const std::vector<int>& keys = factor->keys();
+        const int nk = keys.size();
+        factorSlots.resize(nk + 1);
+        for (int k = 0; k < nk; k++)
+        {
+            factorSlots[k] = slots.slot(keys[k]);
+            if (factorSlots[k] < 0)
+            {
+                throw std::invalid_argument("assembleHessian: key is missing from the scatter");
+            }
+        }
+        factorSlots[nk] = nSlots;
+
+        if (factor->TypeGaussianFactor == 1)
+        {
+            // HessianFactor: add its blocks, the augmented block included
+            const GaussianBlockMatrix& src = factor->Ab_;
+            for (int i = 0; i <= nk; i++)
+            {
+                for (int j = i; j <= nk; j++)
+                {
+                    const minimatrix S = minimatrix_blockmatrix(src.matrix_, src.Soffset(i), src.Soffset(j),
+                                         src.SgetDim(i), src.SgetDim(j));
+                    assembler.addBlock(factorSlots[i], factorSlots[j], S, i == j);
+                }
+            }
+            continue;
+        }
+
+        // JacobianFactor: whiten [A b] into the shared buffer if needed
+        const minimatrix Ab = factor->Ab_.Vfull();
+        minimatrix W;
+        if (factor->model_ != NULL && !factor->model_->isUnit())
+        {
+            if (factor->model_->isConstrained())
+            {
+                throw std::invalid_argument("assembleHessian: cannot handle constrained noise models");
+            }
+            whitened.resize(Ab.size1 * Ab.size2);
+            W.size1 = Ab.size1;
+            W.size2 = Ab.size2;
+            W.prd = Ab.size2;
+            W.dimension = Ab.size1 * Ab.size2;
+            W.data = whitened.data();
+            minimatrix_memcpy(&W, Ab);
+            GaussianNoiseModel_WhitenInPlace(*factor->model_, &W);
+        }
+        const minimatrix& A = (W.data != NULL) ? W : Ab;
+
+        columns.resize(nk + 2);
+        columns[0] = 0;
+        for (int k = 0; k < nk; k++)
+        {
+            columns[k + 1] = columns[k] + factor->getDim(keys.begin() + k);
+        }
+        columns[nk + 1] = columns[nk] + 1;
+        for (int i = 0; i <= nk; i++)
+        {
+            const minimatrix Ai = minimatrix_blockmatrix(A, 0, columns[i], A.size1, columns[i + 1] - columns[i]);
+            assembler.addGram(factorSlots[i], Ai);
+            for (int j = i + 1; j <= nk; j++)
+            {
+                const minimatrix Aj = minimatrix_blockmatrix(A, 0, columns[j], A.size1, columns[j + 1] - columns[j]);
+                assembler.addCross(factorSlots[i], Ai, factorSlots[j], Aj);
+            }
+        }
+    }
+    assembler.zeroUntouched();
+}
+
+std::pair<GaussianConditional*, HessianFactor*> EliminateCholeskyDirect(const std::vector<const RealGaussianFactor*>& factors,
+        const std::vector<int>& keys)
+{
+    Scatter scatter(factors, keys);
+    SlotMap slots(scatter);
+    HessianFactor* jointFactor = new HessianFactor(scatter);
+    assembleHessian(factors, slots, jointFactor);
+    GaussianConditional* conditional = HFeliminateCholesky(keys, jointFactor);
+    return std::make_pair(conditional, jointFactor);
+}
+
+};
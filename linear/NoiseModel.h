@@ -326,6 +326,22 @@ GaussianNoiseModel* NDiagonalNoiseModelPrecision(const minivector& precisions,bo
 GaussianNoiseModel* DiagonalNoiseModelSigmas(const minivector &sigmas,
         bool smart = true);
 
+/**
+ * In-place whitening without virtual calls or temporaries. Diagonal and
+ * isotropic models scale each row by its inverse sigma, constrained models
+ * leave the rows with zero sigma untouched. Full and robust models fall back
+ * to their virtual WhitenInPlace/WhitenSystem.
+ */
+void GaussianNoiseModel_WhitenInPlace(const GaussianNoiseModel &model, minimatrix *H);
+
+/// Whiten the blocks and the right-hand side of a system in one pass over the rows.
+void GaussianNoiseModel_WhitenSystem(const GaussianNoiseModel &model, minimatrix *A, minivector *b);
+void GaussianNoiseModel_WhitenSystem(const GaussianNoiseModel &model, minimatrix *A1, minimatrix *A2, minivector *b);
+void GaussianNoiseModel_WhitenSystem(const GaussianNoiseModel &model, minimatrix *A1, minimatrix *A2, minimatrix *A3, minivector *b);
+
+/// The dim() row scales of a diagonal, isotropic or constrained model, false for other models.
+bool GaussianNoiseModel_RowScales(const GaussianNoiseModel &model, double *scales);
+
 };
 #endif // NOISEMODEL_H_INCLUDED
 
@@ -0,0 +1,199 @@
+/**
+ * @file    NoiseModelPool.cpp
+ * @brief   Interned, reference counted noise models shared between factors
+ */
+
+#include "NoiseModelPool.h"
+#include "mEstimator.h"
+#include <string.h>
+#include <typeinfo>
+
+namespace minisam
+{
+
+static inline void hashCombine(size_t* seed, size_t value)
+{
+    *seed ^= value + 0x9e3779b97f4a7c15ULL + (*seed << 6) + (*seed >> 2);
+}
+
+static inline size_t hashDouble(double value)
+{
+    // +0.0 and -0.0 whiten identically
+    if (value == 0.0)
+        return 0;
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (size_t)bits;
+}
+
+static void hashMatrix(size_t* seed, const minimatrix& m)
+{
+    hashCombine(seed, m.size1);
+    hashCombine(seed, m.size2);
+    for (size_t i = 0; i < m.size1; i++)
+    {
+        for (size_t j = 0; j < m.size2; j++)
+        {
+            hashCombine(seed, hashDouble(m.data[i * m.prd + j]));
+        }
+    }
+}
+
+static bool equalMatrix(const minimatrix& a, const minimatrix& b)
+{
+    if (a.size1 != b.size1 || a.size2 != b.size2)
+        return false;
+    for (size_t i = 0; i < a.size1; i++)
+    {
+        for (size_t j = 0; j < a.size2; j++)
+        {
+            if (a.data[i * a.prd + j] != b.data[i * b.prd + j])
+                return false;
+        }
+    }
+    return true;
+}
+
+// GaussianNoiseModel::Covariance leaves isConstrained_, isUnit_ and nullmodel
+// uninitialized, so a full model is identified by its type and
+// sqrt_information_ only, and constrained models by their dynamic type
+size_t NoiseModelPool::hash(const GaussianNoiseModel& model)
+{
+    size_t seed = typeid(model).hash_code();
+    hashCombine(&seed, model.dim_);
+    if (model.isdiagonal_)
+    {
+        hashCombine(&seed, model.isUnit_ ? 1 : 0);
+        hashMatrix(&seed, model.sigmas_);
+        hashMatrix(&seed, model.invsigmas_);
+    }
+    else
+    {
+        hashMatrix(&seed, model.sqrt_information_);
+    }
+    return seed;
+}
+
+bool NoiseModelPool::equal(const GaussianNoiseModel& a, const GaussianNoiseModel& b)
+{
+    if (&a == &b)
+        return true;
+    if (typeid(a) != typeid(b) || a.dim_ != b.dim_ || !a.isdiagonal_ != !b.isdiagonal_)
+        return false;
+    if (dynamic_cast<const RobustNoiseModel*>(&a) != NULL)
+        return false;
+    if (a.isdiagonal_)
+    {
+        if (!a.isUnit_ != !b.isUnit_ || a.nullmodel != b.nullmodel
+                || !equalMatrix(a.sigmas_, b.sigmas_) || !equalMatrix(a.invsigmas_, b.invsigmas_))
+            return false;
+    }
+    else if (!equalMatrix(a.sqrt_information_, b.sqrt_information_))
+    {
+        return false;
+    }
+    const ConstrainedNoiseModel* ca = dynamic_cast<const ConstrainedNoiseModel*>(&a);
+    if (ca != NULL && !equalMatrix(ca->mu(), static_cast<const ConstrainedNoiseModel&>(b).mu()))
+        return false;
+    return true;
+}
+
+NoiseModelPool::NoiseModelPool()
+{
+}
+
+NoiseModelPool::~NoiseModelPool()
+{
+    for (std::unordered_map<const GaussianNoiseModel*, int>::iterator it = counts_.begin(); it != counts_.end(); ++it)
+    {
+        delete it->first;
+    }
+}
+
+GaussianNoiseModel* NoiseModelPool::intern(GaussianNoiseModel* model)
+{
+    if (model == NULL)
+    {
+        throw std::invalid_argument("NoiseModelPool::intern: model is NULL");
+    }
+    std::unordered_map<const GaussianNoiseModel*, int>::iterator count = counts_.find(model);
+    if (count != counts_.end())
+    {
+        count->second++;
+        return model;
+    }
+
+    const size_t key = hash(*model);
+    typedef std::unordered_multimap<size_t, GaussianNoiseModel*>::iterator iterator;
+    std::pair<iterator, iterator> range = models_.equal_range(key);
+    for (iterator it = range.first; it != range.second; ++it)
+    {
+        if (equal(*it->second, *model))
+        {
+            delete model;
+            counts_[it->second]++;
+            return it->second;
+        }
+    }
+    models_.insert(std::make_pair(key, model));
+    counts_.insert(std::make_pair(model, 1));
+    return model;
+}
+
+GaussianNoiseModel* NoiseModelPool::acquire(GaussianNoiseModel* model)
+{
+    std::unordered_map<const GaussianNoiseModel*, int>::iterator count = counts_.find(model);
+    if (count == counts_.end())
+    {
+        throw std::invalid_argument("NoiseModelPool::acquire: model is not pooled");
+    }
+    count->second++;
+    return model;
+}
+
+void NoiseModelPool::release(const GaussianNoiseModel* model)
+{
+    std::unordered_map<const GaussianNoiseModel*, int>::iterator count = counts_.find(model);
+    if (count == counts_.end())
+    {
+        throw std::invalid_argument("NoiseModelPool::release: model is not pooled");
+    }
+    if (--count->second > 0)
+        return;
+    counts_.erase(count);
+
+    typedef std::unordered_multimap<size_t, GaussianNoiseModel*>::iterator iterator;
+    std::pair<iterator, iterator> range = models_.equal_range(hash(*model));
+    for (iterator it = range.first; it != range.second; ++it)
+    {
+        if (it->second == model)
+        {
+            models_.erase(it);
+            break;
+        }
+    }
+    delete model;
+}
+
+int NoiseModelPool::useCount(const GaussianNoiseModel* model) const
+{
+    std::unordered_map<const GaussianNoiseModel*, int>::const_iterator count = counts_.find(model);
+    return count == counts_.end() ? 0 : count->second;
+}
+
+GaussianNoiseModel* NoiseModelPool_InternOrOwn(NoiseModelPool* pool, GaussianNoiseModel* model)
+{
+    return pool != NULL ? pool->intern(model) : model;
+}
+
+void NoiseModelPool_ReleaseOrDelete(NoiseModelPool* pool, const GaussianNoiseModel* model)
+{
+    if (model == NULL)
+        return;
+    if (pool != NULL)
+        pool->release(model);
+    else
+        delete model;
+}
+
+};
@@ -0,0 +1,93 @@
+#ifndef NOISEMODELPOOL_H
+#define NOISEMODELPOOL_H
+
+/**
+ * @file    NoiseModelPool.h
+ * @brief   Interned, reference counted noise models shared between factors
+ */
+
+#include "../linear/NoiseModel.h"
+#include <unordered_map>
+
+namespace minisam
+{
+
+/**
+ * Graphs built from measurements of the same sensor hold one identical noise
+ * model per factor. A NoiseModelPool keeps a single instance per distinct
+ * model, keyed by its content (type, dimension, sigmas, R and mu for
+ * constrained models), and counts how many factors use it:
+ *
+ *   GaussianNoiseModel* model = pool.intern(DiagonalNoiseModelSigmas(sigmas));
+ *   graph.push_back(new BetweenFactor(i, j, measured, model));
+ *   ...
+ *   pool.release(model);   // when the factor is removed
+ *
+ * intern takes ownership of its argument and deletes it when an equal model
+ * is already pooled. Pooled models must be treated as immutable and are
+ * deleted by the pool, which must outlive the factors that use them. They
+ * must not be passed to factors that delete the noise model they are
+ * given: ImuFactor, NonlinearEquality, and PseudorangeFactor and PhaseFactor
+ * of the pppbayestree example. The factors that build their own model,
+ * FixedImuFactor, CombinedImuFactor and GnssEpochFactor, take an optional
+ * pool instead: with one, their model is interned in it and released, not
+ * deleted, with the factor (see NoiseModelPool_InternOrOwn). Robust models
+ * are pooled by identity since their estimators can not be compared.
+ * Linearizations of unconstrained factors are whitened and carry no model,
+ * so they never copy a pooled one.
+ *
+ * The pool is not thread safe, intern models before sharing them across
+ * threads.
+ */
+class NoiseModelPool
+{
+public:
+    NoiseModelPool();
+
+    /// Deletes every pooled model, whatever its reference count
+    ~NoiseModelPool();
+
+    /// The pooled model equal to \c model, with one more reference
+    GaussianNoiseModel* intern(GaussianNoiseModel* model);
+
+    /// Add a reference to a pooled model, returns it
+    GaussianNoiseModel* acquire(GaussianNoiseModel* model);
+
+    /// Drop a reference, the model is deleted with its last one
+    void release(const GaussianNoiseModel* model);
+
+    /// Number of references to \c model, 0 if it is not pooled
+    int useCount(const GaussianNoiseModel* model) const;
+
+    /// Number of distinct pooled models
+    size_t size() const
+    {
+        return counts_.size();
+    }
+
+    /// Content hash used to find equal models
+    static size_t hash(const GaussianNoiseModel& model);
+
+    /// True if \c a and \c b whiten identically, compared bit by bit
+    static bool equal(const GaussianNoiseModel& a, const GaussianNoiseModel& b);
+
+private:
+    NoiseModelPool(const NoiseModelPool&);
+    NoiseModelPool& operator=(const NoiseModelPool&);
+
+    std::unordered_multimap<size_t, GaussianNoiseModel*> models_; ///< content hash -> model
+    std::unordered_map<const GaussianNoiseModel*, int> counts_;   ///< model -> references
+};
+
+/**
+ * The noise model of a factor that builds its own: interned in \c pool, or
+ * \c model itself, owned by the factor, when \c pool is NULL.
+ */
+GaussianNoiseModel* NoiseModelPool_InternOrOwn(NoiseModelPool* pool, GaussianNoiseModel* model);
+
+/// Undo NoiseModelPool_InternOrOwn: release \c model to \c pool, or delete it when \c pool is NULL
+void NoiseModelPool_ReleaseOrDelete(NoiseModelPool* pool, const GaussianNoiseModel* model);
+
+};
+
+#endif // NOISEMODELPOOL_H
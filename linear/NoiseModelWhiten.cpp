@@ -0,0 +1,152 @@
+/**
+ * @file    NoiseModelWhiten.cpp
+ * @brief   Row-scaling fast paths for whitening with diagonal noise models
+ */
+
+#include "NoiseModel.h"
+#include "../gmfconfig.h"
+#include "mEstimator.h"
+
+namespace minisam
+{
+
+/// Diagonal, isotropic and constrained models whiten by scaling rows.
+static bool whitenByRows(const GaussianNoiseModel &model)
+{
+    return model.isdiagonal_ && !model.isUnit_ && model.invsigmas_.size1 == (size_t)model.dim_
+           && dynamic_cast<const RobustNoiseModel*>(&model) == NULL;
+}
+
+/// Scale of row r. Constrained rows have a zero inverse sigma and stay
+/// untouched, which gives a scale of one without a branch.
+static inline double rowScale(const GaussianNoiseModel &model, size_t r)
+{
+    const double inv = model.invsigmas_.data[r * model.invsigmas_.prd];
+    return inv + (double)(inv == 0.0);
+}
+
+MINISAM_CLONES
+static void scaleRow(double *x, size_t n, double s)
+{
+    for (size_t j = 0; j < n; j++)
+    {
+        x[j] *= s;
+    }
+}
+
+static void checkRows(const GaussianNoiseModel &model, const minimatrix *A)
+{
+    if (A->size1 != (size_t)model.dim_)
+    {
+        throw std::invalid_argument("whitening: matrix rows do not match the noise model");
+    }
+}
+
+bool GaussianNoiseModel_RowScales(const GaussianNoiseModel &model, double *scales)
+{
+    if (!model.isUnit_ && !whitenByRows(model))
+        return false;
+    for (int r = 0; r < model.dim_; r++)
+    {
+        scales[r] = model.isUnit_ ? 1.0 : rowScale(model, r);
+    }
+    return true;
+}
+
+void GaussianNoiseModel_WhitenInPlace(const GaussianNoiseModel &model, minimatrix *H)
+{
+    if (model.isUnit_)
+        return;
+    if (!whitenByRows(model))
+    {
+        model.WhitenInPlace(*H);
+        return;
+    }
+    checkRows(model, H);
+    for (size_t r = 0; r < H->size1; r++)
+    {
+        scaleRow(H->data + r * H->prd, H->size2, rowScale(model, r));
+    }
+}
+
+void GaussianNoiseModel_WhitenSystem(const GaussianNoiseModel &model, minimatrix *A, minivector *b)
+{
+    if (model.isUnit_)
+        return;
+    if (!whitenByRows(model))
+    {
+        model.WhitenSystem(*A, *b);
+        return;
+    }
+    checkRows(model, A);
+    checkRows(model, b);
+    for (size_t r = 0; r < A->size1; r++)
+    {
+        const double s = rowScale(model, r);
+        scaleRow(A->data + r * A->prd, A->size2, s);
+        b->data[r * b->prd] *= s;
+    }
+}
+
+void GaussianNoiseModel_WhitenSystem(const GaussianNoiseModel &model, minimatrix *A1, minimatrix *A2, minivector *b)
+{
+    if (model.isUnit_)
+        return;
+    if (!whitenByRows(model))
+    {
+        const RobustNoiseModel *robust = dynamic_cast<const RobustNoiseModel*>(&model);
+        if (robust != NULL)
+        {
+            robust->WhitenSystem(*A1, *A2, *b);
+            return;
+        }
+        model.WhitenInPlace(*A1);
+        model.WhitenInPlace(*A2);
+        model.whitenInPlace(*b);
+        return;
+    }
+    checkRows(model, A1);
+    checkRows(model, A2);
+    checkRows(model, b);
+    for (size_t r = 0; r < A1->size1; r++)
+    {
+        const double s = rowScale(model, r);
+        scaleRow(A1->data + r * A1->prd, A1->size2, s);
+        scaleRow(A2->data + r * A2->prd, A2->size2, s);
+        b->data[r * b->prd] *= s;
+    }
+}
+
+void GaussianNoiseModel_WhitenSystem(const GaussianNoiseModel &model, minimatrix *A1, minimatrix *A2, minimatrix *A3, minivector *b)
+{
+    if (model.isUnit_)
+        return;
+    if (!whitenByRows(model))
+    {
+        const RobustNoiseModel *robust = dynamic_cast<const RobustNoiseModel*>(&model);
+        if (robust != NULL)
+        {
+            robust->WhitenSystem(*A1, *A2, *A3, *b);
+            return;
+        }
+        model.WhitenInPlace(*A1);
+        model.WhitenInPlace(*A2);
+        model.WhitenInPlace(*A3);
+        model.whitenInPlace(*b);
+        return;
+    }
+    checkRows(model, A1);
+    checkRows(model, A2);
+    checkRows(model, A3);
+    checkRows(model, b);
+    for (size_t r = 0; r < A1->size1; r++)
+    {
+        const double s = rowScale(model, r);
+        scaleRow(A1->data + r * A1->prd, A1->size2, s);
+        scaleRow(A2->data + r * A2->prd, A2->size2, s);
+        scaleRow(A3->data + r * A3->prd, A3->size2, s);
+        b->data[r * b->prd] *= s;
+    }
+}
+
+};
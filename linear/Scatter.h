@@ -7,6 +7,7 @@
  */
 
 #include "../linear/GaussianFactorGraph.h"
+#include <unordered_map>
 
 namespace minisam
 {
@@ -55,5 +56,41 @@ private:
     /// Find the SlotEntry with the right key (linear time worst case)
     iterator find(int key);
 };
+
+/**
+ * Constant time lookup of the slot and the column offset of a key in the
+ * information matrix laid out by a Scatter. Dense key ranges are indexed
+ * directly, sparse ones (e.g. symbol keys) fall back to a hash map.
+ */
+class SlotMap
+{
+public:
+    explicit SlotMap(const Scatter& scatter);
+
+    /// Slot of the key, -1 if the key is not in the scatter
+    int slot(int key) const;
+
+    /// Number of slots, the augmented column sits in slot size()
+    int size() const
+    {
+        return (int)dims_.size();
+    }
+    int dim(int slot) const
+    {
+        return dims_[slot];
+    }
+    /// Column offset of a slot, offset(size()) is the augmented column
+    int offset(int slot) const
+    {
+        return offsets_[slot];
+    }
+
+private:
+    int minKey_;
+    std::vector<int> direct_;                 // slot by key - minKey_, if the keys are dense
+    std::unordered_map<int, int> sparse_;     // slot by key otherwise
+    std::vector<int> dims_;
+    std::vector<int> offsets_;
+};
 };
 #endif // SCATTER_H
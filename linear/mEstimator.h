@@ -33,6 +33,17 @@ namespace minisam
          */
         virtual double weight(double error) const{ return 0;}
 
+        /** weights of n errors at once, the estimators with a closed form weight
+         * (Huber, Cauchy, Tukey, GemanMcClure, DCS) use a vectorized kernel, the
+         * others call weight(double) per error */
+        void weights(const double *error, double *w, size_t n) const;
+
+        /** square roots of weights(error, w, n) */
+        void sqrtWeights(const double *error, double *w, size_t n) const;
+
+        /** how the rows are reweighted */
+        ReweightScheme reweightScheme() const { return reweight_; }
+
 
         double sqrtWeight(double error) const {
           return std::sqrt(weight(error));
@@ -96,6 +107,7 @@ namespace minisam
         double weight(double error) const {
           return (error < k_) ? (1.0) : (k_ / fabs(error));
         }
+        void weights(const double *error, double *w, size_t n) const;
         static Huber_mEstimator* Create(double k, const ReweightScheme reweight = Block) ;
 
       };
@@ -115,6 +127,7 @@ namespace minisam
         double weight(double error) const {
           return ksquared_ / (ksquared_ + error*error);
         }
+        void weights(const double *error, double *w, size_t n) const;
         static Cauchy_mEstimator* Create(double k, const ReweightScheme reweight = Block) ;
 
       };
@@ -134,6 +147,7 @@ namespace minisam
           }
           return 0.0;
         }
+        void weights(const double *error, double *w, size_t n) const;
         static Tukey_mEstimator* Create(double k, const ReweightScheme reweight = Block) ;
 
       };
@@ -166,6 +180,7 @@ namespace minisam
         GemanMcClure_mEstimator(double c = 1.0, const ReweightScheme reweight = Block);
         virtual ~GemanMcClure_mEstimator() {}
         virtual double weight(double error) const;
+        void weights(const double *error, double *w, size_t n) const;
         static GemanMcClure_mEstimator* Create(double k, const ReweightScheme reweight = Block) ;
 
       protected:
@@ -184,6 +199,7 @@ namespace minisam
         DCS_mEstimator(double c = 1.0, const ReweightScheme reweight = Block);
         virtual ~DCS_mEstimator() {}
         virtual double weight(double error) const;
+        void weights(const double *error, double *w, size_t n) const;
         static DCS_mEstimator* Create(double k, const ReweightScheme reweight = Block) ;
 
       protected:
@@ -296,6 +312,12 @@ namespace minisam
       virtual void WhitenSystem(minimatrix& A1, minimatrix& A2, minivector& b) const;
       virtual void WhitenSystem(minimatrix& A1, minimatrix& A2, minimatrix& A3, minivector& b) const;
 
+      /** WhitenSystem(A, b) touching each entry of A once: the residual is
+       * whitened and weighted first, then each row of the blocks is scaled by
+       * its whitening and robust weight together. With a full noise model the
+       * blocks are whitened first and weighted in a second pass. */
+      void WhitenReweight(std::vector<minimatrix>& A, minivector& b) const;
+
       static RobustNoiseModel* Create(
         Base_mEstimator* robust, GaussianNoiseModel* noise);
 
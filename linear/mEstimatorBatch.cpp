@@ -0,0 +1,217 @@
+/**
+ * @file    mEstimatorBatch.cpp
+ * @brief   Vectorized robust weights and fused whitening with reweighting
+ */
+
+#include "mEstimator.h"
+#include "../gmfconfig.h"
+#include "../mat/Matrix.h"
+#include <math.h>
+#include <typeinfo>
+
+namespace minisam
+{
+
+// The kernels compute both sides of every case and select, which keeps the
+// loops free of branches so they vectorize. Results match weight(double).
+
+MINISAM_CLONES
+static void huberWeights(double k, const double *e, double *w, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        const double outlier = k / fabs(e[i]);
+        w[i] = (e[i] < k) ? 1.0 : outlier;
+    }
+}
+
+MINISAM_CLONES
+static void cauchyWeights(double ksquared, const double *e, double *w, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        w[i] = ksquared / (ksquared + e[i] * e[i]);
+    }
+}
+
+MINISAM_CLONES
+static void tukeyWeights(double c, double csquared, const double *e, double *w, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        const double xc2 = e[i] * e[i] / csquared;
+        const double inlier = (1.0 - xc2) * (1.0 - xc2);
+        w[i] = (fabs(e[i]) <= c) ? inlier : 0.0;
+    }
+}
+
+MINISAM_CLONES
+static void gemanMcClureWeights(double c, const double *e, double *w, size_t n)
+{
+    const double c2 = c * c;
+    for (size_t i = 0; i < n; i++)
+    {
+        const double c2error = c2 + e[i] * e[i];
+        w[i] = c2 * c2 / (c2error * c2error);
+    }
+}
+
+MINISAM_CLONES
+static void dcsWeights(double c, const double *e, double *w, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        const double e2 = e[i] * e[i];
+        const double s = 2.0 * c / (c + e2);
+        w[i] = (e2 > c) ? s * s : 1.0;
+    }
+}
+
+MINISAM_CLONES
+static void sqrtInPlace(double *w, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        w[i] = sqrt(w[i]);
+    }
+}
+
+void Huber_mEstimator::weights(const double *error, double *w, size_t n) const
+{
+    huberWeights(k_, error, w, n);
+}
+
+void Cauchy_mEstimator::weights(const double *error, double *w, size_t n) const
+{
+    cauchyWeights(ksquared_, error, w, n);
+}
+
+void Tukey_mEstimator::weights(const double *error, double *w, size_t n) const
+{
+    tukeyWeights(c_, csquared_, error, w, n);
+}
+
+void GemanMcClure_mEstimator::weights(const double *error, double *w, size_t n) const
+{
+    gemanMcClureWeights(c_, error, w, n);
+}
+
+void DCS_mEstimator::weights(const double *error, double *w, size_t n) const
+{
+    dcsWeights(c_, error, w, n);
+}
+
+void Base_mEstimator::weights(const double *error, double *w, size_t n) const
+{
+    // exact type match, a subclass may override weight(double)
+    const std::type_info& type = typeid(*this);
+    if (type == typeid(Huber_mEstimator))
+        static_cast<const Huber_mEstimator*>(this)->weights(error, w, n);
+    else if (type == typeid(Cauchy_mEstimator))
+        static_cast<const Cauchy_mEstimator*>(this)->weights(error, w, n);
+    else if (type == typeid(Tukey_mEstimator))
+        static_cast<const Tukey_mEstimator*>(this)->weights(error, w, n);
+    else if (type == typeid(GemanMcClure_mEstimator))
+        static_cast<const GemanMcClure_mEstimator*>(this)->weights(error, w, n);
+    else if (type == typeid(DCS_mEstimator))
+        static_cast<const DCS_mEstimator*>(this)->weights(error, w, n);
+    else
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            w[i] = weight(error[i]);
+        }
+    }
+}
+
+void Base_mEstimator::sqrtWeights(const double *error, double *w, size_t n) const
+{
+    weights(error, w, n);
+    sqrtInPlace(w, n);
+}
+
+/// Rows of the factors linearized together are few, larger ones use the heap.
+#define WHITENREWEIGHT_STACK_ROWS 32
+
+void RobustNoiseModel::WhitenReweight(std::vector<minimatrix>& A, minivector& b) const
+{
+    const size_t m = b.size1;
+    for (size_t i = 0; i < A.size(); i++)
+    {
+        if (A[i].size1 != m)
+        {
+            throw std::invalid_argument("RobustNoiseModel::WhitenReweight: blocks and b have different rows");
+        }
+    }
+    double stack[2 * WHITENREWEIGHT_STACK_ROWS];
+    std::vector<double> heap;
+    double *scales = stack;
+    if (m > WHITENREWEIGHT_STACK_ROWS)
+    {
+        heap.resize(2 * m);
+        scales = heap.data();
+    }
+    double *sqrtw = scales + m;
+
+    // whiten the residual, the blocks too when the model does not scale rows
+    if (m == (size_t)noise_->dim() && GaussianNoiseModel_RowScales(*noise_, scales))
+    {
+        for (size_t r = 0; r < m; r++)
+        {
+            b.data[r * b.prd] *= scales[r];
+        }
+    }
+    else
+    {
+        noise_->WhitenSystem(A, b);
+        for (size_t r = 0; r < m; r++)
+        {
+            scales[r] = 1.0;
+        }
+    }
+
+    if (robust_->reweightScheme() == Base_mEstimator::Scalar)
+    {
+        if (b.prd == 1)
+        {
+            robust_->sqrtWeights(b.data, sqrtw, m);
+        }
+        else
+        {
+            for (size_t r = 0; r < m; r++)
+            {
+                sqrtw[r] = b.data[r * b.prd];
+            }
+            robust_->sqrtWeights(sqrtw, sqrtw, m);
+        }
+    }
+    else
+    {
+        const double w = robust_->sqrtWeight(norm2d(b));
+        for (size_t r = 0; r < m; r++)
+        {
+            sqrtw[r] = w;
+        }
+    }
+
+    for (size_t i = 0; i < A.size(); i++)
+    {
+        minimatrix& Ai = A[i];
+        for (size_t r = 0; r < m; r++)
+        {
+            double *row = Ai.data + r * Ai.prd;
+            const double s = scales[r];
+            const double w = sqrtw[r];
+            for (size_t j = 0; j < Ai.size2; j++)
+            {
+                row[j] = row[j] * s * w;
+            }
+        }
+    }
+    for (size_t r = 0; r < m; r++)
+    {
+        b.data[r * b.prd] *= sqrtw[r];
+    }
+}
+
+};
@@ -0,0 +1,301 @@
+#ifndef DUAL_H
+#define DUAL_H
+
+/**
+ * @file    Dual.h
+ * @brief   Dual numbers for forward-mode automatic differentiation
+ */
+
+#include <math.h>
+
+namespace minisam
+{
+
+/**
+ * A value and its derivatives with respect to N inputs, a + sum_i v[i]*eps_i
+ * with eps_i*eps_j = 0. Arithmetic and the math functions below apply the
+ * chain rule to v, so a function written once for a template scalar T gives
+ * its value with T = double and its value and gradient with T = Dual<N>.
+ *
+ * N is a compile-time constant: the derivative array lives on the stack and
+ * every loop over it is unrolled, so one evaluation with Dual<N> costs a few
+ * times the double evaluation, independently of how the function is written.
+ */
+template<int N>
+struct Dual
+{
+    double a;       ///< value
+    double v[N];    ///< derivatives
+
+    Dual() : a(0.0)
+    {
+        for (int i = 0; i < N; i++)
+            v[i] = 0.0;
+    }
+
+    /// a constant
+    Dual(double value) : a(value)
+    {
+        for (int i = 0; i < N; i++)
+            v[i] = 0.0;
+    }
+
+    /// the input \c k with value \c value, d/d input_k = 1
+    Dual(double value, int k) : a(value)
+    {
+        for (int i = 0; i < N; i++)
+            v[i] = 0.0;
+        v[k] = 1.0;
+    }
+
+    Dual& operator+=(const Dual& b)
+    {
+        a += b.a;
+        for (int i = 0; i < N; i++)
+            v[i] += b.v[i];
+        return *this;
+    }
+    Dual& operator-=(const Dual& b)
+    {
+        a -= b.a;
+        for (int i = 0; i < N; i++)
+            v[i] -= b.v[i];
+        return *this;
+    }
+    Dual& operator*=(const Dual& b)
+    {
+        for (int i = 0; i < N; i++)
+            v[i] = v[i] * b.a + a * b.v[i];
+        a *= b.a;
+        return *this;
+    }
+    Dual& operator/=(const Dual& b)
+    {
+        const double inv = 1.0 / b.a;
+        a *= inv;
+        for (int i = 0; i < N; i++)
+            v[i] = (v[i] - a * b.v[i]) * inv;
+        return *this;
+    }
+    Dual& operator+=(double b)
+    {
+        a += b;
+        return *this;
+    }
+    Dual& operator-=(double b)
+    {
+        a -= b;
+        return *this;
+    }
+    Dual& operator*=(double b)
+    {
+        a *= b;
+        for (int i = 0; i < N; i++)
+            v[i] *= b;
+        return *this;
+    }
+    Dual& operator/=(double b)
+    {
+        return *this *= 1.0 / b;
+    }
+};
+
+/// f(a) with f'(a) = d, the chain rule for the unary functions
+template<int N>
+inline Dual<N> Dual_chain(const Dual<N>& x, double f, double d)
+{
+    Dual<N> r(f);
+    for (int i = 0; i < N; i++)
+        r.v[i] = d * x.v[i];
+    return r;
+}
+
+template<int N> inline Dual<N> operator+(const Dual<N>& x)
+{
+    return x;
+}
+template<int N> inline Dual<N> operator-(const Dual<N>& x)
+{
+    return Dual_chain(x, -x.a, -1.0);
+}
+
+template<int N> inline Dual<N> operator+(Dual<N> x, const Dual<N>& y)
+{
+    return x += y;
+}
+template<int N> inline Dual<N> operator+(Dual<N> x, double y)
+{
+    return x += y;
+}
+template<int N> inline Dual<N> operator+(double x, Dual<N> y)
+{
+    return y += x;
+}
+
+template<int N> inline Dual<N> operator-(Dual<N> x, const Dual<N>& y)
+{
+    return x -= y;
+}
+template<int N> inline Dual<N> operator-(Dual<N> x, double y)
+{
+    return x -= y;
+}
+template<int N> inline Dual<N> operator-(double x, const Dual<N>& y)
+{
+    return Dual_chain(y, x - y.a, -1.0);
+}
+
+template<int N> inline Dual<N> operator*(Dual<N> x, const Dual<N>& y)
+{
+    return x *= y;
+}
+template<int N> inline Dual<N> operator*(Dual<N> x, double y)
+{
+    return x *= y;
+}
+template<int N> inline Dual<N> operator*(double x, Dual<N> y)
+{
+    return y *= x;
+}
+
+template<int N> inline Dual<N> operator/(Dual<N> x, const Dual<N>& y)
+{
+    return x /= y;
+}
+template<int N> inline Dual<N> operator/(Dual<N> x, double y)
+{
+    return x /= y;
+}
+template<int N> inline Dual<N> operator/(double x, const Dual<N>& y)
+{
+    const double r = x / y.a;
+    return Dual_chain(y, r, -r / y.a);
+}
+
+// comparisons look at the value only, so branches in templated code pick the same side as with double
+template<int N> inline bool operator<(const Dual<N>& x, const Dual<N>& y)
+{
+    return x.a < y.a;
+}
+template<int N> inline bool operator<(const Dual<N>& x, double y)
+{
+    return x.a < y;
+}
+template<int N> inline bool operator<(double x, const Dual<N>& y)
+{
+    return x < y.a;
+}
+template<int N> inline bool operator>(const Dual<N>& x, const Dual<N>& y)
+{
+    return x.a > y.a;
+}
+template<int N> inline bool operator>(const Dual<N>& x, double y)
+{
+    return x.a > y;
+}
+template<int N> inline bool operator>(double x, const Dual<N>& y)
+{
+    return x > y.a;
+}
+template<int N> inline bool operator<=(const Dual<N>& x, const Dual<N>& y)
+{
+    return x.a <= y.a;
+}
+template<int N> inline bool operator<=(const Dual<N>& x, double y)
+{
+    return x.a <= y;
+}
+template<int N> inline bool operator>=(const Dual<N>& x, const Dual<N>& y)
+{
+    return x.a >= y.a;
+}
+template<int N> inline bool operator>=(const Dual<N>& x, double y)
+{
+    return x.a >= y;
+}
+
+// keep the double versions visible next to the overloads, templated code calls them unqualified
+using ::sqrt;
+using ::exp;
+using ::log;
+using ::pow;
+using ::fabs;
+using ::sin;
+using ::cos;
+using ::tan;
+using ::asin;
+using ::acos;
+using ::atan;
+using ::atan2;
+
+template<int N> inline Dual<N> sqrt(const Dual<N>& x)
+{
+    const double s = ::sqrt(x.a);
+    return Dual_chain(x, s, 0.5 / s);
+}
+template<int N> inline Dual<N> exp(const Dual<N>& x)
+{
+    const double e = ::exp(x.a);
+    return Dual_chain(x, e, e);
+}
+template<int N> inline Dual<N> log(const Dual<N>& x)
+{
+    return Dual_chain(x, ::log(x.a), 1.0 / x.a);
+}
+template<int N> inline Dual<N> pow(const Dual<N>& x, double p)
+{
+    const double f = ::pow(x.a, p);
+    return Dual_chain(x, f, p * ::pow(x.a, p - 1.0));
+}
+template<int N> inline Dual<N> fabs(const Dual<N>& x)
+{
+    return x.a < 0.0 ? -x : x;
+}
+template<int N> inline Dual<N> sin(const Dual<N>& x)
+{
+    return Dual_chain(x, ::sin(x.a), ::cos(x.a));
+}
+template<int N> inline Dual<N> cos(const Dual<N>& x)
+{
+    return Dual_chain(x, ::cos(x.a), -::sin(x.a));
+}
+template<int N> inline Dual<N> tan(const Dual<N>& x)
+{
+    const double t = ::tan(x.a);
+    return Dual_chain(x, t, 1.0 + t * t);
+}
+template<int N> inline Dual<N> asin(const Dual<N>& x)
+{
+    return Dual_chain(x, ::asin(x.a), 1.0 / ::sqrt(1.0 - x.a * x.a));
+}
+template<int N> inline Dual<N> acos(const Dual<N>& x)
+{
+    return Dual_chain(x, ::acos(x.a), -1.0 / ::sqrt(1.0 - x.a * x.a));
+}
+template<int N> inline Dual<N> atan(const Dual<N>& x)
+{
+    return Dual_chain(x, ::atan(x.a), 1.0 / (1.0 + x.a * x.a));
+}
+template<int N> inline Dual<N> atan2(const Dual<N>& y, const Dual<N>& x)
+{
+    // d atan2(y, x) = (x dy - y dx) / (x^2 + y^2)
+    const double inv = 1.0 / (x.a * x.a + y.a * y.a);
+    Dual<N> r(::atan2(y.a, x.a));
+    for (int i = 0; i < N; i++)
+        r.v[i] = (x.a * y.v[i] - y.a * x.v[i]) * inv;
+    return r;
+}
+
+/// the value of a double or a Dual, for code templated on the scalar
+inline double Dual_value(double x)
+{
+    return x;
+}
+template<int N> inline double Dual_value(const Dual<N>& x)
+{
+    return x.a;
+}
+
+};
+
+#endif // DUAL_H
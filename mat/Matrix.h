@@ -105,6 +105,8 @@ bool equal_with_abs_tol(const minimatrix *A, const minimatrix *B, double tol = 1
 bool equal_with_abs_tol(const minimatrix& A, const minimatrix& B, double tol = 1e-9);
 
 void backSubstituteUpper(const minimatrix& U, const minivector& b, minivector *x);
+/// Solve U*X = B for all columns of B at once, X must be preallocated with the size of B
+void backSubstituteUpper(const minimatrix& U, const minimatrix& B, minimatrix *X);
 
 void inplace_QR(minimatrix* A);
 
@@ -0,0 +1,29 @@
+/**
+ * @file    MatrixSolve.cpp
+ * @brief   Triangular solves with a matrix of right-hand sides
+ */
+
+#include "Matrix.h"
+#include "../miniblas/miniblas_backend.h"
+
+namespace minisam
+{
+
+void backSubstituteUpper(const minimatrix& U, const minimatrix& B, minimatrix *X)
+{
+    if (U.size1 != U.size2)
+    {
+        throw std::invalid_argument("backSubstituteUpper: U must be square");
+    }
+    if (B.size1 != U.size1 || X->size1 != B.size1 || X->size2 != B.size2)
+    {
+        throw std::invalid_argument("backSubstituteUpper: U, B and X do not match");
+    }
+    if (X->data != B.data)
+    {
+        minimatrix_memcpy(X, B);
+    }
+    miniblas_get_backend()->dtrsm(blasLeft, blasUpper, blasNoTrans, blasNonUnit, 1.0, U, X);
+}
+
+};
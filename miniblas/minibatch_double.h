@@ -0,0 +1,86 @@
+#ifndef __MINIBATCH_DOUBLE_H__
+#define __MINIBATCH_DOUBLE_H__
+
+/**
+ * @file    minibatch_double.h
+ * @brief   Batches of same-sized small matrices in structure-of-arrays layout.
+ *
+ * The geometry code multiplies thousands of independent 3x3 and 6x6 matrices
+ * per linearization. A minibatch stores `count` matrices of size1 x size2
+ * element-major: element (i,j) of matrix b is
+ *
+ *   data[(i*size2 + j)*stride + b]
+ *
+ * so the same element of all matrices is contiguous and the batch kernels
+ * below vectorize across the batch instead of inside one tiny product.
+ * stride is count rounded up to MINIBATCH_LANES, the padding starts out zero.
+ */
+
+#include "miniblas.h"
+
+#define MINIBATCH_LANES 8
+
+struct minibatch
+{
+    size_t size1;
+    size_t size2;
+    size_t count;
+    size_t stride;
+    double * data;
+    int owner;
+
+    minibatch():size1(0),size2(0),count(0),stride(0),data(NULL),owner(0)
+    {
+
+    }
+    minibatch(size_t m, size_t n, size_t c):size1(m),size2(n),count(c),
+        stride((c + MINIBATCH_LANES - 1) / MINIBATCH_LANES * MINIBATCH_LANES),owner(1)
+    {
+        data=(double *) calloc (m*n*stride, sizeof (double));
+    }
+    ~minibatch()
+    {
+        if(owner==1&&data!=NULL)
+        {
+            free(data);
+            owner=0;
+        }
+    }
+
+    /// first element of the SoA row holding element (i,j) of every matrix
+    double * element(size_t i, size_t j)
+    {
+        return data + (i * size2 + j) * stride;
+    }
+    const double * element(size_t i, size_t j) const
+    {
+        return data + (i * size2 + j) * stride;
+    }
+
+private:
+    minibatch(const minibatch&);
+    minibatch& operator=(const minibatch&);
+};
+
+/// Copy matrix m into slot b of the batch, and back.
+void minibatch_set(minibatch * batch, size_t b, const minimatrix& m);
+void minibatch_get(const minibatch& batch, size_t b, minimatrix * m);
+void minibatch_set_zero(minibatch * batch);
+int minibatch_memcpy(minibatch * dest, const minibatch& src);
+
+/// W_b = [w_b]x for a batch of 3x1 vectors w and 3x3 results W.
+void minibatch_skewSymmetric(const minibatch& w, minibatch * W);
+
+/**
+ * C_b = alpha*op(A_b)*op(B_b) + beta*C_b for every matrix b of the batch.
+ * The sizes are checked once for the whole batch, a beta of zero clears C.
+ */
+int miniblas_batch_dgemm(MINIBLAS_TRANS TransA,
+                         MINIBLAS_TRANS TransB,
+                         double alpha,
+                         const minibatch& A,
+                         const minibatch& B,
+                         double beta,
+                         minibatch * C);
+
+#endif
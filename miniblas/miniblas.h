@@ -8,6 +8,7 @@
 enum MINIBLAS_TRANS {blasNoTrans=11, blasTrans=12};
 enum MINIBLAS_UPORLOWER {blasUpper=21, blasLower=22};
 enum MINIBLAS_UNIT {blasNonUnit=31, blasUnit=32};
+enum MINIBLAS_SIDE {blasLeft=41, blasRight=42};
 
 /*
  * Level 1
@@ -80,5 +81,12 @@ int  miniblas_dsyrk (MINIBLAS_UPORLOWER Uplo,
                      double beta,
                      minimatrix * C);
 
+int  miniblas_dtrsm (MINIBLAS_SIDE Side,
+                     MINIBLAS_UPORLOWER Uplo,
+                     MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+                     double alpha,
+                     const minimatrix& A,
+                     minimatrix * B);
+
 
 #endif
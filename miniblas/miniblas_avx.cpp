@@ -0,0 +1,757 @@
+/**
+ * @file    miniblas_avx.cpp
+ * @brief   AVX2 and AVX-512 kernels of the miniblas backend table.
+ *
+ * Every kernel carries its own target attribute, so this file is compiled
+ * with the ordinary flags and the tables are only handed out after the CPU
+ * has been checked. The AVX-512 table overrides the level-3 kernels and
+ * shares the AVX2 triangular solves and factorizations.
+ */
+
+#include "miniblas_backend.h"
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MINIBLAS_HAVE_X86_KERNELS
+#endif
+
+#ifdef MINIBLAS_HAVE_X86_KERNELS
+
+#include <immintrin.h>
+
+#define MINIBLAS_AVX2 __attribute__((target("avx2,fma")))
+#define MINIBLAS_AVX512 __attribute__((target("avx512f,avx2,fma")))
+
+/*
+ * AVX2 row primitives, all on contiguous data
+ */
+
+MINIBLAS_AVX2 static inline double avx2_hsum(__m256d v)
+{
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    __m128d h = _mm_unpackhi_pd(lo, lo);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, h));
+}
+
+MINIBLAS_AVX2 static double avx2_dot(const double * x, const double * y, size_t n)
+{
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8)
+    {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + k), _mm256_loadu_pd(y + k), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + k + 4), _mm256_loadu_pd(y + k + 4), s1);
+    }
+    for (; k + 4 <= n; k += 4)
+    {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + k), _mm256_loadu_pd(y + k), s0);
+    }
+    double r = avx2_hsum(_mm256_add_pd(s0, s1));
+    for (; k < n; k++)
+    {
+        r += x[k] * y[k];
+    }
+    return r;
+}
+
+/// y += a*x
+MINIBLAS_AVX2 static void avx2_axpy(double a, const double * x, double * y, size_t n)
+{
+    const __m256d va = _mm256_set1_pd(a);
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4)
+    {
+        _mm256_storeu_pd(y + k, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + k), _mm256_loadu_pd(y + k)));
+    }
+    for (; k < n; k++)
+    {
+        y[k] += a * x[k];
+    }
+}
+
+/// x *= a, a zero factor clears x (BLAS beta semantics)
+MINIBLAS_AVX2 static void avx2_scal(double a, double * x, size_t n)
+{
+    size_t k = 0;
+    if (a == 0.0)
+    {
+        for (; k < n; k++)
+        {
+            x[k] = 0.0;
+        }
+        return;
+    }
+    const __m256d va = _mm256_set1_pd(a);
+    for (; k + 4 <= n; k += 4)
+    {
+        _mm256_storeu_pd(x + k, _mm256_mul_pd(va, _mm256_loadu_pd(x + k)));
+    }
+    for (; k < n; k++)
+    {
+        x[k] *= a;
+    }
+}
+
+/// c = alpha*acc + beta*c
+MINIBLAS_AVX2 static inline __m256d avx2_combine(__m256d acc, __m256d va, __m256d vb,
+        double beta, const double * c)
+{
+    if (beta == 0.0)
+    {
+        return _mm256_mul_pd(va, acc);
+    }
+    return _mm256_fmadd_pd(vb, _mm256_loadu_pd(c), _mm256_mul_pd(va, acc));
+}
+
+/**
+ * One row of C = alpha*op(A)*op(B) + beta*C. The row of op(A) is read with
+ * stride inca, op(B) is row-major K x N with leading dimension ldb.
+ */
+MINIBLAS_AVX2 static void avx2_gemm_row(size_t K, size_t N,
+                                        const double * a, size_t inca,
+                                        const double * b, size_t ldb,
+                                        double alpha, double beta, double * c)
+{
+    const __m256d va = _mm256_set1_pd(alpha);
+    const __m256d vb = _mm256_set1_pd(beta);
+    size_t j = 0;
+    for (; j + 16 <= N; j += 16)
+    {
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+        __m256d acc2 = _mm256_setzero_pd();
+        __m256d acc3 = _mm256_setzero_pd();
+        for (size_t k = 0; k < K; k++)
+        {
+            const __m256d aik = _mm256_set1_pd(a[k * inca]);
+            const double * bk = b + k * ldb + j;
+            acc0 = _mm256_fmadd_pd(aik, _mm256_loadu_pd(bk), acc0);
+            acc1 = _mm256_fmadd_pd(aik, _mm256_loadu_pd(bk + 4), acc1);
+            acc2 = _mm256_fmadd_pd(aik, _mm256_loadu_pd(bk + 8), acc2);
+            acc3 = _mm256_fmadd_pd(aik, _mm256_loadu_pd(bk + 12), acc3);
+        }
+        _mm256_storeu_pd(c + j, avx2_combine(acc0, va, vb, beta, c + j));
+        _mm256_storeu_pd(c + j + 4, avx2_combine(acc1, va, vb, beta, c + j + 4));
+        _mm256_storeu_pd(c + j + 8, avx2_combine(acc2, va, vb, beta, c + j + 8));
+        _mm256_storeu_pd(c + j + 12, avx2_combine(acc3, va, vb, beta, c + j + 12));
+    }
+    for (; j + 4 <= N; j += 4)
+    {
+        __m256d acc = _mm256_setzero_pd();
+        for (size_t k = 0; k < K; k++)
+        {
+            acc = _mm256_fmadd_pd(_mm256_set1_pd(a[k * inca]), _mm256_loadu_pd(b + k * ldb + j), acc);
+        }
+        _mm256_storeu_pd(c + j, avx2_combine(acc, va, vb, beta, c + j));
+    }
+    for (; j < N; j++)
+    {
+        double acc = 0.0;
+        for (size_t k = 0; k < K; k++)
+        {
+            acc += a[k * inca] * b[k * ldb + j];
+        }
+        c[j] = (beta == 0.0) ? alpha * acc : alpha * acc + beta * c[j];
+    }
+}
+
+/// Copy op(B) into a contiguous row-major K x N buffer when B is transposed.
+static const double * gemm_pack_B(MINIBLAS_TRANS TransB, const minimatrix& B,
+                                  size_t K, size_t N, std::vector<double>& buffer, size_t * ldb)
+{
+    if (TransB == blasNoTrans)
+    {
+        *ldb = B.prd;
+        return B.data;
+    }
+    buffer.resize(K * N);
+    for (size_t j = 0; j < N; j++)
+    {
+        const double * bj = B.data + j * B.prd;
+        for (size_t k = 0; k < K; k++)
+        {
+            buffer[k * N + j] = bj[k];
+        }
+    }
+    *ldb = N;
+    return buffer.data();
+}
+
+static void gemm_check(MINIBLAS_TRANS TransA, MINIBLAS_TRANS TransB,
+                       const minimatrix& A, const minimatrix& B, const minimatrix * C, size_t * K)
+{
+    const size_t MA = (TransA == blasNoTrans) ? A.size1 : A.size2;
+    const size_t NA = (TransA == blasNoTrans) ? A.size2 : A.size1;
+    const size_t MB = (TransB == blasNoTrans) ? B.size1 : B.size2;
+    const size_t NB = (TransB == blasNoTrans) ? B.size2 : B.size1;
+
+    if (C->size1 != MA || C->size2 != NB || NA != MB)
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    *K = NA;
+}
+
+MINIBLAS_AVX2 static int avx2_dgemm(MINIBLAS_TRANS TransA,
+                                    MINIBLAS_TRANS TransB,
+                                    double alpha,
+                                    const minimatrix& A,
+                                    const minimatrix& B,
+                                    double beta,
+                                    minimatrix * C)
+{
+    size_t K;
+    gemm_check(TransA, TransB, A, B, C, &K);
+    const size_t M = C->size1;
+    const size_t N = C->size2;
+
+    if (alpha == 0.0 || K == 0)
+    {
+        for (size_t i = 0; i < M; i++)
+        {
+            avx2_scal(beta, C->data + i * C->prd, N);
+        }
+        return MINI_SUCCESS;
+    }
+
+    std::vector<double> buffer;
+    size_t ldb;
+    const double * b = gemm_pack_B(TransB, B, K, N, buffer, &ldb);
+
+    for (size_t i = 0; i < M; i++)
+    {
+        const double * a = (TransA == blasNoTrans) ? A.data + i * A.prd : A.data + i;
+        const size_t inca = (TransA == blasNoTrans) ? 1 : A.prd;
+        avx2_gemm_row(K, N, a, inca, b, ldb, alpha, beta, C->data + i * C->prd);
+    }
+    return MINI_SUCCESS;
+}
+
+static void syrk_check(MINIBLAS_TRANS Trans, const minimatrix& A, const minimatrix * C, size_t * K)
+{
+    if (C->size1 != C->size2)
+    {
+        throw std::invalid_argument("matrix C must be square");
+    }
+    const size_t N = (Trans == blasNoTrans) ? A.size1 : A.size2;
+    if (C->size1 != N)
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    *K = (Trans == blasNoTrans) ? A.size2 : A.size1;
+}
+
+MINIBLAS_AVX2 static int avx2_dsyrk(MINIBLAS_UPORLOWER Uplo,
+                                    MINIBLAS_TRANS Trans,
+                                    double alpha,
+                                    const minimatrix& A,
+                                    double beta,
+                                    minimatrix * C)
+{
+    size_t K;
+    syrk_check(Trans, A, C, &K);
+    const size_t N = C->size1;
+
+    for (size_t i = 0; i < N; i++)
+    {
+        double * ci = C->data + i * C->prd;
+        const size_t j0 = (Uplo == blasUpper) ? i : 0;
+        const size_t j1 = (Uplo == blasUpper) ? N : i + 1;
+
+        if (Trans == blasNoTrans)
+        {
+            const double * ai = A.data + i * A.prd;
+            for (size_t j = j0; j < j1; j++)
+            {
+                const double d = alpha * avx2_dot(ai, A.data + j * A.prd, K);
+                ci[j] = (beta == 0.0) ? d : d + beta * ci[j];
+            }
+        }
+        else
+        {
+            avx2_scal(beta, ci + j0, j1 - j0);
+            if (alpha == 0.0)
+            {
+                continue;
+            }
+            for (size_t k = 0; k < K; k++)
+            {
+                const double * ak = A.data + k * A.prd;
+                avx2_axpy(alpha * ak[i], ak + j0, ci + j0, j1 - j0);
+            }
+        }
+    }
+    return MINI_SUCCESS;
+}
+
+/// Triangular solve on a contiguous vector x of length N.
+MINIBLAS_AVX2 static void avx2_trsv_contiguous(MINIBLAS_UPORLOWER Uplo,
+        MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+        const minimatrix& A, double * x)
+{
+    const size_t N = A.size1;
+    const size_t lda = A.prd;
+    const bool nonunit = (Diag == blasNonUnit);
+
+    if (TransA == blasNoTrans && Uplo == blasUpper)
+    {
+        for (size_t ii = N; ii-- > 0;)
+        {
+            const double * ai = A.data + ii * lda;
+            double r = x[ii] - avx2_dot(ai + ii + 1, x + ii + 1, N - ii - 1);
+            x[ii] = nonunit ? r / ai[ii] : r;
+        }
+    }
+    else if (TransA == blasNoTrans && Uplo == blasLower)
+    {
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            const double * ai = A.data + ii * lda;
+            double r = x[ii] - avx2_dot(ai, x, ii);
+            x[ii] = nonunit ? r / ai[ii] : r;
+        }
+    }
+    else if (Uplo == blasUpper)
+    {
+        /* U' x = b is lower triangular, go forward */
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            const double * ai = A.data + ii * lda;
+            if (nonunit)
+            {
+                x[ii] /= ai[ii];
+            }
+            avx2_axpy(-x[ii], ai + ii + 1, x + ii + 1, N - ii - 1);
+        }
+    }
+    else
+    {
+        /* L' x = b is upper triangular, go backward */
+        for (size_t ii = N; ii-- > 0;)
+        {
+            const double * ai = A.data + ii * lda;
+            if (nonunit)
+            {
+                x[ii] /= ai[ii];
+            }
+            avx2_axpy(-x[ii], ai, x, ii);
+        }
+    }
+}
+
+MINIBLAS_AVX2 static int avx2_dtrsv(MINIBLAS_UPORLOWER Uplo,
+                                    MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+                                    const minimatrix& A,
+                                    minivector * X)
+{
+    if (A.size1 != A.size2)
+    {
+        throw std::invalid_argument("matrix must be square");
+    }
+    if (A.size1 != X->size1)
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    const size_t N = X->size1;
+    if (X->prd == 1)
+    {
+        avx2_trsv_contiguous(Uplo, TransA, Diag, A, X->data);
+        return MINI_SUCCESS;
+    }
+    std::vector<double> x(N);
+    for (size_t i = 0; i < N; i++)
+    {
+        x[i] = X->data[i * X->prd];
+    }
+    avx2_trsv_contiguous(Uplo, TransA, Diag, A, x.data());
+    for (size_t i = 0; i < N; i++)
+    {
+        X->data[i * X->prd] = x[i];
+    }
+    return MINI_SUCCESS;
+}
+
+MINIBLAS_AVX2 static int avx2_dtrsm(MINIBLAS_SIDE Side,
+                                    MINIBLAS_UPORLOWER Uplo,
+                                    MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+                                    double alpha,
+                                    const minimatrix& A,
+                                    minimatrix * B)
+{
+    const size_t M = B->size1;
+    const size_t N = B->size2;
+    if (A.size1 != A.size2)
+    {
+        throw std::invalid_argument("matrix must be square");
+    }
+    if ((Side == blasLeft && A.size1 != M) || (Side == blasRight && A.size1 != N))
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    const size_t lda = A.prd;
+    const size_t ldb = B->prd;
+    const bool nonunit = (Diag == blasNonUnit);
+
+    for (size_t i = 0; i < M; i++)
+    {
+        avx2_scal(alpha, B->data + i * ldb, N);
+    }
+    if (alpha == 0.0)
+    {
+        return MINI_SUCCESS;
+    }
+
+    if (Side == blasRight)
+    {
+        /* X op(A) = B row by row is op(A)' x = b */
+        const MINIBLAS_TRANS flipped = (TransA == blasNoTrans) ? blasTrans : blasNoTrans;
+        for (size_t i = 0; i < M; i++)
+        {
+            avx2_trsv_contiguous(Uplo, flipped, Diag, A, B->data + i * ldb);
+        }
+        return MINI_SUCCESS;
+    }
+
+    /* Left side: whole rows of B are updated at once */
+    const bool backward = (TransA == blasNoTrans) == (Uplo == blasUpper);
+    for (size_t step = 0; step < M; step++)
+    {
+        const size_t i = backward ? M - 1 - step : step;
+        double * bi = B->data + i * ldb;
+        const size_t k0 = backward ? i + 1 : 0;
+        const size_t k1 = backward ? M : i;
+        for (size_t k = k0; k < k1; k++)
+        {
+            const double aik = (TransA == blasNoTrans) ? A.data[i * lda + k] : A.data[k * lda + i];
+            avx2_axpy(-aik, B->data + k * ldb, bi, N);
+        }
+        if (nonunit)
+        {
+            avx2_scal(1.0 / A.data[i * lda + i], bi, N);
+        }
+    }
+    return MINI_SUCCESS;
+}
+
+/// Row oriented Cholesky-Banachiewicz on the lower triangle.
+MINIBLAS_AVX2 static int avx2_cholesky(minimatrix * A)
+{
+    if (A->size1 != A->size2)
+    {
+        throw std::invalid_argument("matrix must be square");
+    }
+    const size_t N = A->size1;
+    const size_t lda = A->prd;
+
+    for (size_t i = 0; i < N; i++)
+    {
+        double * li = A->data + i * lda;
+        for (size_t j = 0; j < i; j++)
+        {
+            const double * lj = A->data + j * lda;
+            li[j] = (li[j] - avx2_dot(li, lj, j)) / lj[j];
+        }
+        const double d = li[i] - avx2_dot(li, li, i);
+        if (!(d > 0.0))
+        {
+            return MINI_FAILURE;
+        }
+        li[i] = sqrt(d);
+    }
+    return MINI_SUCCESS;
+}
+
+/// Householder QR with the reflector layout of minilinalg_Golub_QR_decomp.
+MINIBLAS_AVX2 static int avx2_qr(minimatrix * A, minivector * tau)
+{
+    const size_t M = A->size1;
+    const size_t N = A->size2;
+    const size_t lda = A->prd;
+    const size_t K = miniblas_min(M, N);
+
+    if (tau->size1 != K)
+    {
+        throw std::invalid_argument("size of tau must be MIN(M,N)");
+    }
+
+    std::vector<double> w(N);
+    for (size_t i = 0; i < K; i++)
+    {
+        double * aii = A->data + i * lda + i;
+
+        /* Householder vector of column i, rows i..M-1 */
+        double xnorm2 = 0.0;
+        for (size_t r = i + 1; r < M; r++)
+        {
+            const double v = A->data[r * lda + i];
+            xnorm2 += v * v;
+        }
+        double t = 0.0;
+        if (xnorm2 != 0.0)
+        {
+            const double alpha = *aii;
+            const double beta = -(alpha >= 0.0 ? +1.0 : -1.0) * hypot(alpha, sqrt(xnorm2));
+            t = (beta - alpha) / beta;
+            double s = alpha - beta;
+            double scale = (fabs(s) > DBL_MIN) ? 1.0 / s : (DBL_EPSILON / s) / DBL_EPSILON;
+            for (size_t r = i + 1; r < M; r++)
+            {
+                A->data[r * lda + i] *= scale;
+            }
+            *aii = beta;
+        }
+        tau->data[i * tau->prd] = t;
+
+        /* apply (I - tau v v') to the trailing columns */
+        const size_t nc = N - i - 1;
+        if (t == 0.0 || nc == 0)
+        {
+            continue;
+        }
+        for (size_t j = 0; j < nc; j++)
+        {
+            w[j] = aii[1 + j];
+        }
+        for (size_t r = i + 1; r < M; r++)
+        {
+            const double * ar = A->data + r * lda;
+            avx2_axpy(ar[i], ar + i + 1, w.data(), nc);
+        }
+        avx2_axpy(-t, w.data(), aii + 1, nc);
+        for (size_t r = i + 1; r < M; r++)
+        {
+            double * ar = A->data + r * lda;
+            avx2_axpy(-t * ar[i], w.data(), ar + i + 1, nc);
+        }
+    }
+    return MINI_SUCCESS;
+}
+
+/*
+ * AVX-512 level-3 kernels
+ */
+
+MINIBLAS_AVX512 static double avx512_dot(const double * x, const double * y, size_t n)
+{
+    __m512d s0 = _mm512_setzero_pd();
+    __m512d s1 = _mm512_setzero_pd();
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16)
+    {
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + k), _mm512_loadu_pd(y + k), s0);
+        s1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + k + 8), _mm512_loadu_pd(y + k + 8), s1);
+    }
+    for (; k + 8 <= n; k += 8)
+    {
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + k), _mm512_loadu_pd(y + k), s0);
+    }
+    if (k < n)
+    {
+        const __mmask8 m = (__mmask8)((1u << (n - k)) - 1);
+        s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, x + k), _mm512_maskz_loadu_pd(m, y + k), s1);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+}
+
+MINIBLAS_AVX512 static void avx512_axpy(double a, const double * x, double * y, size_t n)
+{
+    const __m512d va = _mm512_set1_pd(a);
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8)
+    {
+        _mm512_storeu_pd(y + k, _mm512_fmadd_pd(va, _mm512_loadu_pd(x + k), _mm512_loadu_pd(y + k)));
+    }
+    if (k < n)
+    {
+        const __mmask8 m = (__mmask8)((1u << (n - k)) - 1);
+        _mm512_mask_storeu_pd(y + k, m,
+                              _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(m, x + k), _mm512_maskz_loadu_pd(m, y + k)));
+    }
+}
+
+MINIBLAS_AVX512 static inline __m512d avx512_combine(__m512d acc, __m512d va, __m512d vb,
+        double beta, const double * c)
+{
+    if (beta == 0.0)
+    {
+        return _mm512_mul_pd(va, acc);
+    }
+    return _mm512_fmadd_pd(vb, _mm512_loadu_pd(c), _mm512_mul_pd(va, acc));
+}
+
+MINIBLAS_AVX512 static void avx512_gemm_row(size_t K, size_t N,
+        const double * a, size_t inca,
+        const double * b, size_t ldb,
+        double alpha, double beta, double * c)
+{
+    const __m512d va = _mm512_set1_pd(alpha);
+    const __m512d vb = _mm512_set1_pd(beta);
+    size_t j = 0;
+    for (; j + 32 <= N; j += 32)
+    {
+        __m512d acc0 = _mm512_setzero_pd();
+        __m512d acc1 = _mm512_setzero_pd();
+        __m512d acc2 = _mm512_setzero_pd();
+        __m512d acc3 = _mm512_setzero_pd();
+        for (size_t k = 0; k < K; k++)
+        {
+            const __m512d aik = _mm512_set1_pd(a[k * inca]);
+            const double * bk = b + k * ldb + j;
+            acc0 = _mm512_fmadd_pd(aik, _mm512_loadu_pd(bk), acc0);
+            acc1 = _mm512_fmadd_pd(aik, _mm512_loadu_pd(bk + 8), acc1);
+            acc2 = _mm512_fmadd_pd(aik, _mm512_loadu_pd(bk + 16), acc2);
+            acc3 = _mm512_fmadd_pd(aik, _mm512_loadu_pd(bk + 24), acc3);
+        }
+        _mm512_storeu_pd(c + j, avx512_combine(acc0, va, vb, beta, c + j));
+        _mm512_storeu_pd(c + j + 8, avx512_combine(acc1, va, vb, beta, c + j + 8));
+        _mm512_storeu_pd(c + j + 16, avx512_combine(acc2, va, vb, beta, c + j + 16));
+        _mm512_storeu_pd(c + j + 24, avx512_combine(acc3, va, vb, beta, c + j + 24));
+    }
+    while (j < N)
+    {
+        const size_t nj = miniblas_min((size_t)8, N - j);
+        const __mmask8 m = (__mmask8)((1u << nj) - 1);
+        __m512d acc = _mm512_setzero_pd();
+        for (size_t k = 0; k < K; k++)
+        {
+            acc = _mm512_fmadd_pd(_mm512_set1_pd(a[k * inca]), _mm512_maskz_loadu_pd(m, b + k * ldb + j), acc);
+        }
+        __m512d r = _mm512_mul_pd(va, acc);
+        if (beta != 0.0)
+        {
+            r = _mm512_fmadd_pd(vb, _mm512_maskz_loadu_pd(m, c + j), r);
+        }
+        _mm512_mask_storeu_pd(c + j, m, r);
+        j += nj;
+    }
+}
+
+MINIBLAS_AVX512 static int avx512_dgemm(MINIBLAS_TRANS TransA,
+                                        MINIBLAS_TRANS TransB,
+                                        double alpha,
+                                        const minimatrix& A,
+                                        const minimatrix& B,
+                                        double beta,
+                                        minimatrix * C)
+{
+    size_t K;
+    gemm_check(TransA, TransB, A, B, C, &K);
+    const size_t M = C->size1;
+    const size_t N = C->size2;
+
+    if (alpha == 0.0 || K == 0)
+    {
+        for (size_t i = 0; i < M; i++)
+        {
+            avx2_scal(beta, C->data + i * C->prd, N);
+        }
+        return MINI_SUCCESS;
+    }
+
+    std::vector<double> buffer;
+    size_t ldb;
+    const double * b = gemm_pack_B(TransB, B, K, N, buffer, &ldb);
+
+    for (size_t i = 0; i < M; i++)
+    {
+        const double * a = (TransA == blasNoTrans) ? A.data + i * A.prd : A.data + i;
+        const size_t inca = (TransA == blasNoTrans) ? 1 : A.prd;
+        avx512_gemm_row(K, N, a, inca, b, ldb, alpha, beta, C->data + i * C->prd);
+    }
+    return MINI_SUCCESS;
+}
+
+MINIBLAS_AVX512 static int avx512_dsyrk(MINIBLAS_UPORLOWER Uplo,
+                                        MINIBLAS_TRANS Trans,
+                                        double alpha,
+                                        const minimatrix& A,
+                                        double beta,
+                                        minimatrix * C)
+{
+    size_t K;
+    syrk_check(Trans, A, C, &K);
+    const size_t N = C->size1;
+
+    for (size_t i = 0; i < N; i++)
+    {
+        double * ci = C->data + i * C->prd;
+        const size_t j0 = (Uplo == blasUpper) ? i : 0;
+        const size_t j1 = (Uplo == blasUpper) ? N : i + 1;
+
+        if (Trans == blasNoTrans)
+        {
+            const double * ai = A.data + i * A.prd;
+            for (size_t j = j0; j < j1; j++)
+            {
+                const double d = alpha * avx512_dot(ai, A.data + j * A.prd, K);
+                ci[j] = (beta == 0.0) ? d : d + beta * ci[j];
+            }
+        }
+        else
+        {
+            avx2_scal(beta, ci + j0, j1 - j0);
+            if (alpha == 0.0)
+            {
+                continue;
+            }
+            for (size_t k = 0; k < K; k++)
+            {
+                const double * ak = A.data + k * A.prd;
+                avx512_axpy(alpha * ak[i], ak + j0, ci + j0, j1 - j0);
+            }
+        }
+    }
+    return MINI_SUCCESS;
+}
+
+static const miniblas_backend avx2_backend_table =
+{
+    blasBackendAVX2, "avx2",
+    avx2_dgemm, avx2_dsyrk, avx2_dtrsv, avx2_dtrsm, avx2_cholesky, avx2_qr
+};
+
+static const miniblas_backend avx512_backend_table =
+{
+    blasBackendAVX512, "avx512",
+    avx512_dgemm, avx512_dsyrk, avx2_dtrsv, avx2_dtrsm, avx2_cholesky, avx2_qr
+};
+
+const miniblas_backend * miniblas_avx2_backend()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return &avx2_backend_table;
+    }
+    return NULL;
+}
+
+const miniblas_backend * miniblas_avx512_backend()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return &avx512_backend_table;
+    }
+    return NULL;
+}
+
+#else
+
+const miniblas_backend * miniblas_avx2_backend()
+{
+    return NULL;
+}
+
+const miniblas_backend * miniblas_avx512_backend()
+{
+    return NULL;
+}
+
+#endif // MINIBLAS_HAVE_X86_KERNELS
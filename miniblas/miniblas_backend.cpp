@@ -0,0 +1,474 @@
+/**
+ * @file    miniblas_backend.cpp
+ * @brief   Scalar and CBLAS backend tables and the selection of the active backend.
+ */
+
+#include "miniblas_backend.h"
+#include <dlfcn.h>
+#include <string.h>
+#include <vector>
+#include <stdexcept>
+
+#ifdef MINIBLAS_USE_CBLAS
+#include <cblas.h>
+
+extern "C"
+{
+    void dpotrf_(const char * uplo, const int * n, double * a, const int * lda, int * info);
+    void dgeqrf_(const int * m, const int * n, double * a, const int * lda,
+                 double * tau, double * work, const int * lwork, int * info);
+}
+#endif
+
+/*
+ * Built-in scalar code
+ *
+ * miniblas_dgemm, miniblas_dsyrk, miniblas_dtrsv, minilinalg_nr_cholesky_decomp
+ * and minilinalg_Golub_QR_decomp are defined again at the end of this file to
+ * dispatch to the active backend, so the code of libminisam.so is looked up
+ * behind them, in the next object after the one this file is linked into.
+ */
+
+struct miniblas_library_kernels
+{
+    miniblas_dgemm_kernel dgemm;
+    miniblas_dsyrk_kernel dsyrk;
+    miniblas_dtrsv_kernel dtrsv;
+    int (*cholesky)(minimatrix * A, bool lowerorupper);
+    minilinalg_qr_kernel qr;
+};
+
+static void * miniblas_library_symbol(const char * name)
+{
+    void * symbol = dlsym(RTLD_NEXT, name);
+    if (symbol == NULL)
+    {
+        throw std::invalid_argument(std::string("miniblas: libminisam does not define ") + name);
+    }
+    return symbol;
+}
+
+static miniblas_library_kernels miniblas_library_lookup()
+{
+    miniblas_library_kernels k;
+    k.dgemm = (miniblas_dgemm_kernel)miniblas_library_symbol("_Z14miniblas_dgemm14MINIBLAS_TRANSS_dRK10minimatrixS2_dPS0_");
+    k.dsyrk = (miniblas_dsyrk_kernel)miniblas_library_symbol("_Z14miniblas_dsyrk18MINIBLAS_UPORLOWER14MINIBLAS_TRANSdRK10minimatrixdPS1_");
+    k.dtrsv = (miniblas_dtrsv_kernel)miniblas_library_symbol("_Z14miniblas_dtrsv18MINIBLAS_UPORLOWER14MINIBLAS_TRANS13MINIBLAS_UNITRK10minimatrixP10minivector");
+    k.cholesky = (int (*)(minimatrix *, bool))miniblas_library_symbol("_Z29minilinalg_nr_cholesky_decompP10minimatrixb");
+    k.qr = (minilinalg_qr_kernel)miniblas_library_symbol("_Z26minilinalg_Golub_QR_decompP10minimatrixP10minivector");
+    return k;
+}
+
+static const miniblas_library_kernels& miniblas_library()
+{
+    static const miniblas_library_kernels kernels = miniblas_library_lookup();
+    return kernels;
+}
+
+static int scalar_dgemm(MINIBLAS_TRANS TransA,
+                        MINIBLAS_TRANS TransB,
+                        double alpha,
+                        const minimatrix& A,
+                        const minimatrix& B,
+                        double beta,
+                        minimatrix * C)
+{
+    return miniblas_library().dgemm(TransA, TransB, alpha, A, B, beta, C);
+}
+
+static int scalar_dsyrk(MINIBLAS_UPORLOWER Uplo,
+                        MINIBLAS_TRANS Trans,
+                        double alpha,
+                        const minimatrix& A,
+                        double beta,
+                        minimatrix * C)
+{
+    return miniblas_library().dsyrk(Uplo, Trans, alpha, A, beta, C);
+}
+
+static int scalar_dtrsv(MINIBLAS_UPORLOWER Uplo,
+                        MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+                        const minimatrix& A,
+                        minivector * X)
+{
+    return miniblas_library().dtrsv(Uplo, TransA, Diag, A, X);
+}
+
+static int scalar_cholesky(minimatrix * A)
+{
+    return miniblas_library().cholesky(A, true);
+}
+
+static int scalar_qr(minimatrix * A, minivector * tau)
+{
+    return miniblas_library().qr(A, tau);
+}
+
+static const miniblas_backend scalar_backend_table =
+{
+    blasBackendScalar, "scalar",
+    scalar_dgemm, scalar_dsyrk, scalar_dtrsv, miniblas_dtrsm,
+    scalar_cholesky, scalar_qr
+};
+
+const miniblas_backend * miniblas_scalar_backend()
+{
+    return &scalar_backend_table;
+}
+
+/*
+ * System CBLAS / LAPACK
+ */
+
+#ifdef MINIBLAS_USE_CBLAS
+
+static CBLAS_TRANSPOSE cblas_trans(MINIBLAS_TRANS t)
+{
+    return (t == blasNoTrans) ? CblasNoTrans : CblasTrans;
+}
+
+static CBLAS_UPLO cblas_uplo(MINIBLAS_UPORLOWER u)
+{
+    return (u == blasUpper) ? CblasUpper : CblasLower;
+}
+
+static CBLAS_DIAG cblas_diag(MINIBLAS_UNIT d)
+{
+    return (d == blasNonUnit) ? CblasNonUnit : CblasUnit;
+}
+
+static int cblas_backend_dgemm(MINIBLAS_TRANS TransA,
+                               MINIBLAS_TRANS TransB,
+                               double alpha,
+                               const minimatrix& A,
+                               const minimatrix& B,
+                               double beta,
+                               minimatrix * C)
+{
+    const size_t MA = (TransA == blasNoTrans) ? A.size1 : A.size2;
+    const size_t NA = (TransA == blasNoTrans) ? A.size2 : A.size1;
+    const size_t MB = (TransB == blasNoTrans) ? B.size1 : B.size2;
+    const size_t NB = (TransB == blasNoTrans) ? B.size2 : B.size1;
+    if (C->size1 != MA || C->size2 != NB || NA != MB)
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    if (C->size1 == 0 || C->size2 == 0)
+    {
+        return MINI_SUCCESS;
+    }
+    cblas_dgemm(CblasRowMajor, cblas_trans(TransA), cblas_trans(TransB),
+                C->size1, C->size2, NA, alpha, A.data, A.prd, B.data, B.prd,
+                beta, C->data, C->prd);
+    return MINI_SUCCESS;
+}
+
+static int cblas_backend_dsyrk(MINIBLAS_UPORLOWER Uplo,
+                               MINIBLAS_TRANS Trans,
+                               double alpha,
+                               const minimatrix& A,
+                               double beta,
+                               minimatrix * C)
+{
+    if (C->size1 != C->size2)
+    {
+        throw std::invalid_argument("matrix C must be square");
+    }
+    const size_t N = (Trans == blasNoTrans) ? A.size1 : A.size2;
+    const size_t K = (Trans == blasNoTrans) ? A.size2 : A.size1;
+    if (C->size1 != N)
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    if (N == 0)
+    {
+        return MINI_SUCCESS;
+    }
+    cblas_dsyrk(CblasRowMajor, cblas_uplo(Uplo), cblas_trans(Trans),
+                N, K, alpha, A.data, A.prd, beta, C->data, C->prd);
+    return MINI_SUCCESS;
+}
+
+static int cblas_backend_dtrsv(MINIBLAS_UPORLOWER Uplo,
+                               MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+                               const minimatrix& A,
+                               minivector * X)
+{
+    if (A.size1 != A.size2)
+    {
+        throw std::invalid_argument("matrix must be square");
+    }
+    if (A.size1 != X->size1)
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    if (X->size1 == 0)
+    {
+        return MINI_SUCCESS;
+    }
+    cblas_dtrsv(CblasRowMajor, cblas_uplo(Uplo), cblas_trans(TransA), cblas_diag(Diag),
+                X->size1, A.data, A.prd, X->data, X->prd);
+    return MINI_SUCCESS;
+}
+
+static int cblas_backend_dtrsm(MINIBLAS_SIDE Side,
+                               MINIBLAS_UPORLOWER Uplo,
+                               MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+                               double alpha,
+                               const minimatrix& A,
+                               minimatrix * B)
+{
+    if (A.size1 != A.size2)
+    {
+        throw std::invalid_argument("matrix must be square");
+    }
+    if ((Side == blasLeft && A.size1 != B->size1) || (Side == blasRight && A.size1 != B->size2))
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    if (B->size1 == 0 || B->size2 == 0)
+    {
+        return MINI_SUCCESS;
+    }
+    cblas_dtrsm(CblasRowMajor, (Side == blasLeft) ? CblasLeft : CblasRight,
+                cblas_uplo(Uplo), cblas_trans(TransA), cblas_diag(Diag),
+                B->size1, B->size2, alpha, A.data, A.prd, B->data, B->prd);
+    return MINI_SUCCESS;
+}
+
+/// The row-major lower triangle is the column-major upper triangle.
+static int cblas_backend_cholesky(minimatrix * A)
+{
+    if (A->size1 != A->size2)
+    {
+        throw std::invalid_argument("matrix must be square");
+    }
+    const int n = A->size1;
+    const int lda = A->prd;
+    int info = 0;
+    if (n == 0)
+    {
+        return MINI_SUCCESS;
+    }
+    dpotrf_("U", &n, A->data, &lda, &info);
+    return (info == 0) ? MINI_SUCCESS : MINI_FAILURE;
+}
+
+/// LAPACK and minilinalg share the Householder convention, only the storage order differs.
+static int cblas_backend_qr(minimatrix * A, minivector * tau)
+{
+    const int m = A->size1;
+    const int n = A->size2;
+    const int k = miniblas_min(m, n);
+    if ((int)tau->size1 != k)
+    {
+        throw std::invalid_argument("size of tau must be MIN(M,N)");
+    }
+    if (k == 0)
+    {
+        return MINI_SUCCESS;
+    }
+
+    std::vector<double> cm((size_t)m * n);
+    for (int i = 0; i < m; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            cm[i + (size_t)j * m] = A->data[i * A->prd + j];
+        }
+    }
+
+    std::vector<double> t(k);
+    int info = 0;
+    int lwork = -1;
+    double wsize = 0.0;
+    dgeqrf_(&m, &n, cm.data(), &m, t.data(), &wsize, &lwork, &info);
+    lwork = miniblas_max((int)wsize, n);
+    std::vector<double> work(lwork);
+    dgeqrf_(&m, &n, cm.data(), &m, t.data(), work.data(), &lwork, &info);
+    if (info != 0)
+    {
+        return MINI_FAILURE;
+    }
+
+    for (int i = 0; i < m; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            A->data[i * A->prd + j] = cm[i + (size_t)j * m];
+        }
+    }
+    for (int i = 0; i < k; i++)
+    {
+        tau->data[i * tau->prd] = t[i];
+    }
+    return MINI_SUCCESS;
+}
+
+static const miniblas_backend cblas_backend_table =
+{
+    blasBackendCBLAS, "cblas",
+    cblas_backend_dgemm, cblas_backend_dsyrk, cblas_backend_dtrsv, cblas_backend_dtrsm,
+    cblas_backend_cholesky, cblas_backend_qr
+};
+
+const miniblas_backend * miniblas_cblas_backend()
+{
+    return &cblas_backend_table;
+}
+
+#else
+
+const miniblas_backend * miniblas_cblas_backend()
+{
+    return NULL;
+}
+
+#endif // MINIBLAS_USE_CBLAS
+
+/*
+ * Selection
+ */
+
+const miniblas_backend * miniblas_find_backend(MINIBLAS_BACKEND kind)
+{
+    switch (kind)
+    {
+    case blasBackendScalar:
+        return miniblas_scalar_backend();
+    case blasBackendAVX2:
+        return miniblas_avx2_backend();
+    case blasBackendAVX512:
+        return miniblas_avx512_backend();
+    case blasBackendCBLAS:
+        return miniblas_cblas_backend();
+    }
+    return NULL;
+}
+
+/// A system BLAS the library was explicitly configured with wins, then the widest SIMD.
+MINIBLAS_BACKEND miniblas_best_backend()
+{
+    if (miniblas_cblas_backend() != NULL)
+        return blasBackendCBLAS;
+    if (miniblas_avx512_backend() != NULL)
+        return blasBackendAVX512;
+    if (miniblas_avx2_backend() != NULL)
+        return blasBackendAVX2;
+    return blasBackendScalar;
+}
+
+static const miniblas_backend * miniblas_startup_backend()
+{
+    const char * request = getenv("MINIBLAS_BACKEND");
+    if (request != NULL)
+    {
+        const MINIBLAS_BACKEND kinds[4] = {blasBackendScalar, blasBackendAVX2, blasBackendAVX512, blasBackendCBLAS};
+        for (int i = 0; i < 4; i++)
+        {
+            const miniblas_backend * b = miniblas_find_backend(kinds[i]);
+            if (b != NULL && strcmp(request, b->name) == 0)
+            {
+                return b;
+            }
+        }
+        std::cerr << "MINIBLAS_BACKEND=" << request << " is not available, using the default backend" << std::endl;
+    }
+    return miniblas_find_backend(miniblas_best_backend());
+}
+
+static const miniblas_backend *& miniblas_active_backend()
+{
+    static const miniblas_backend * active = miniblas_startup_backend();
+    return active;
+}
+
+const miniblas_backend * miniblas_get_backend()
+{
+    return miniblas_active_backend();
+}
+
+int miniblas_set_backend(MINIBLAS_BACKEND kind)
+{
+    const miniblas_backend * b = miniblas_find_backend(kind);
+    if (b == NULL)
+    {
+        return MINI_FAILURE;
+    }
+    miniblas_active_backend() = b;
+    return MINI_SUCCESS;
+}
+
+/*
+ * Library entry points
+ *
+ * libminisam.so calls these through its PLT, so the definitions below take
+ * the place of its own for the library as well as for the program. Products
+ * below MINIBLAS_DISPATCH_MIN_WORK multiply-adds, e.g. the 3x3 blocks of the
+ * geometry, stay with the library code, where a backend call costs more than
+ * it saves.
+ */
+
+#define MINIBLAS_DISPATCH_MIN_WORK 4096
+
+int miniblas_dgemm(MINIBLAS_TRANS TransA,
+                   MINIBLAS_TRANS TransB,
+                   double alpha,
+                   const minimatrix& A,
+                   const minimatrix& B,
+                   double beta,
+                   minimatrix * C)
+{
+    const size_t K = (TransA == blasNoTrans) ? A.size2 : A.size1;
+    if (C->size1 * C->size2 * K < MINIBLAS_DISPATCH_MIN_WORK)
+    {
+        return miniblas_library().dgemm(TransA, TransB, alpha, A, B, beta, C);
+    }
+    return miniblas_get_backend()->dgemm(TransA, TransB, alpha, A, B, beta, C);
+}
+
+int miniblas_dsyrk(MINIBLAS_UPORLOWER Uplo,
+                   MINIBLAS_TRANS Trans,
+                   double alpha,
+                   const minimatrix& A,
+                   double beta,
+                   minimatrix * C)
+{
+    const size_t K = (Trans == blasNoTrans) ? A.size2 : A.size1;
+    if (C->size1 * C->size1 * K < MINIBLAS_DISPATCH_MIN_WORK)
+    {
+        return miniblas_library().dsyrk(Uplo, Trans, alpha, A, beta, C);
+    }
+    return miniblas_get_backend()->dsyrk(Uplo, Trans, alpha, A, beta, C);
+}
+
+int miniblas_dtrsv(MINIBLAS_UPORLOWER Uplo,
+                   MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+                   const minimatrix& A,
+                   minivector * X)
+{
+    if (A.size1 * A.size2 < MINIBLAS_DISPATCH_MIN_WORK)
+    {
+        return miniblas_library().dtrsv(Uplo, TransA, Diag, A, X);
+    }
+    return miniblas_get_backend()->dtrsv(Uplo, TransA, Diag, A, X);
+}
+
+/// the backends write L to the lower triangle only, the upper one is left as the library leaves it: unspecified
+int minilinalg_nr_cholesky_decomp(minimatrix * A, bool lowerorupper)
+{
+    if (!lowerorupper || A->size1 * A->size1 * A->size1 < 3 * MINIBLAS_DISPATCH_MIN_WORK)
+    {
+        return miniblas_library().cholesky(A, lowerorupper);
+    }
+    return miniblas_get_backend()->cholesky(A);
+}
+
+int minilinalg_Golub_QR_decomp(minimatrix * A, minivector * tau)
+{
+    if (A->size1 * A->size2 * A->size2 < MINIBLAS_DISPATCH_MIN_WORK)
+    {
+        return miniblas_library().qr(A, tau);
+    }
+    return miniblas_get_backend()->qr(A, tau);
+}
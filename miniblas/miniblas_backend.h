@@ -0,0 +1,104 @@
+#ifndef MINIBLAS_BACKEND_H
+#define MINIBLAS_BACKEND_H
+
+/**
+ * @file    miniblas_backend.h
+ * @brief   Runtime dispatch table for the dense kernels of miniblas.
+ *
+ * The built-in miniblas/minilinalg routines are plain scalar loops. A backend
+ * bundles one implementation of every heavy kernel behind function pointers,
+ * and the best backend available on the running host is chosen the first
+ * time miniblas_get_backend() is called:
+ *
+ *   blasBackendScalar  the built-in miniblas/minilinalg code (always present)
+ *   blasBackendAVX2    hand written AVX2+FMA kernels (x86-64 hosts with AVX2)
+ *   blasBackendAVX512  AVX-512F variants of the level-3 kernels
+ *   blasBackendCBLAS   the system CBLAS/LAPACK, only when the library is
+ *                      configured with MINIBLAS_USE_CBLAS
+ *
+ * The environment variable MINIBLAS_BACKEND (scalar, avx2, avx512, cblas)
+ * overrides the automatic choice, and miniblas_set_backend() switches at run
+ * time. All backends follow the storage conventions of the built-in code
+ * (row-major, physical row dimension prd, vector stride prd), so their results
+ * agree within round-off.
+ *
+ * miniblas_dgemm, miniblas_dsyrk, miniblas_dtrsv, minilinalg_nr_cholesky_decomp
+ * and minilinalg_Golub_QR_decomp themselves dispatch to the active backend once
+ * their operands are large enough. Their definitions in minisam_ext take the
+ * place of those of libminisam.so, whose own callers, e.g. the elimination,
+ * therefore use the backend too; the scalar backend is the code of
+ * libminisam.so.
+ */
+
+#include "miniblas.h"
+#include "minilinalg.h"
+
+enum MINIBLAS_BACKEND {blasBackendScalar=51, blasBackendAVX2=52, blasBackendAVX512=53, blasBackendCBLAS=54};
+
+typedef int (*miniblas_dgemm_kernel)(MINIBLAS_TRANS TransA,
+                                     MINIBLAS_TRANS TransB,
+                                     double alpha,
+                                     const minimatrix& A,
+                                     const minimatrix& B,
+                                     double beta,
+                                     minimatrix * C);
+
+typedef int (*miniblas_dsyrk_kernel)(MINIBLAS_UPORLOWER Uplo,
+                                     MINIBLAS_TRANS Trans,
+                                     double alpha,
+                                     const minimatrix& A,
+                                     double beta,
+                                     minimatrix * C);
+
+typedef int (*miniblas_dtrsv_kernel)(MINIBLAS_UPORLOWER Uplo,
+                                     MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+                                     const minimatrix& A,
+                                     minivector * X);
+
+typedef int (*miniblas_dtrsm_kernel)(MINIBLAS_SIDE Side,
+                                     MINIBLAS_UPORLOWER Uplo,
+                                     MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+                                     double alpha,
+                                     const minimatrix& A,
+                                     minimatrix * B);
+
+/// Cholesky factorization A = L*L', L is written to the lower triangle of A,
+/// the strictly upper triangle is left unspecified. Returns MINI_FAILURE if A
+/// is not positive definite.
+typedef int (*minilinalg_cholesky_kernel)(minimatrix * A);
+
+/// Householder QR with the same packed layout as minilinalg_Golub_QR_decomp:
+/// R in the upper triangle, the reflectors below it and their scales in tau.
+typedef int (*minilinalg_qr_kernel)(minimatrix * A, minivector * tau);
+
+struct miniblas_backend
+{
+    MINIBLAS_BACKEND kind;
+    const char * name;
+    miniblas_dgemm_kernel dgemm;
+    miniblas_dsyrk_kernel dsyrk;
+    miniblas_dtrsv_kernel dtrsv;
+    miniblas_dtrsm_kernel dtrsm;
+    minilinalg_cholesky_kernel cholesky;
+    minilinalg_qr_kernel qr;
+};
+
+/// The active backend, selected on first use.
+const miniblas_backend * miniblas_get_backend();
+
+/// Switch the active backend, returns MINI_FAILURE if it is not available on this host.
+int miniblas_set_backend(MINIBLAS_BACKEND kind);
+
+/// Return the table for a backend, or NULL if it is not available on this host.
+const miniblas_backend * miniblas_find_backend(MINIBLAS_BACKEND kind);
+
+/// Fastest backend available on this host (MINIBLAS_BACKEND is not consulted).
+MINIBLAS_BACKEND miniblas_best_backend();
+
+/// Backend tables, only valid where the host supports them.
+const miniblas_backend * miniblas_scalar_backend();
+const miniblas_backend * miniblas_avx2_backend();
+const miniblas_backend * miniblas_avx512_backend();
+const miniblas_backend * miniblas_cblas_backend();
+
+#endif // MINIBLAS_BACKEND_H
@@ -0,0 +1,167 @@
+/**
+ * @file    miniblas_batch.cpp
+ * @brief   Kernels on batches of small matrices, see minibatch_double.h.
+ *
+ * The loops run over MINIBATCH_LANES matrices at a time with the lane index
+ * innermost, which the compiler turns into one vector instruction per matrix
+ * element. GCC builds an AVX-512, an AVX2 and a generic clone of each kernel
+ * and picks one at load time. Padding lanes are computed too, their contents
+ * are never read back.
+ */
+
+#include "minibatch_double.h"
+#include "../gmfconfig.h"
+#include <string.h>
+#include <stdexcept>
+
+void minibatch_set(minibatch * batch, size_t b, const minimatrix& m)
+{
+    if (m.size1 != batch->size1 || m.size2 != batch->size2 || b >= batch->count)
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    for (size_t i = 0; i < m.size1; i++)
+    {
+        for (size_t j = 0; j < m.size2; j++)
+        {
+            batch->element(i, j)[b] = m.data[i * m.prd + j];
+        }
+    }
+}
+
+void minibatch_get(const minibatch& batch, size_t b, minimatrix * m)
+{
+    if (m->size1 != batch.size1 || m->size2 != batch.size2 || b >= batch.count)
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    for (size_t i = 0; i < m->size1; i++)
+    {
+        for (size_t j = 0; j < m->size2; j++)
+        {
+            m->data[i * m->prd + j] = batch.element(i, j)[b];
+        }
+    }
+}
+
+void minibatch_set_zero(minibatch * batch)
+{
+    memset(batch->data, 0, batch->size1 * batch->size2 * batch->stride * sizeof(double));
+}
+
+int minibatch_memcpy(minibatch * dest, const minibatch& src)
+{
+    if (dest->size1 != src.size1 || dest->size2 != src.size2 || dest->count != src.count)
+    {
+        throw std::invalid_argument("batches must have same dimensions");
+    }
+    memcpy(dest->data, src.data, src.size1 * src.size2 * src.stride * sizeof(double));
+    return MINI_SUCCESS;
+}
+
+MINISAM_CLONES
+static void batch_skew_kernel(size_t stride, const double * w, double * W)
+{
+    const double * w0 = w;
+    const double * w1 = w + stride;
+    const double * w2 = w + 2 * stride;
+    for (size_t b = 0; b < stride; b++)
+    {
+        W[0 * stride + b] = 0.0;
+        W[1 * stride + b] = -w2[b];
+        W[2 * stride + b] = w1[b];
+        W[3 * stride + b] = w2[b];
+        W[4 * stride + b] = 0.0;
+        W[5 * stride + b] = -w0[b];
+        W[6 * stride + b] = -w1[b];
+        W[7 * stride + b] = w0[b];
+        W[8 * stride + b] = 0.0;
+    }
+}
+
+void minibatch_skewSymmetric(const minibatch& w, minibatch * W)
+{
+    if (w.size1 != 3 || w.size2 != 1 || W->size1 != 3 || W->size2 != 3 || W->count != w.count)
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    batch_skew_kernel(w.stride, w.data, W->data);
+}
+
+/// Element (i,l) of op(A) is at A + (i*ai + l*al)*stride, likewise for B.
+MINISAM_CLONES
+static void batch_dgemm_kernel(size_t M, size_t N, size_t K, size_t stride,
+                               double alpha,
+                               const double * A, size_t ai, size_t al,
+                               const double * B, size_t bl, size_t bj,
+                               double beta,
+                               double * C)
+{
+    for (size_t b0 = 0; b0 < stride; b0 += MINIBATCH_LANES)
+    {
+        for (size_t i = 0; i < M; i++)
+        {
+            for (size_t j = 0; j < N; j++)
+            {
+                double acc[MINIBATCH_LANES] = {0.0};
+                for (size_t l = 0; l < K; l++)
+                {
+                    const double * a = A + (i * ai + l * al) * stride + b0;
+                    const double * b = B + (l * bl + j * bj) * stride + b0;
+                    for (size_t t = 0; t < MINIBATCH_LANES; t++)
+                    {
+                        acc[t] += a[t] * b[t];
+                    }
+                }
+                double * c = C + (i * N + j) * stride + b0;
+                if (beta == 0.0)
+                {
+                    for (size_t t = 0; t < MINIBATCH_LANES; t++)
+                    {
+                        c[t] = alpha * acc[t];
+                    }
+                }
+                else
+                {
+                    for (size_t t = 0; t < MINIBATCH_LANES; t++)
+                    {
+                        c[t] = alpha * acc[t] + beta * c[t];
+                    }
+                }
+            }
+        }
+    }
+}
+
+int miniblas_batch_dgemm(MINIBLAS_TRANS TransA,
+                         MINIBLAS_TRANS TransB,
+                         double alpha,
+                         const minibatch& A,
+                         const minibatch& B,
+                         double beta,
+                         minibatch * C)
+{
+    const size_t M = (TransA == blasNoTrans) ? A.size1 : A.size2;
+    const size_t KA = (TransA == blasNoTrans) ? A.size2 : A.size1;
+    const size_t KB = (TransB == blasNoTrans) ? B.size1 : B.size2;
+    const size_t N = (TransB == blasNoTrans) ? B.size2 : B.size1;
+    if (C->size1 != M || C->size2 != N || KA != KB)
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    if (A.count != C->count || B.count != C->count)
+    {
+        throw std::invalid_argument("batches must have the same count");
+    }
+    if (C->data == A.data || C->data == B.data)
+    {
+        throw std::invalid_argument("C must not alias A or B");
+    }
+
+    const size_t ai = (TransA == blasNoTrans) ? A.size2 : 1;
+    const size_t al = (TransA == blasNoTrans) ? 1 : A.size2;
+    const size_t bl = (TransB == blasNoTrans) ? B.size2 : 1;
+    const size_t bj = (TransB == blasNoTrans) ? 1 : B.size2;
+    batch_dgemm_kernel(M, N, KA, C->stride, alpha, A.data, ai, al, B.data, bl, bj, beta, C->data);
+    return MINI_SUCCESS;
+}
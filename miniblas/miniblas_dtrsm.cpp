@@ -0,0 +1,166 @@
+/**
+ * @file    miniblas_dtrsm.cpp
+ * @brief   Blocked triangular solve with multiple right-hand sides.
+ *
+ * op(A) is split into DTRSM_BLOCK x DTRSM_BLOCK tiles. Each diagonal tile is
+ * solved by row operations on B, the remaining right-hand sides are then
+ * updated with one dgemm of the active backend, which carries almost all of
+ * the flops for large systems.
+ */
+
+#include "miniblas_backend.h"
+#include <stdexcept>
+
+#define DTRSM_BLOCK 32
+
+/// element (i,j) of op(A)
+static inline double dtrsm_op(const minimatrix& A, MINIBLAS_TRANS TransA, size_t i, size_t j)
+{
+    return (TransA == blasNoTrans) ? A.data[i * A.prd + j] : A.data[j * A.prd + i];
+}
+
+/// op(A)[i0:i0+n1, j0:j0+n2] as a view of A together with the flag handed to dgemm
+static minimatrix dtrsm_op_block(const minimatrix& A, MINIBLAS_TRANS TransA,
+                                 size_t i0, size_t j0, size_t n1, size_t n2)
+{
+    if (TransA == blasNoTrans)
+    {
+        return minimatrix_blockmatrix(A, i0, j0, n1, n2);
+    }
+    return minimatrix_blockmatrix(A, j0, i0, n2, n1);
+}
+
+/// B[k0:k1,:] = op(A)[k0:k1,k0:k1]^-1 * B[k0:k1,:]
+static void dtrsm_left_diagonal(bool upper, MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+                                const minimatrix& A, minimatrix * B, size_t k0, size_t k1)
+{
+    const size_t N = B->size2;
+    const size_t nb = k1 - k0;
+    for (size_t s = 0; s < nb; s++)
+    {
+        const size_t i = upper ? (k1 - 1 - s) : (k0 + s);
+        double * bi = B->data + i * B->prd;
+        const size_t l0 = upper ? i + 1 : k0;
+        const size_t l1 = upper ? k1 : i;
+        for (size_t l = l0; l < l1; l++)
+        {
+            const double a = dtrsm_op(A, TransA, i, l);
+            if (a == 0.0)
+                continue;
+            const double * bl = B->data + l * B->prd;
+            for (size_t j = 0; j < N; j++)
+            {
+                bi[j] -= a * bl[j];
+            }
+        }
+        if (Diag == blasNonUnit)
+        {
+            const double inv = 1.0 / dtrsm_op(A, TransA, i, i);
+            for (size_t j = 0; j < N; j++)
+            {
+                bi[j] *= inv;
+            }
+        }
+    }
+}
+
+/// B[:,k0:k1] = B[:,k0:k1] * op(A)[k0:k1,k0:k1]^-1
+static void dtrsm_right_diagonal(bool upper, MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+                                 const minimatrix& A, minimatrix * B, size_t k0, size_t k1)
+{
+    const size_t M = B->size1;
+    const size_t nb = k1 - k0;
+    for (size_t r = 0; r < M; r++)
+    {
+        double * b = B->data + r * B->prd;
+        for (size_t s = 0; s < nb; s++)
+        {
+            const size_t j = upper ? (k0 + s) : (k1 - 1 - s);
+            const size_t l0 = upper ? k0 : j + 1;
+            const size_t l1 = upper ? j : k1;
+            double x = b[j];
+            for (size_t l = l0; l < l1; l++)
+            {
+                x -= b[l] * dtrsm_op(A, TransA, l, j);
+            }
+            if (Diag == blasNonUnit)
+            {
+                x /= dtrsm_op(A, TransA, j, j);
+            }
+            b[j] = x;
+        }
+    }
+}
+
+/**
+ * Solve op(A)*X = alpha*B (Left) or X*op(A) = alpha*B (Right) for X, A is
+ * triangular, X overwrites B.
+ */
+int miniblas_dtrsm(MINIBLAS_SIDE Side,
+                   MINIBLAS_UPORLOWER Uplo,
+                   MINIBLAS_TRANS TransA, MINIBLAS_UNIT Diag,
+                   double alpha,
+                   const minimatrix& A,
+                   minimatrix * B)
+{
+    if (A.size1 != A.size2)
+    {
+        throw std::invalid_argument("matrix must be square");
+    }
+    if ((Side == blasLeft && A.size1 != B->size1) || (Side == blasRight && A.size1 != B->size2))
+    {
+        throw std::invalid_argument("invalid length");
+    }
+    const size_t M = B->size1;
+    const size_t N = B->size2;
+    if (M == 0 || N == 0)
+    {
+        return MINI_SUCCESS;
+    }
+    if (alpha != 1.0)
+    {
+        minimatrix_scale(B, alpha);
+    }
+
+    const miniblas_dgemm_kernel dgemm = miniblas_get_backend()->dgemm;
+    const bool upper = ((Uplo == blasUpper) == (TransA == blasNoTrans));
+    const size_t n = A.size1;
+    const size_t nblocks = (n + DTRSM_BLOCK - 1) / DTRSM_BLOCK;
+
+    for (size_t s = 0; s < nblocks; s++)
+    {
+        // left side solves bottom-up for upper op(A), right side top-down
+        const bool backward = (Side == blasLeft) ? upper : !upper;
+        const size_t kb = backward ? (nblocks - 1 - s) : s;
+        const size_t k0 = kb * DTRSM_BLOCK;
+        const size_t k1 = miniblas_min(k0 + DTRSM_BLOCK, n);
+        const size_t r0 = backward ? 0 : k1;
+        const size_t r1 = backward ? k0 : n;
+
+        if (Side == blasLeft)
+        {
+            dtrsm_left_diagonal(upper, TransA, Diag, A, B, k0, k1);
+            if (r1 > r0)
+            {
+                // B[r0:r1,:] -= op(A)[r0:r1,k0:k1] * X[k0:k1,:]
+                minimatrix Aik = dtrsm_op_block(A, TransA, r0, k0, r1 - r0, k1 - k0);
+                minimatrix Xk = minimatrix_blockmatrix(*B, k0, 0, k1 - k0, N);
+                minimatrix Bi = minimatrix_blockmatrix(*B, r0, 0, r1 - r0, N);
+                dgemm(TransA, blasNoTrans, -1.0, Aik, Xk, 1.0, &Bi);
+            }
+        }
+        else
+        {
+            dtrsm_right_diagonal(upper, TransA, Diag, A, B, k0, k1);
+            if (r1 > r0)
+            {
+                // B[:,r0:r1] -= X[:,k0:k1] * op(A)[k0:k1,r0:r1]
+                minimatrix Aki = dtrsm_op_block(A, TransA, k0, r0, k1 - k0, r1 - r0);
+                minimatrix Xk = minimatrix_blockmatrix(*B, 0, k0, M, k1 - k0);
+                minimatrix Bi = minimatrix_blockmatrix(*B, 0, r0, M, r1 - r0);
+                dgemm(blasNoTrans, TransA, -1.0, Xk, Aki, 1.0, &Bi);
+            }
+        }
+    }
+    return MINI_SUCCESS;
+}
@@ -29,6 +29,14 @@ int minilinalg_R_solve (const minimatrix& R,
 /* Cholesky Decomposition */
 int minilinalg_nr_cholesky_decomp(minimatrix * A,bool lowerorupper=true);
 
+/* Single precision Cholesky for mixed-precision solves. A is n x n row-major
+   with leading dimension lda, only its lower triangle is read and L overwrites
+   it. Returns MINI_FAILURE if A is not positive definite in single precision. */
+int minilinalg_cholesky_decomp_float(float * A, size_t n, size_t lda);
+
+/* Solve L*L'*x = b in place with the factor of minilinalg_cholesky_decomp_float */
+void minilinalg_cholesky_solve_float(const float * L, size_t n, size_t lda, float * x);
+
 
 
 
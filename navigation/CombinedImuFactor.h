@@ -0,0 +1,208 @@
+#ifndef COMBINEDIMUFACTOR_H
+#define COMBINEDIMUFACTOR_H
+
+/**
+ * @file    CombinedImuFactor.h
+ * @brief   6-way IMU factor with the bias random walk
+ */
+
+#include "../nonlinear/FixedNoiseModelFactor.h"
+#include "../navigation/PreintegrationState.h"
+#include "../linear/NoiseModelPool.h"
+#include "../geometry/LieKernels.h"
+#include <mutex>
+#include <math.h>
+#include <string.h>
+
+namespace minisam
+{
+
+#ifdef TANGENT_PREINTEGRATION
+
+/**
+ * The CombinedImuFactor of GTSAM on (pose_i, vel_i, pose_j, vel_j, bias_i,
+ * bias_j): the error of FixedImuFactor at bias_i followed by bias_i - bias_j,
+ * whitened by the 15x15 covariance of CombinedPreintegrationState_IntegrateBatch,
+ * which correlates the preintegrated vector with the bias random walk.
+ *
+ * The bias-corrected delta, its rotation and right Jacobian are kept for the
+ * last bias_i seen, and reused while every component of bias_i stays within
+ * biasTolerance of it: 0, the default, reuses them only for the same bias,
+ * as between relinearizations in ISAM2 or across the iterations of a
+ * solver that holds the biases; a positive tolerance trades the first-order
+ * bias correction of that much change for the evaluations saved. The cache
+ * is per factor and is skipped, not waited on, when another thread holds it.
+ */
+class CombinedImuFactor : public FixedNoiseModelFactor<15, 6, 3, 6, 3, 6, 6>
+{
+public:
+    /**
+     * The factor builds its noise model from pim.preintMeasCov. Without
+     * \c pool the factor owns the model and deletes it; with one the model is
+     * interned in it and the factor only releases its reference, so the pool
+     * must outlive the factor.
+     */
+    CombinedImuFactor(int pose_i, int vel_i, int pose_j, int vel_j, int bias_i, int bias_j,
+                      const CombinedPreintegrationState& pim, const std::shared_ptr<const ImuParams>& params,
+                      double biasTolerance = 0.0, NoiseModelPool* pool = NULL)
+        : FixedNoiseModelFactor<15, 6, 3, 6, 3, 6, 6>(NoiseModelPool_InternOrOwn(pool, covariance(pim)),
+                keys(pose_i, vel_i, pose_j, vel_j, bias_i, bias_j)),
+          pim_(pim), params_(params), biasTolerance_(biasTolerance), pool_(pool)
+    {
+        cache_.valid = false;
+    }
+
+    virtual ~CombinedImuFactor()
+    {
+        NoiseModelPool_ReleaseOrDelete(pool_, noiseModel_);
+    }
+
+    /// @return a deep copy of this factor, sharing the parameters and the pool, with an empty cache
+    virtual NoiseModelFactor* clone() const
+    {
+        return new CombinedImuFactor(keys_[0], keys_[1], keys_[2], keys_[3], keys_[4], keys_[5], pim_, params_,
+                                     biasTolerance_, pool_);
+    }
+
+    const CombinedPreintegrationState& preintegrated() const
+    {
+        return pim_;
+    }
+
+    const ImuParams& params() const
+    {
+        return *params_;
+    }
+
+    double biasTolerance() const
+    {
+        return biasTolerance_;
+    }
+
+    virtual void evaluateFixed(const minimatrix* const* x, double* e, double* const* H) const
+    {
+        double pose_i[12], pose_j[12], vel_i[3], vel_j[3], bias_i[6], bias_j[6];
+        read(x[0], pose_i, 12);
+        read(x[1], vel_i, 3);
+        read(x[2], pose_j, 12);
+        read(x[3], vel_j, 3);
+        read(x[4], bias_i, 6);
+        read(x[5], bias_j, 6);
+
+        double imuError[9], H0[54], H1[27], H2[54], H3[27], H4[54];
+        double* const Himu[5] = {H0, H1, H2, H3, H4};
+        double* const* const Hi = H != NULL ? Himu : NULL;
+        BiasCache c;
+        std::unique_lock<std::mutex> lock(cacheMutex_, std::try_to_lock);
+        if (lock.owns_lock() && cache_.valid && near(cache_.bias, bias_i))
+        {
+            c = cache_;
+        }
+        else
+        {
+            memcpy(c.bias, bias_i, sizeof(c.bias));
+            PreintegrationState_BiasCorrectedDelta(pim_.nav, bias_i, bias_i + 3, c.zeta);
+            SO3_Expmap(c.zeta, c.exp, c.Jr);
+            c.valid = true;
+            if (lock.owns_lock())
+                cache_ = c;
+        }
+        if (lock.owns_lock())
+            lock.unlock();
+        PreintegrationState_ComputeErrorFromDelta(pim_.nav, *params_, c.zeta, c.exp, c.Jr,
+                pose_i, vel_i, pose_j, vel_j, imuError, Hi);
+
+        for (int i = 0; i < 9; i++)
+            e[i] = imuError[i];
+        for (int i = 0; i < 6; i++)
+            e[9 + i] = bias_i[i] - bias_j[i];
+        if (H == NULL)
+            return;
+
+        // the bias rows depend on the biases only
+        const double* Hs[4] = {H0, H1, H2, H3};
+        const int dims[4] = {6, 3, 6, 3};
+        for (int k = 0; k < 4; k++)
+        {
+            memcpy(H[k], Hs[k], 9 * dims[k] * sizeof(double));
+            memset(H[k] + 9 * dims[k], 0, 6 * dims[k] * sizeof(double));
+        }
+        memcpy(H[4], H4, sizeof(H4));
+        memset(H[4] + 54, 0, 36 * sizeof(double));
+        memset(H[5], 0, 90 * sizeof(double));
+        for (int i = 0; i < 6; i++)
+        {
+            H[4][6 * (9 + i) + i] = 1.0;
+            H[5][6 * (9 + i) + i] = -1.0;
+        }
+    }
+
+private:
+    /// the bias-corrected delta at bias, with Expmap of its rotation and the right Jacobian
+    struct BiasCache
+    {
+        double bias[6];
+        double zeta[9];
+        double exp[9];
+        double Jr[9];
+        bool valid;
+    };
+
+    CombinedPreintegrationState pim_;
+    std::shared_ptr<const ImuParams> params_;
+    double biasTolerance_;
+    NoiseModelPool* pool_;      ///< holds the noise model when not NULL
+    mutable BiasCache cache_;
+    mutable std::mutex cacheMutex_;
+
+    bool near(const double* a, const double* b) const
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            if (!(fabs(a[i] - b[i]) <= biasTolerance_))
+                return false;
+        }
+        return true;
+    }
+
+    static std::vector<int> keys(int pose_i, int vel_i, int pose_j, int vel_j, int bias_i, int bias_j)
+    {
+        const int k[6] = {pose_i, vel_i, pose_j, vel_j, bias_i, bias_j};
+        return std::vector<int>(k, k + 6);
+    }
+
+    static GaussianNoiseModel* covariance(const CombinedPreintegrationState& pim)
+    {
+        minimatrix cov(15, 15);
+        for (size_t i = 0; i < 15; i++)
+        {
+            for (size_t j = 0; j < 15; j++)
+            {
+                cov.data[i * cov.prd + j] = pim.preintMeasCov[15 * i + j];
+            }
+        }
+        return GaussianNoiseModel::Covariance(cov);
+    }
+
+    /// the values row by row, Pose3 rotation rows then translation, ConstantBias accelerometer then gyroscope
+    static void read(const minimatrix* m, double* x, size_t size)
+    {
+        if (m->size1 * m->size2 != size)
+        {
+            throw std::invalid_argument("CombinedImuFactor: value does not have the storage of its type");
+        }
+        for (size_t i = 0; i < m->size1; i++)
+        {
+            for (size_t j = 0; j < m->size2; j++)
+            {
+                x[i * m->size2 + j] = m->data[i * m->prd + j];
+            }
+        }
+    }
+};
+
+#endif
+
+};
+
+#endif // COMBINEDIMUFACTOR_H
@@ -0,0 +1,135 @@
+#ifndef FIXEDIMUFACTOR_H
+#define FIXEDIMUFACTOR_H
+
+/**
+ * @file    FixedImuFactor.h
+ * @brief   ImuFactor on a PreintegrationState
+ */
+
+#include "../nonlinear/FixedNoiseModelFactor.h"
+#include "../navigation/PreintegrationState.h"
+#include "../linear/NoiseModelPool.h"
+
+namespace minisam
+{
+
+#ifdef TANGENT_PREINTEGRATION
+
+/**
+ * The 5-way ImuFactor (pose_i, vel_i, pose_j, vel_j, bias_i), with the
+ * preintegration held by value in a PreintegrationState and the parameters
+ * shared. The error and its Jacobians are computed in place on the state by
+ * PreintegrationState_ComputeError, without rebuilding a
+ * PreintegratedImuMeasurements per evaluation. The noise model is the
+ * Gaussian of the preintegrated covariance, built by the factor.
+ */
+class FixedImuFactor : public FixedNoiseModelFactor<9, 6, 3, 6, 3, 6>
+{
+public:
+    /**
+     * The factor builds its noise model from pim.preintMeasCov. Without
+     * \c pool the factor owns the model and deletes it; with one the model is
+     * interned in it and the factor only releases its reference, so the pool
+     * must outlive the factor.
+     */
+    FixedImuFactor(int pose_i, int vel_i, int pose_j, int vel_j, int bias,
+                   const PreintegrationState& pim, const std::shared_ptr<const ImuParams>& params,
+                   NoiseModelPool* pool = NULL)
+        : FixedNoiseModelFactor<9, 6, 3, 6, 3, 6>(NoiseModelPool_InternOrOwn(pool, covariance(pim)),
+                keys(pose_i, vel_i, pose_j, vel_j, bias)),
+          pim_(pim), params_(params), pool_(pool)
+    {
+    }
+
+    /// The factor of the state of \c pim, its noise model owned like in the constructor above
+    FixedImuFactor(int pose_i, int vel_i, int pose_j, int vel_j, int bias,
+                   const PreintegratedImuMeasurements& pim, NoiseModelPool* pool = NULL)
+        : FixedNoiseModelFactor<9, 6, 3, 6, 3, 6>(NULL, keys(pose_i, vel_i, pose_j, vel_j, bias)),
+          params_(ImuParams_Make(pim)), pool_(pool)
+    {
+        PreintegrationState_FromMeasurements(pim, &pim_);
+        noiseModel_ = NoiseModelPool_InternOrOwn(pool, covariance(pim_));
+    }
+
+    virtual ~FixedImuFactor()
+    {
+        NoiseModelPool_ReleaseOrDelete(pool_, noiseModel_);
+    }
+
+    /// a copy would release the noise model a second time, use clone()
+    FixedImuFactor(const FixedImuFactor&) = delete;
+    FixedImuFactor& operator=(const FixedImuFactor&) = delete;
+
+    /// @return a deep copy of this factor, sharing the parameters and the pool
+    virtual NoiseModelFactor* clone() const
+    {
+        return new FixedImuFactor(keys_[0], keys_[1], keys_[2], keys_[3], keys_[4], pim_, params_, pool_);
+    }
+
+    const PreintegrationState& preintegrated() const
+    {
+        return pim_;
+    }
+
+    const ImuParams& params() const
+    {
+        return *params_;
+    }
+
+    virtual void evaluateFixed(const minimatrix* const* x, double* e, double* const* H) const
+    {
+        double pose_i[12], pose_j[12], vel_i[3], vel_j[3], bias[6];
+        read(x[0], pose_i, 12);
+        read(x[1], vel_i, 3);
+        read(x[2], pose_j, 12);
+        read(x[3], vel_j, 3);
+        read(x[4], bias, 6);
+        PreintegrationState_ComputeError(pim_, *params_, pose_i, vel_i, pose_j, vel_j, bias, bias + 3, e, H);
+    }
+
+private:
+    PreintegrationState pim_;
+    std::shared_ptr<const ImuParams> params_;
+    NoiseModelPool* pool_;      ///< holds the noise model when not NULL
+
+    static std::vector<int> keys(int pose_i, int vel_i, int pose_j, int vel_j, int bias)
+    {
+        const int k[5] = {pose_i, vel_i, pose_j, vel_j, bias};
+        return std::vector<int>(k, k + 5);
+    }
+
+    static GaussianNoiseModel* covariance(const PreintegrationState& pim)
+    {
+        minimatrix cov(9, 9);
+        for (size_t i = 0; i < 9; i++)
+        {
+            for (size_t j = 0; j < 9; j++)
+            {
+                cov.data[i * cov.prd + j] = pim.preintMeasCov[9 * i + j];
+            }
+        }
+        return GaussianNoiseModel::Covariance(cov);
+    }
+
+    /// the values row by row, Pose3 rotation rows then translation, ConstantBias accelerometer then gyroscope
+    static void read(const minimatrix* m, double* x, size_t size)
+    {
+        if (m->size1 * m->size2 != size)
+        {
+            throw std::invalid_argument("FixedImuFactor: value does not have the storage of its type");
+        }
+        for (size_t i = 0; i < m->size1; i++)
+        {
+            for (size_t j = 0; j < m->size2; j++)
+            {
+                x[i * m->size2 + j] = m->data[i * m->prd + j];
+            }
+        }
+    }
+};
+
+#endif
+
+};
+
+#endif // FIXEDIMUFACTOR_H
@@ -0,0 +1,424 @@
+/**
+ * @file    ImuPreintegrationBatch.cpp
+ * @brief   Preintegration of a buffer of IMU measurements in one pass
+ */
+
+#include "ImuPreintegrationBatch.h"
+#include "../gmfconfig.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define IMUBATCH_INLINE __attribute__((always_inline)) inline
+#else
+#define IMUBATCH_INLINE inline
+#endif
+
+namespace minisam
+{
+
+#ifdef TANGENT_PREINTEGRATION
+
+/// Below this squared angle the coefficients use their Taylor series
+#define IMUBATCH_TAYLOR_THETA2 1e-4
+/// The fewest measurements a thread of the parallel integration is started for
+#define IMUBATCH_PARALLEL_CHUNK 1024
+
+/**
+ * The SO3 coefficients at theta, with W = [theta]x:
+ *   exp(W) = I + A W + B W^2, dexp = I - B W + C W^2, dexp^-1 = I + W / 2 + D W^2
+ * and dB, dC, the derivatives of B and C in theta^2 for the derivative of dexp.
+ */
+static IMUBATCH_INLINE void so3Coefficients(double t2, double& A, double& B, double& C, double& D,
+        double& dB, double& dC)
+{
+    if (t2 < IMUBATCH_TAYLOR_THETA2)
+    {
+        A = 1.0 - t2 / 6.0 + t2 * t2 / 120.0;
+        B = 0.5 - t2 / 24.0 + t2 * t2 / 720.0;
+        C = 1.0 / 6.0 - t2 / 120.0 + t2 * t2 / 5040.0;
+        D = 1.0 / 12.0 + t2 / 720.0 + t2 * t2 / 30240.0;
+        dB = -1.0 / 24.0 + t2 / 360.0 - t2 * t2 / 13440.0;
+        dC = -1.0 / 120.0 + t2 / 2520.0 - t2 * t2 / 120960.0;
+    }
+    else
+    {
+        const double t = sqrt(t2);
+        const double s = sin(t), c = cos(t);
+        A = s / t;
+        B = (1.0 - c) / t2;
+        C = (t - s) / (t2 * t);
+        const double half = 0.5 * t;
+        D = (1.0 - half * cos(half) / sin(half)) / t2;
+        dB = (0.5 * A - B) / t2;
+        dC = (0.5 * B - 1.5 * C) / t2;
+    }
+}
+
+/// M = I + a W + b W^2, row-major
+static IMUBATCH_INLINE void so3Matrix(const double* w, double t2, double a, double b, double* M)
+{
+    const double d = 1.0 - b * t2;
+    M[0] = d + b * w[0] * w[0];
+    M[4] = d + b * w[1] * w[1];
+    M[8] = d + b * w[2] * w[2];
+    M[1] = b * w[0] * w[1] - a * w[2];
+    M[3] = b * w[0] * w[1] + a * w[2];
+    M[2] = b * w[0] * w[2] + a * w[1];
+    M[6] = b * w[0] * w[2] - a * w[1];
+    M[5] = b * w[1] * w[2] - a * w[0];
+    M[7] = b * w[1] * w[2] + a * w[0];
+}
+
+static IMUBATCH_INLINE void cross(const double* a, const double* b, double* c)
+{
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/// Z = X Y for 3x3, Z may not alias X or Y
+static IMUBATCH_INLINE void mul33(const double* X, const double* Y, double* Z)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            Z[3 * i + j] = X[3 * i] * Y[j] + X[3 * i + 1] * Y[3 + j] + X[3 * i + 2] * Y[6 + j];
+        }
+    }
+}
+
+/// Z = X Y^T for 3x3
+static IMUBATCH_INLINE void mul33t(const double* X, const double* Y, double* Z)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            Z[3 * i + j] = X[3 * i] * Y[3 * j] + X[3 * i + 1] * Y[3 * j + 1] + X[3 * i + 2] * Y[3 * j + 2];
+        }
+    }
+}
+
+/**
+ * Y = F X for the ROWS x N X, with the structure of A in TangentPreintegration::update
+ *   A = [I + Htheta  0  0;  M dt^2/2  I  I dt;  M dt  0  I]
+ * where Htheta = w_tangent_H_theta dt and M = a_nav_H_theta. For ROWS = 9
+ * F = A, for ROWS = 15 F propagates the biases too,
+ *   F = [A  -B  -C;  0  I  0;  0  0  I]
+ * with B = [0; R dt^2/2; R dt] and C = [dexp^-1 dt; 0; 0].
+ */
+template<int ROWS, int N>
+static IMUBATCH_INLINE void applyF(const double* Htheta, const double* M, const double* R, const double* invDexp,
+                                   double dt, const double* X, double* Y)
+{
+    const double dt22 = 0.5 * dt * dt;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < N; j++)
+        {
+            const double x0 = X[j], x1 = X[N + j], x2 = X[2 * N + j];
+            const double h = Htheta[3 * i] * x0 + Htheta[3 * i + 1] * x1 + Htheta[3 * i + 2] * x2;
+            const double m = M[3 * i] * x0 + M[3 * i + 1] * x1 + M[3 * i + 2] * x2;
+            double ra = 0.0, rg = 0.0;
+            if (ROWS == 15)
+            {
+                const double* xa = X + 9 * N + j;
+                const double* xg = X + 12 * N + j;
+                ra = R[3 * i] * xa[0] + R[3 * i + 1] * xa[N] + R[3 * i + 2] * xa[2 * N];
+                rg = invDexp[3 * i] * xg[0] + invDexp[3 * i + 1] * xg[N] + invDexp[3 * i + 2] * xg[2 * N];
+            }
+            Y[i * N + j] = X[i * N + j] + h - dt * rg;
+            Y[(3 + i) * N + j] = X[(3 + i) * N + j] + dt * X[(6 + i) * N + j] + dt22 * (m - ra);
+            Y[(6 + i) * N + j] = X[(6 + i) * N + j] + dt * (m - ra);
+        }
+    }
+    for (int i = 9; i < ROWS; i++)
+    {
+        for (int j = 0; j < N; j++)
+        {
+            Y[i * N + j] = X[i * N + j];
+        }
+    }
+}
+
+/**
+ * One step of TangentPreintegration::update followed by the covariance
+ * propagation of PreintegratedImuMeasurements::integrateMeasurement
+ *   zeta   = UpdatePreintegrated(acc - biasAcc, omega - biasOmega, dt, zeta, A, B, C)
+ *   H_bias = A H_bias - B (accelerometer), A H_bias - C (gyroscope)
+ *   cov    = A cov A^T + B aCov / dt B^T + C wCov / dt C^T + iCov dt on the position block
+ * with B = [0; R dt^2/2; R dt] and C = [dexp^-1 dt; 0; 0]. With ROWS = 15
+ * \c cov also holds the biases, propagated by F of applyF, which random walk
+ * with biasAccCovariance dt and biasOmegaCovariance dt.
+ */
+template<int ROWS>
+static IMUBATCH_INLINE void integrate(PreintegrationState& s, double* cov, const ImuParams& p,
+                                      const double* measuredAcc, const double* measuredOmega, double dt)
+{
+    const double acc[3] = {measuredAcc[0] - s.biasHatAcc[0], measuredAcc[1] - s.biasHatAcc[1], measuredAcc[2] - s.biasHatAcc[2]};
+    const double omega[3] = {measuredOmega[0] - s.biasHatOmega[0], measuredOmega[1] - s.biasHatOmega[1],
+                             measuredOmega[2] - s.biasHatOmega[2]
+                            };
+    const double* theta = s.preintegrated;
+    const double t2 = theta[0] * theta[0] + theta[1] * theta[1] + theta[2] * theta[2];
+    double cA, cB, cC, cD, dB, dC;
+    so3Coefficients(t2, cA, cB, cC, cD, dB, dC);
+    double R[9], dexp[9], invDexp[9];
+    so3Matrix(theta, t2, cA, cB, R);
+    so3Matrix(theta, t2, -cB, cC, dexp);
+    so3Matrix(theta, t2, 0.5, cD, invDexp);
+
+    // w = dexp^-1 omega and the derivative of dexp w in theta,
+    //   -2 dB (theta x w) theta^T + B [w]x + 2 dC (theta x (theta x w)) theta^T
+    //   + C ((theta . w) I + theta w^T - 2 w theta^T)
+    double w[3];
+    for (int i = 0; i < 3; i++)
+        w[i] = invDexp[3 * i] * omega[0] + invDexp[3 * i + 1] * omega[1] + invDexp[3 * i + 2] * omega[2];
+    double tw[3], ttw[3];
+    cross(theta, w, tw);
+    cross(theta, tw, ttw);
+    const double tdw = theta[0] * w[0] + theta[1] * w[1] + theta[2] * w[2];
+    double Dw[9];
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            Dw[3 * i + j] = 2.0 * (dC * ttw[i] - dB * tw[i]) * theta[j]
+                            + cC * (theta[i] * w[j] - 2.0 * w[i] * theta[j]);
+        }
+        Dw[4 * i] += cC * tdw;
+    }
+    Dw[1] -= cB * w[2];
+    Dw[2] += cB * w[1];
+    Dw[3] += cB * w[2];
+    Dw[5] -= cB * w[0];
+    Dw[6] -= cB * w[1];
+    Dw[7] += cB * w[0];
+    // Htheta = -dexp^-1 Dw dt
+    double Htheta[9];
+    mul33(invDexp, Dw, Htheta);
+    for (int k = 0; k < 9; k++)
+        Htheta[k] *= -dt;
+
+    // a_nav = R acc and its derivative M = R [-acc]x dexp
+    double a_nav[3];
+    for (int i = 0; i < 3; i++)
+        a_nav[i] = R[3 * i] * acc[0] + R[3 * i + 1] * acc[1] + R[3 * i + 2] * acc[2];
+    const double skewAcc[9] = {0.0, acc[2], -acc[1], -acc[2], 0.0, acc[0], acc[1], -acc[0], 0.0};
+    double RS[9], M[9];
+    mul33(R, skewAcc, RS);
+    mul33(RS, dexp, M);
+
+    // the bias Jacobians and the covariance with the Jacobian A of the old state
+    const double dt22 = 0.5 * dt * dt;
+    double X[ROWS * ROWS], T[ROWS * ROWS];
+    applyF<9, 3>(Htheta, M, R, invDexp, dt, s.H_biasAcc, X);
+    memcpy(s.H_biasAcc, X, sizeof(double) * 27);
+    applyF<9, 3>(Htheta, M, R, invDexp, dt, s.H_biasOmega, X);
+    memcpy(s.H_biasOmega, X, sizeof(double) * 27);
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            s.H_biasAcc[9 + 3 * i + j] -= R[3 * i + j] * dt22;
+            s.H_biasAcc[18 + 3 * i + j] -= R[3 * i + j] * dt;
+            s.H_biasOmega[3 * i + j] -= invDexp[3 * i + j] * dt;
+        }
+    }
+    // F cov F^T = F (F cov)^T, cov being symmetric
+    applyF<ROWS, ROWS>(Htheta, M, R, invDexp, dt, cov, X);
+    for (int i = 0; i < ROWS; i++)
+    {
+        for (int j = 0; j < ROWS; j++)
+        {
+            T[ROWS * j + i] = X[ROWS * i + j];
+        }
+    }
+    applyF<ROWS, ROWS>(Htheta, M, R, invDexp, dt, T, cov);
+    double RQ[9], Qa[9], JQ[9], Qw[9];
+    mul33(R, p.accelerometerCovariance, RQ);
+    mul33t(RQ, R, Qa);
+    mul33(invDexp, p.gyroscopeCovariance, JQ);
+    mul33t(JQ, invDexp, Qw);
+    const double pp = dt22 * dt22 / dt, pv = dt22, vv = dt;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            const double q = Qa[3 * i + j];
+            cov[ROWS * i + j] += Qw[3 * i + j] * dt;
+            cov[ROWS * (3 + i) + 3 + j] += q * pp + p.integrationCovariance[3 * i + j] * dt;
+            cov[ROWS * (3 + i) + 6 + j] += q * pv;
+            cov[ROWS * (6 + i) + 3 + j] += q * pv;
+            cov[ROWS * (6 + i) + 6 + j] += q * vv;
+            if (ROWS == 15)
+            {
+                cov[ROWS * (9 + i) + 9 + j] += p.biasAccCovariance[3 * i + j] * dt;
+                cov[ROWS * (12 + i) + 12 + j] += p.biasOmegaCovariance[3 * i + j] * dt;
+            }
+        }
+    }
+
+    // the preintegrated vector
+    for (int i = 0; i < 3; i++)
+    {
+        s.preintegrated[i] += w[i] * dt;
+        s.preintegrated[3 + i] += s.preintegrated[6 + i] * dt + a_nav[i] * dt22;
+        s.preintegrated[6 + i] += a_nav[i] * dt;
+    }
+    s.deltaTij += dt;
+}
+
+MINISAM_CLONES
+static void integrateBatch(PreintegrationState& s, const ImuParams& p, const double* measuredAccs,
+                           const double* measuredOmegas, const double* dts, size_t n)
+{
+    for (size_t k = 0; k < n; k++)
+    {
+        integrate<9>(s, s.preintMeasCov, p, measuredAccs + 3 * k, measuredOmegas + 3 * k, dts[k]);
+    }
+}
+
+MINISAM_CLONES
+static void integrateBatch(CombinedPreintegrationState& s, const ImuParams& p, const double* measuredAccs,
+                           const double* measuredOmegas, const double* dts, size_t n)
+{
+    for (size_t k = 0; k < n; k++)
+    {
+        integrate<15>(s.nav, s.preintMeasCov, p, measuredAccs + 3 * k, measuredOmegas + 3 * k, dts[k]);
+    }
+}
+
+static void checkIntervals(const double* dts, size_t n)
+{
+    for (size_t k = 0; k < n; k++)
+    {
+        if (!(dts[k] > 0.0))
+        {
+            throw std::invalid_argument("IntegrateBatch: time interval not positive");
+        }
+    }
+}
+
+void PreintegrationState_IntegrateBatch(PreintegrationState* state, const ImuParams& params,
+                                        const double* measuredAccs, const double* measuredOmegas,
+                                        const double* dts, size_t n)
+{
+    checkIntervals(dts, n);
+    integrateBatch(*state, params, measuredAccs, measuredOmegas, dts, n);
+}
+
+void CombinedPreintegrationState_IntegrateBatch(CombinedPreintegrationState* state, const ImuParams& params,
+        const double* measuredAccs, const double* measuredOmegas,
+        const double* dts, size_t n)
+{
+    checkIntervals(dts, n);
+    integrateBatch(*state, params, measuredAccs, measuredOmegas, dts, n);
+    for (int i = 0; i < 9; i++)
+    {
+        for (int j = 0; j < 9; j++)
+        {
+            state->nav.preintMeasCov[9 * i + j] = state->preintMeasCov[15 * i + j];
+        }
+    }
+}
+
+void PreintegratedImuMeasurements_IntegrateBatch(PreintegratedImuMeasurements* pim,
+        const double* measuredAccs, const double* measuredOmegas,
+        const double* dts, size_t n)
+{
+    PreintegrationState state;
+    PreintegrationState_FromMeasurements(*pim, &state);
+    checkIntervals(dts, n);
+    integrateBatch(state, *ImuParams_Make(*pim), measuredAccs, measuredOmegas, dts, n);
+    PreintegrationState_ToMeasurements(state, pim);
+}
+
+void PreintegratedImuMeasurements_IntegrateBatch(PreintegratedImuMeasurements* pim,
+        const minimatrix& measuredAccs, const minimatrix& measuredOmegas,
+        const minimatrix& dts)
+{
+    const size_t n = measuredAccs.size2;
+    if (n == 0)
+        return;
+    if (measuredAccs.size1 != 3 || measuredOmegas.size1 != 3 || measuredOmegas.size2 != n
+            || dts.size1 * dts.size2 != n)
+    {
+        throw std::invalid_argument("PreintegratedImuMeasurements_IntegrateBatch: measurements of different sizes");
+    }
+    std::vector<double> buffer(7 * n);
+    double* accs = &buffer[0];
+    double* omegas = accs + 3 * n;
+    double* intervals = omegas + 3 * n;
+    for (size_t k = 0; k < n; k++)
+    {
+        for (size_t i = 0; i < 3; i++)
+        {
+            accs[3 * k + i] = measuredAccs.data[i * measuredAccs.prd + k];
+            omegas[3 * k + i] = measuredOmegas.data[i * measuredOmegas.prd + k];
+        }
+        intervals[k] = dts.size1 == 1 ? dts.data[k] : dts.data[k * dts.prd];
+    }
+    PreintegratedImuMeasurements_IntegrateBatch(pim, accs, omegas, intervals, n);
+}
+
+void PreintegrationState_IntegrateParallel(PreintegrationState* state, const ImuParams& params,
+        const double* measuredAccs, const double* measuredOmegas,
+        const double* dts, size_t n, int threads)
+{
+    checkIntervals(dts, n);
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    const int chunks = (int)std::max((size_t)1, std::min((size_t)threads, n / IMUBATCH_PARALLEL_CHUNK));
+    if (chunks == 1)
+    {
+        integrateBatch(*state, params, measuredAccs, measuredOmegas, dts, n);
+        return;
+    }
+
+    // chunk 0 continues state, the others start at its bias estimate; chunk
+    // c, once integrated, merges in c + 1, c + 2, c + 4, ... in a binary tree,
+    // joining the thread of each before reading its chunk
+    std::vector<PreintegrationState> parts(chunks);
+    parts[0] = *state;
+    for (int c = 1; c < chunks; c++)
+        PreintegrationState_Reset(&parts[c], state->biasHatAcc, state->biasHatOmega);
+    std::vector<std::thread> pool(chunks);
+    auto work = [&](int c)
+    {
+        const size_t begin = n * c / chunks, end = n * (c + 1) / chunks;
+        integrateBatch(parts[c], params, measuredAccs + 3 * begin, measuredOmegas + 3 * begin, dts + begin,
+                       end - begin);
+        for (int stride = 1; c % (2 * stride) == 0 && c + stride < chunks; stride *= 2)
+        {
+            pool[c + stride].join();
+            PreintegrationState_Merge(&parts[c], parts[c + stride]);
+        }
+    };
+    for (int c = chunks - 1; c > 0; c--)
+    {
+        pool[c] = std::thread(work, c);
+    }
+    work(0);
+    *state = parts[0];
+}
+
+void PreintegratedImuMeasurements_IntegrateParallel(PreintegratedImuMeasurements* pim,
+        const double* measuredAccs, const double* measuredOmegas,
+        const double* dts, size_t n, int threads)
+{
+    PreintegrationState state;
+    PreintegrationState_FromMeasurements(*pim, &state);
+    PreintegrationState_IntegrateParallel(&state, *ImuParams_Make(*pim), measuredAccs, measuredOmegas, dts, n,
+                                          threads);
+    PreintegrationState_ToMeasurements(state, pim);
+}
+
+#endif
+
+};
@@ -0,0 +1,80 @@
+#ifndef IMUPREINTEGRATIONBATCH_H
+#define IMUPREINTEGRATIONBATCH_H
+
+/**
+ * @file    ImuPreintegrationBatch.h
+ * @brief   Preintegration of a buffer of IMU measurements in one pass
+ */
+
+#include "../navigation/PreintegrationState.h"
+#include <stddef.h>
+
+namespace minisam
+{
+
+#ifdef TANGENT_PREINTEGRATION
+/**
+ * integrateMeasurement for n measurements, in one loop over fixed-size
+ * storage: the preintegrated vector, its bias Jacobians and the covariance
+ * are read once from \c pim, updated per measurement with the structure of
+ * the A, B, C Jacobians of TangentPreintegration::update (only their nonzero
+ * blocks are formed, no minimatrix is allocated) and written back at the end.
+ * - measuredAccs, measuredOmegas: n measurements, double[3] each
+ * - dts: n time intervals
+ * The preintegrated vector is that of integrateMeasurement. The derivative of
+ * dexp^-1 omega in theta, in A, is the exact one, where the library's update
+ * keeps only part of it: the bias Jacobians and the covariance differ from
+ * those of integrateMeasurement by the missing terms, of order |theta| dt.
+ * Throws, leaving \c pim unchanged, if a time interval is not positive.
+ */
+void PreintegratedImuMeasurements_IntegrateBatch(PreintegratedImuMeasurements* pim,
+        const double* measuredAccs, const double* measuredOmegas,
+        const double* dts, size_t n);
+
+/// The batch integration of a PreintegrationState with its parameters
+void PreintegrationState_IntegrateBatch(PreintegrationState* state, const ImuParams& params,
+                                        const double* measuredAccs, const double* measuredOmegas,
+                                        const double* dts, size_t n);
+
+/**
+ * The batch integration of a CombinedPreintegrationState: the 15x15
+ * covariance propagates the biases, with the Jacobians of the preintegrated
+ * vector in them, and their random walk, biasAccCovariance and
+ * biasOmegaCovariance per second, as in PreintegratedCombinedMeasurements of
+ * GTSAM. state->nav.preintMeasCov is set to its top-left 9x9 block.
+ */
+void CombinedPreintegrationState_IntegrateBatch(CombinedPreintegrationState* state, const ImuParams& params,
+        const double* measuredAccs, const double* measuredOmegas,
+        const double* dts, size_t n);
+
+/**
+ * PreintegrationState_IntegrateBatch on \c threads threads, \c threads <= 0
+ * for every hardware thread: the measurements are split in contiguous
+ * chunks of at least IMUBATCH_PARALLEL_CHUNK (1024) measurements, each
+ * integrated on its own thread from the bias estimate of \c state, and the
+ * chunks are merged pairwise in a binary tree with PreintegrationState_Merge.
+ * The merge composes rotations exactly where the sequential update of theta
+ * is first order in omega dt, so the results differ by that integration
+ * error (about 1e-5 relative over minutes of 1 kHz data), the merged
+ * rotation being the closer to the product of the measured rotations. The
+ * preintegrated rotation must stay below pi, where both share a chart.
+ * Throws, leaving \c state unchanged, if a time interval is not positive.
+ */
+void PreintegrationState_IntegrateParallel(PreintegrationState* state, const ImuParams& params,
+        const double* measuredAccs, const double* measuredOmegas,
+        const double* dts, size_t n, int threads = 0);
+
+/// PreintegrationState_IntegrateParallel on the state of \c pim
+void PreintegratedImuMeasurements_IntegrateParallel(PreintegratedImuMeasurements* pim,
+        const double* measuredAccs, const double* measuredOmegas,
+        const double* dts, size_t n, int threads = 0);
+
+/// The batch integration with the arguments of integrateMeasurements, measurements in matrix columns
+void PreintegratedImuMeasurements_IntegrateBatch(PreintegratedImuMeasurements* pim,
+        const minimatrix& measuredAccs, const minimatrix& measuredOmegas,
+        const minimatrix& dts);
+#endif
+
+};
+
+#endif // IMUPREINTEGRATIONBATCH_H
@@ -0,0 +1,505 @@
+/**
+ * @file    PreintegrationState.cpp
+ * @brief   IMU preintegration in fixed-size structures
+ */
+
+#include "PreintegrationState.h"
+#include "../geometry/LieKernels.h"
+#include <string.h>
+
+namespace minisam
+{
+
+#ifdef TANGENT_PREINTEGRATION
+
+/// Rows of the PreintegrationParams storage
+#define PREINTEGRATIONSTATE_PARAMS_ROWS 11
+/// Rows of the PreintegratedImuMeasurements storage: the 9x9 covariance, the params, then the TangentPreintegration
+#define PREINTEGRATIONSTATE_ROW_COV 0
+#define PREINTEGRATIONSTATE_ROW_PARAMS 27
+#define PREINTEGRATIONSTATE_ROW_BIAS 38
+#define PREINTEGRATIONSTATE_ROW_DT 40
+#define PREINTEGRATIONSTATE_ROW_PREINTEGRATED 41
+#define PREINTEGRATIONSTATE_ROW_H_BIASACC 44
+#define PREINTEGRATIONSTATE_ROW_H_BIASOMEGA 53
+#define PREINTEGRATIONSTATE_ROWS 62
+
+static void readRows(const minimatrix& m, size_t row, size_t rows, double* x)
+{
+    for (size_t i = 0; i < rows; i++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            x[3 * i + j] = m.data[(row + i) * m.prd + j];
+        }
+    }
+}
+
+static void writeRows(minimatrix* m, size_t row, size_t rows, const double* x)
+{
+    for (size_t i = 0; i < rows; i++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            m->data[(row + i) * m->prd + j] = x[3 * i + j];
+        }
+    }
+}
+
+static void checkMeasurements(const minimatrix& pim)
+{
+    if (pim.size1 != PREINTEGRATIONSTATE_ROWS || pim.size2 != 3)
+    {
+        throw std::invalid_argument("PreintegrationState: not a PreintegratedImuMeasurements");
+    }
+}
+
+/// ImuParams from the 11x3 PreintegrationParams storage starting at \c row
+static std::shared_ptr<const ImuParams> makeParams(const minimatrix& m, size_t row)
+{
+    std::shared_ptr<ImuParams> params(new ImuParams());
+    memset(params.get(), 0, sizeof(ImuParams));
+    readRows(m, row, 3, params->gyroscopeCovariance);
+    readRows(m, row + 3, 3, params->accelerometerCovariance);
+    readRows(m, row + 6, 3, params->integrationCovariance);
+    readRows(m, row + 9, 1, params->omegaCoriolis);
+    readRows(m, row + 10, 1, params->n_gravity);
+    return params;
+}
+
+std::shared_ptr<const ImuParams> ImuParams_Make(const PreintegrationParams& p)
+{
+    if (p.size1 != PREINTEGRATIONSTATE_PARAMS_ROWS || p.size2 != 3)
+    {
+        throw std::invalid_argument("ImuParams_Make: not a PreintegrationParams");
+    }
+    return makeParams(p, 0);
+}
+
+std::shared_ptr<const ImuParams> ImuParams_Make(const PreintegrationParams& p, const minimatrix& biasAccCovariance,
+        const minimatrix& biasOmegaCovariance)
+{
+    if (biasAccCovariance.size1 != 3 || biasAccCovariance.size2 != 3
+            || biasOmegaCovariance.size1 != 3 || biasOmegaCovariance.size2 != 3)
+    {
+        throw std::invalid_argument("ImuParams_Make: bias covariances are not 3x3");
+    }
+    std::shared_ptr<ImuParams> params(new ImuParams(*ImuParams_Make(p)));
+    readRows(biasAccCovariance, 0, 3, params->biasAccCovariance);
+    readRows(biasOmegaCovariance, 0, 3, params->biasOmegaCovariance);
+    return params;
+}
+
+std::shared_ptr<const ImuParams> ImuParams_Make(const PreintegratedImuMeasurements& pim)
+{
+    checkMeasurements(pim);
+    return makeParams(pim, PREINTEGRATIONSTATE_ROW_PARAMS);
+}
+
+void PreintegrationState_Reset(PreintegrationState* state, const double* biasAcc, const double* biasOmega)
+{
+    memset(state, 0, sizeof(PreintegrationState));
+    for (int i = 0; i < 3; i++)
+    {
+        state->biasHatAcc[i] = biasAcc != NULL ? biasAcc[i] : 0.0;
+        state->biasHatOmega[i] = biasOmega != NULL ? biasOmega[i] : 0.0;
+    }
+}
+
+void CombinedPreintegrationState_Reset(CombinedPreintegrationState* state, const double* biasAcc,
+                                       const double* biasOmega)
+{
+    PreintegrationState_Reset(&state->nav, biasAcc, biasOmega);
+    memset(state->preintMeasCov, 0, sizeof(state->preintMeasCov));
+}
+
+void PreintegrationState_FromMeasurements(const PreintegratedImuMeasurements& pim, PreintegrationState* state)
+{
+    checkMeasurements(pim);
+    readRows(pim, PREINTEGRATIONSTATE_ROW_PREINTEGRATED, 3, state->preintegrated);
+    state->deltaTij = pim.data[PREINTEGRATIONSTATE_ROW_DT * pim.prd];
+    readRows(pim, PREINTEGRATIONSTATE_ROW_BIAS, 1, state->biasHatAcc);
+    readRows(pim, PREINTEGRATIONSTATE_ROW_BIAS + 1, 1, state->biasHatOmega);
+    readRows(pim, PREINTEGRATIONSTATE_ROW_H_BIASACC, 9, state->H_biasAcc);
+    readRows(pim, PREINTEGRATIONSTATE_ROW_H_BIASOMEGA, 9, state->H_biasOmega);
+    readRows(pim, PREINTEGRATIONSTATE_ROW_COV, 27, state->preintMeasCov);
+}
+
+void PreintegrationState_ToMeasurements(const PreintegrationState& state, PreintegratedImuMeasurements* pim)
+{
+    checkMeasurements(*pim);
+    writeRows(pim, PREINTEGRATIONSTATE_ROW_PREINTEGRATED, 3, state.preintegrated);
+    pim->data[PREINTEGRATIONSTATE_ROW_DT * pim->prd] = state.deltaTij;
+    writeRows(pim, PREINTEGRATIONSTATE_ROW_BIAS, 1, state.biasHatAcc);
+    writeRows(pim, PREINTEGRATIONSTATE_ROW_BIAS + 1, 1, state.biasHatOmega);
+    writeRows(pim, PREINTEGRATIONSTATE_ROW_H_BIASACC, 9, state.H_biasAcc);
+    writeRows(pim, PREINTEGRATIONSTATE_ROW_H_BIASOMEGA, 9, state.H_biasOmega);
+    writeRows(pim, PREINTEGRATIONSTATE_ROW_COV, 27, state.preintMeasCov);
+}
+
+void PreintegrationState_BiasCorrectedDelta(const PreintegrationState& state, const double* biasAcc,
+        const double* biasOmega, double* zeta)
+{
+    const double da[3] = {biasAcc[0] - state.biasHatAcc[0], biasAcc[1] - state.biasHatAcc[1],
+                          biasAcc[2] - state.biasHatAcc[2]
+                         };
+    const double dw[3] = {biasOmega[0] - state.biasHatOmega[0], biasOmega[1] - state.biasHatOmega[1],
+                          biasOmega[2] - state.biasHatOmega[2]
+                         };
+    for (int i = 0; i < 9; i++)
+    {
+        const double* Ha = state.H_biasAcc + 3 * i;
+        const double* Hw = state.H_biasOmega + 3 * i;
+        zeta[i] = state.preintegrated[i] + Ha[0] * da[0] + Ha[1] * da[1] + Ha[2] * da[2]
+                  + Hw[0] * dw[0] + Hw[1] * dw[1] + Hw[2] * dw[2];
+    }
+}
+
+/// r = R^T v
+static inline void unrotate(const double* R, const double* v, double* r)
+{
+    for (int i = 0; i < 3; i++)
+        r[i] = R[i] * v[0] + R[3 + i] * v[1] + R[6 + i] * v[2];
+}
+
+/// r = R v
+static inline void rotate(const double* R, const double* v, double* r)
+{
+    for (int i = 0; i < 3; i++)
+        r[i] = R[3 * i] * v[0] + R[3 * i + 1] * v[1] + R[3 * i + 2] * v[2];
+}
+
+/// C = A B, A is r x k, B is k x c, with row strides lda, ldb, ldc
+static void mul(const double* A, int lda, const double* B, int ldb, double* C, int ldc, int r, int k, int c)
+{
+    for (int i = 0; i < r; i++)
+    {
+        for (int j = 0; j < c; j++)
+        {
+            double s = 0.0;
+            for (int l = 0; l < k; l++)
+                s += A[i * lda + l] * B[l * ldb + j];
+            C[i * ldc + j] = s;
+        }
+    }
+}
+
+/// the 3x3 block (bi, bj) of a 9x9 matrix M set to s S, S NULL for s I
+static void setBlock(double* M, int bi, int bj, const double* S, double s)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            M[9 * (3 * bi + i) + 3 * bj + j] = S != NULL ? s * S[3 * i + j] : (i == j ? s : 0.0);
+        }
+    }
+}
+
+static void addSkew(double* M, int bi, int bj, const double* v, double s)
+{
+    double* B = M + 9 * 3 * bi + 3 * bj;
+    B[1] -= s * v[2];
+    B[2] += s * v[1];
+    B[9] += s * v[2];
+    B[11] -= s * v[0];
+    B[18] -= s * v[1];
+    B[19] += s * v[0];
+}
+
+/// C = A B A^T + C for 9x9 A and B
+static void addCongruence(const double* A, const double* B, double* C)
+{
+    double AB[81];
+    mul(A, 9, B, 9, AB, 9, 9, 9, 9);
+    for (int i = 0; i < 9; i++)
+    {
+        for (int j = 0; j < 9; j++)
+        {
+            double s = 0.0;
+            for (int l = 0; l < 9; l++)
+                s += AB[9 * i + l] * A[9 * j + l];
+            C[9 * i + j] += s;
+        }
+    }
+}
+
+void PreintegrationState_Merge(PreintegrationState* state01, const PreintegrationState& state12)
+{
+    double zeta12[9];
+    PreintegrationState_BiasCorrectedDelta(state12, state01->biasHatAcc, state01->biasHatOmega, zeta12);
+    const double* zeta01 = state01->preintegrated;
+    const double dt12 = state12.deltaTij;
+
+    // TangentPreintegration::Compose: R02 = R01 R12, p02 = p01 + v01 dt12 + R01 p12, v02 = v01 + R01 v12
+    double R01[9], J01[9], R12[9], J12[9], R02[9], JrInv02[9], zeta02[9];
+    SO3_Expmap(zeta01, R01, J01);
+    SO3_Expmap(zeta12, R12, J12);
+    mul(R01, 3, R12, 3, R02, 3, 3, 3, 3);
+    SO3_Logmap(R02, zeta02, JrInv02);
+    double Rp[3], Rv[3];
+    rotate(R01, zeta12 + 3, Rp);
+    rotate(R01, zeta12 + 6, Rv);
+    for (int k = 0; k < 3; k++)
+    {
+        zeta02[3 + k] = zeta01[3 + k] + dt12 * zeta01[6 + k] + Rp[k];
+        zeta02[6 + k] = zeta01[6 + k] + Rv[k];
+    }
+
+    // H1 = D_zeta02_zeta01, H2 = D_zeta02_zeta12
+    double H1[81], H2[81], T[9], U[9];
+    memset(H1, 0, sizeof(H1));
+    memset(H2, 0, sizeof(H2));
+    // theta02 = Log(Exp(theta01) Exp(theta12)): Jr^-1(theta02) R12^T Jr(theta01) and Jr^-1(theta02) Jr(theta12)
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            double s = 0.0;
+            for (int l = 0; l < 3; l++)
+                s += JrInv02[3 * i + l] * R12[3 * j + l];
+            U[3 * i + j] = s;
+        }
+    }
+    mul(U, 3, J01, 3, T, 3, 3, 3, 3);
+    setBlock(H1, 0, 0, T, 1.0);
+    mul(JrInv02, 3, J12, 3, T, 3, 3, 3, 3);
+    setBlock(H2, 0, 0, T, 1.0);
+    // R01 Exp(J01 d) p12 = R01 p12 - R01 [p12]x J01 d, and the same for v12
+    double Sp[9], Sv[9];
+    const double* p12 = zeta12 + 3;
+    const double* v12 = zeta12 + 6;
+    const double Kp[9] = {0.0, -p12[2], p12[1], p12[2], 0.0, -p12[0], -p12[1], p12[0], 0.0};
+    const double Kv[9] = {0.0, -v12[2], v12[1], v12[2], 0.0, -v12[0], -v12[1], v12[0], 0.0};
+    mul(R01, 3, Kp, 3, T, 3, 3, 3, 3);
+    mul(T, 3, J01, 3, Sp, 3, 3, 3, 3);
+    mul(R01, 3, Kv, 3, T, 3, 3, 3, 3);
+    mul(T, 3, J01, 3, Sv, 3, 3, 3, 3);
+    setBlock(H1, 1, 0, Sp, -1.0);
+    setBlock(H1, 1, 1, NULL, 1.0);
+    setBlock(H1, 1, 2, NULL, dt12);
+    setBlock(H1, 2, 0, Sv, -1.0);
+    setBlock(H1, 2, 2, NULL, 1.0);
+    setBlock(H2, 1, 1, R01, 1.0);
+    setBlock(H2, 2, 2, R01, 1.0);
+
+    double Ha[27], Hw[27], tmp[27];
+    mul(H1, 9, state01->H_biasAcc, 3, Ha, 3, 9, 9, 3);
+    mul(H2, 9, state12.H_biasAcc, 3, tmp, 3, 9, 9, 3);
+    for (int i = 0; i < 27; i++)
+        Ha[i] += tmp[i];
+    mul(H1, 9, state01->H_biasOmega, 3, Hw, 3, 9, 9, 3);
+    mul(H2, 9, state12.H_biasOmega, 3, tmp, 3, 9, 9, 3);
+    for (int i = 0; i < 27; i++)
+        Hw[i] += tmp[i];
+
+    double cov[81];
+    memset(cov, 0, sizeof(cov));
+    addCongruence(H1, state01->preintMeasCov, cov);
+    addCongruence(H2, state12.preintMeasCov, cov);
+
+    memcpy(state01->preintegrated, zeta02, sizeof(zeta02));
+    memcpy(state01->H_biasAcc, Ha, sizeof(Ha));
+    memcpy(state01->H_biasOmega, Hw, sizeof(Hw));
+    memcpy(state01->preintMeasCov, cov, sizeof(cov));
+    state01->deltaTij += dt12;
+}
+
+void PreintegrationState_ComputeError(const PreintegrationState& state, const ImuParams& params,
+                                      const double* pose_i, const double* vel_i,
+                                      const double* pose_j, const double* vel_j,
+                                      const double* biasAcc, const double* biasOmega,
+                                      double* error, double* const* H)
+{
+    double zeta[9];
+    PreintegrationState_BiasCorrectedDelta(state, biasAcc, biasOmega, zeta);
+    PreintegrationState_ComputeErrorFromDelta(state, params, zeta, NULL, NULL, pose_i, vel_i, pose_j, vel_j, error, H);
+}
+
+void PreintegrationState_ComputeErrorFromDelta(const PreintegrationState& state, const ImuParams& params,
+        const double* zeta, const double* expTheta, const double* JrTheta,
+        const double* pose_i, const double* vel_i,
+        const double* pose_j, const double* vel_j,
+        double* error, double* const* H)
+{
+    const double* Ri = pose_i;
+    const double* Rj = pose_j;
+    const double dt = state.deltaTij, dt22 = 0.5 * dt * dt;
+    const double* w = params.omegaCoriolis;
+
+    // NavState::correctPIM: the bias-corrected delta with the initial
+    // velocity, gravity and the Coriolis terms in the body frame of i
+    double xi[9];
+    memcpy(xi, zeta, sizeof(xi));
+    const double wxv[3] = {w[1] * vel_i[2] - w[2] * vel_i[1], w[2] * vel_i[0] - w[0] * vel_i[2],
+                           w[0] * vel_i[1] - w[1] * vel_i[0]
+                          };
+    const double nR[3] = {-dt * w[0], -dt * w[1], -dt * w[2]};
+    const double nP[3] = {-dt * dt * wxv[0], -dt * dt * wxv[1], -dt * dt * wxv[2]};
+    const double nV[3] = {-2.0 * dt * wxv[0], -2.0 * dt * wxv[1], -2.0 * dt * wxv[2]};
+    double bv[3], bg[3], bR[3], bP[3], bV[3];
+    unrotate(Ri, vel_i, bv);
+    unrotate(Ri, params.n_gravity, bg);
+    unrotate(Ri, nR, bR);
+    unrotate(Ri, nP, bP);
+    unrotate(Ri, nV, bV);
+    for (int k = 0; k < 3; k++)
+    {
+        xi[k] += bR[k];
+        xi[3 + k] += dt * bv[k] + dt22 * bg[k] + bP[k];
+        xi[6 + k] += dt * bg[k] + bV[k];
+    }
+
+    // NavState::retract: the predicted state j
+    double bRc[9], Jr[9], Rc[9], dP[3], dV[3];
+    const bool coriolis = w[0] != 0.0 || w[1] != 0.0 || w[2] != 0.0;
+    if (expTheta != NULL && !coriolis && (H == NULL || JrTheta != NULL))
+    {
+        memcpy(bRc, expTheta, sizeof(bRc));
+        if (H != NULL)
+            memcpy(Jr, JrTheta, sizeof(Jr));
+    }
+    else
+    {
+        SO3_Expmap(xi, bRc, H != NULL ? Jr : NULL);
+    }
+    mul(Ri, 3, bRc, 3, Rc, 3, 3, 3, 3);
+    rotate(Ri, xi + 3, dP);
+    rotate(Ri, xi + 6, dV);
+    const double* ti = pose_i + 9;
+    const double* tj = pose_j + 9;
+    const double tc[3] = {ti[0] + dP[0], ti[1] + dP[1], ti[2] + dP[2]};
+    const double vc[3] = {vel_i[0] + dV[0], vel_i[1] + dV[1], vel_i[2] + dV[2]};
+
+    // NavState::localCoordinates of the prediction at state j
+    double dR[9], JrInv[9];
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            dR[3 * i + j] = Rj[i] * Rc[j] + Rj[3 + i] * Rc[3 + j] + Rj[6 + i] * Rc[6 + j];
+        }
+    }
+    SO3_Logmap(dR, error, H != NULL ? JrInv : NULL);
+    const double et[3] = {tc[0] - tj[0], tc[1] - tj[1], tc[2] - tj[2]};
+    const double ev[3] = {vc[0] - vel_j[0], vc[1] - vel_j[1], vc[2] - vel_j[2]};
+    unrotate(Rj, et, error + 3);
+    unrotate(Rj, ev, error + 6);
+    if (H == NULL)
+        return;
+
+    // D_xi_state: correctPIM in state i, velocity perturbed in the body frame
+    double X[81];
+    memset(X, 0, sizeof(X));
+    addSkew(X, 0, 0, bR, 1.0);
+    addSkew(X, 1, 0, bv, dt);
+    addSkew(X, 1, 0, bg, dt22);
+    addSkew(X, 1, 0, bP, 1.0);
+    addSkew(X, 2, 0, bg, dt);
+    addSkew(X, 2, 0, bV, 1.0);
+    // Coriolis in the velocity: Ri^T [w]x Ri
+    double W[9] = {0.0, -w[2], w[1], w[2], 0.0, -w[0], -w[1], w[0], 0.0}, WR[9], RWR[9], RiT[9];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            RiT[3 * i + j] = Ri[3 * j + i];
+    mul(W, 3, Ri, 3, WR, 3, 3, 3, 3);
+    mul(RiT, 3, WR, 3, RWR, 3, 3, 3, 3);
+    setBlock(X, 1, 2, RWR, -dt * dt);
+    for (int k = 0; k < 3; k++)
+        X[9 * (3 + k) + 6 + k] += dt;
+    setBlock(X, 2, 2, RWR, -2.0 * dt);
+
+    // retract in state i (P) and in xi (Q = diag(Jr, bRc^T, bRc^T)), then
+    // D_predict_state = P + Q X
+    double bRcT[9];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            bRcT[3 * i + j] = bRc[3 * j + i];
+    double D[81];
+    mul(Jr, 3, X, 9, D, 9, 3, 3, 9);
+    mul(bRcT, 3, X + 27, 9, D + 27, 9, 3, 3, 9);
+    mul(bRcT, 3, X + 54, 9, D + 54, 9, 3, 3, 9);
+    double S[9];
+    for (int b = 0; b < 3; b++)
+    {
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                D[9 * (3 * b + i) + 3 * b + j] += bRcT[3 * i + j];
+    }
+    // -bRc^T [xi_P]x and -bRc^T [xi_V]x in the rotation column
+    for (int b = 1; b < 3; b++)
+    {
+        const double* v = xi + 3 * b;
+        const double V[9] = {0.0, -v[2], v[1], v[2], 0.0, -v[0], -v[1], v[0], 0.0};
+        mul(bRcT, 3, V, 3, S, 3, 3, 3, 3);
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                D[9 * (3 * b + i) + j] -= S[3 * i + j];
+    }
+
+    // D_error_predict = diag(Jr^-1(error), dR, dR), applied to the state i and bias derivatives
+    double Ei[81];
+    mul(JrInv, 3, D, 9, Ei, 9, 3, 3, 9);
+    mul(dR, 3, D + 27, 9, Ei + 27, 9, 3, 3, 9);
+    mul(dR, 3, D + 54, 9, Ei + 54, 9, 3, 3, 9);
+    // pose i, and velocity i in the navigation frame: times Ri^T
+    for (int r = 0; r < 9; r++)
+    {
+        for (int c = 0; c < 6; c++)
+            H[0][6 * r + c] = Ei[9 * r + c];
+        mul(Ei + 9 * r + 6, 9, RiT, 3, H[1] + 3 * r, 3, 1, 3, 3);
+    }
+
+    // state j: [-Jr^-1 dR^T 0 0; [et]x -I 0; [ev]x 0 -I], velocity times Rj^T
+    double JdRT[9];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            JdRT[3 * i + j] = -(JrInv[3 * i] * dR[3 * j] + JrInv[3 * i + 1] * dR[3 * j + 1]
+                                + JrInv[3 * i + 2] * dR[3 * j + 2]);
+    double* H3 = H[2];
+    double* H4 = H[3];
+    memset(H3, 0, sizeof(double) * 54);
+    memset(H4, 0, sizeof(double) * 27);
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            H3[6 * i + j] = JdRT[3 * i + j];
+            H4[3 * (6 + i) + j] = -Rj[3 * j + i];
+        }
+        H3[6 * (3 + i) + 3 + i] = -1.0;
+    }
+    const double* e = error;
+    for (int b = 1; b < 3; b++)
+    {
+        const double* v = e + 3 * b;
+        double* B = H3 + 6 * 3 * b;
+        B[1] -= v[2];
+        B[2] += v[1];
+        B[6] += v[2];
+        B[8] -= v[0];
+        B[12] -= v[1];
+        B[13] += v[0];
+    }
+
+    // bias: D_error_predict Q [H_biasAcc H_biasOmega]
+    double Hb[54], QHb[54];
+    for (int r = 0; r < 9; r++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            Hb[6 * r + c] = state.H_biasAcc[3 * r + c];
+            Hb[6 * r + 3 + c] = state.H_biasOmega[3 * r + c];
+        }
+    }
+    mul(Jr, 3, Hb, 6, QHb, 6, 3, 3, 6);
+    mul(bRcT, 3, Hb + 18, 6, QHb + 18, 6, 3, 3, 6);
+    mul(bRcT, 3, Hb + 36, 6, QHb + 36, 6, 3, 3, 6);
+    mul(JrInv, 3, QHb, 6, H[4], 6, 3, 3, 6);
+    mul(dR, 3, QHb + 18, 6, H[4] + 18, 6, 3, 3, 6);
+    mul(dR, 3, QHb + 36, 6, H[4] + 36, 6, 3, 3, 6);
+}
+
+#endif
+
+};
@@ -0,0 +1,136 @@
+#ifndef PREINTEGRATIONSTATE_H
+#define PREINTEGRATIONSTATE_H
+
+/**
+ * @file    PreintegrationState.h
+ * @brief   IMU preintegration in fixed-size structures
+ */
+
+#include "../navigation/ImuFactor.h"
+#include <memory>
+
+namespace minisam
+{
+
+#ifdef TANGENT_PREINTEGRATION
+
+/**
+ * The PreintegrationParams in fixed-size members, row-major. They do not
+ * change during preintegration, so one instance is shared, read-only, by the
+ * preintegrations and factors built with the same parameters.
+ */
+struct ImuParams
+{
+    double gyroscopeCovariance[9];
+    double accelerometerCovariance[9];
+    double integrationCovariance[9];
+    double omegaCoriolis[3];
+    double n_gravity[3];
+    double biasAccCovariance[9];    ///< bias random walk, only for CombinedPreintegrationState
+    double biasOmegaCovariance[9];  ///< bias random walk, only for CombinedPreintegrationState
+};
+
+/// ImuParams with the values of \c p and no bias random walk
+std::shared_ptr<const ImuParams> ImuParams_Make(const PreintegrationParams& p);
+
+/// ImuParams with the values of \c p and the 3x3 continuous-time covariances of the bias random walk
+std::shared_ptr<const ImuParams> ImuParams_Make(const PreintegrationParams& p, const minimatrix& biasAccCovariance,
+        const minimatrix& biasOmegaCovariance);
+
+/**
+ * The state of a TangentPreintegration and of the covariance of
+ * PreintegratedImuMeasurements as a plain struct of fixed-size arrays, read
+ * in place instead of through block copies of the 35x3 and 62x3 storage.
+ * The members read by every evaluation of the factor, the preintegrated
+ * vector, deltaTij and the bias estimate, fill the first two cache lines.
+ * Matrices are row-major.
+ */
+struct PreintegrationState
+{
+    double preintegrated[9];    ///< theta, position, velocity
+    double deltaTij;
+    double biasHatAcc[3];
+    double biasHatOmega[3];
+    double H_biasAcc[27];       ///< 9x3, derivative of preintegrated in the accelerometer bias
+    double H_biasOmega[27];     ///< 9x3, derivative of preintegrated in the gyroscope bias
+    double preintMeasCov[81];   ///< 9x9
+};
+
+/**
+ * A PreintegrationState with the covariance of the preintegrated vector and
+ * the biases, for CombinedImuFactor. nav.preintMeasCov is the top-left 9x9
+ * block of preintMeasCov.
+ */
+struct CombinedPreintegrationState
+{
+    PreintegrationState nav;
+    double preintMeasCov[225];  ///< 15x15: theta, position, velocity, accelerometer bias, gyroscope bias
+};
+
+/// Start a preintegration at the bias estimate (biasAcc, biasOmega), either may be NULL for zero
+void PreintegrationState_Reset(PreintegrationState* state, const double* biasAcc, const double* biasOmega);
+void CombinedPreintegrationState_Reset(CombinedPreintegrationState* state, const double* biasAcc,
+                                       const double* biasOmega);
+
+/// The state of \c pim; its parameters are read by ImuParams_Make(pim)
+void PreintegrationState_FromMeasurements(const PreintegratedImuMeasurements& pim, PreintegrationState* state);
+std::shared_ptr<const ImuParams> ImuParams_Make(const PreintegratedImuMeasurements& pim);
+
+/// Write \c state into \c pim, which keeps its own parameters
+void PreintegrationState_ToMeasurements(const PreintegrationState& state, PreintegratedImuMeasurements* pim);
+
+/**
+ * The preintegrated vector corrected to first order for the bias
+ * (biasAcc, biasOmega): preintegrated + H_biasAcc dba + H_biasOmega dbw,
+ * the biasCorrectedDelta of TangentPreintegration.
+ */
+void PreintegrationState_BiasCorrectedDelta(const PreintegrationState& state, const double* biasAcc,
+        const double* biasOmega, double* zeta);
+
+/**
+ * mergeWith of PreintegratedImuMeasurements: \c state01 becomes the
+ * preintegration of its measurements followed by those of \c state12,
+ * composed with TangentPreintegration::Compose after correcting \c state12
+ * to the bias estimate of \c state01. The bias Jacobians and the covariance
+ * are carried through the Jacobians of the composition.
+ */
+void PreintegrationState_Merge(PreintegrationState* state01, const PreintegrationState& state12);
+
+/**
+ * computeErrorAndJacobians of TangentPreintegration on raw arrays: the 9D
+ * error between the state j and the state i predicted by the preintegration,
+ * with the bias (biasAcc, biasOmega), and its Jacobians.
+ * - pose_i, pose_j: double[12] in the Pose3 storage (rotation rows, then translation)
+ * - vel_i, vel_j: double[3] navigation-frame velocities
+ * - error: double[9]
+ * - H: NULL, or five row-major blocks 9x6, 9x3, 9x6, 9x3, 9x6 in the order
+ *   pose_i, vel_i, pose_j, vel_j, bias
+ * The Coriolis terms of position and velocity are rotated into the body
+ * frame of i like in NavState::correctPIM, where the library's
+ * NavState::coriolis adds them in the navigation frame; with omegaCoriolis
+ * zero the error is that of computeErrorAndJacobians.
+ */
+void PreintegrationState_ComputeError(const PreintegrationState& state, const ImuParams& params,
+                                      const double* pose_i, const double* vel_i,
+                                      const double* pose_j, const double* vel_j,
+                                      const double* biasAcc, const double* biasOmega,
+                                      double* error, double* const* H);
+
+/**
+ * PreintegrationState_ComputeError from \c zeta, the bias-corrected delta
+ * of PreintegrationState_BiasCorrectedDelta, e.g. kept from an earlier
+ * evaluation at the same bias. expTheta and JrTheta, Expmap(zeta[0:3]) and
+ * its right Jacobian, are used in place of their computation when given and
+ * omegaCoriolis is zero; JrTheta is needed only with H.
+ */
+void PreintegrationState_ComputeErrorFromDelta(const PreintegrationState& state, const ImuParams& params,
+        const double* zeta, const double* expTheta, const double* JrTheta,
+        const double* pose_i, const double* vel_i,
+        const double* pose_j, const double* vel_j,
+        double* error, double* const* H);
+
+#endif
+
+};
+
+#endif // PREINTEGRATIONSTATE_H
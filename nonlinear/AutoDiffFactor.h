@@ -0,0 +1,200 @@
+#ifndef AUTODIFFFACTOR_H
+#define AUTODIFFFACTOR_H
+
+/**
+ * @file    AutoDiffFactor.h
+ * @brief   NoiseModelFactor with Jacobians from forward-mode automatic differentiation
+ */
+
+#include "../nonlinear/FixedNoiseModelFactor.h"
+#include "../mat/Dual.h"
+
+namespace minisam
+{
+
+/// Largest number of stored elements of a value passed to an AutoDiffFactor (Pose3 has 12)
+#define AUTODIFF_MAX_ELEMENTS 16
+
+/**
+ * Lift \c value to Dual numbers seeded with the tangent directions
+ * offset..offset+dimension-1: out is the stored layout of retract(value, d)
+ * to first order in d at d = 0, which is all the derivative needs.
+ * - vectors (and calibrations, size == dimension): value + d
+ * - Rot2 (c, s): rotation by d
+ * - Pose2 (c, s, x, y): value * exp([vx, vy, w])
+ * - Rot3 (row-major R): R * (I + [w]x)
+ * - Pose3 (R rows, t): R * (I + [w]x), t + R * v for d = [w, v]
+ * Other values have no first-order retraction here and throw.
+ */
+template<int N>
+void AutoDiff_seed(const minimatrix& value, int offset, Dual<N>* out)
+{
+    const size_t size = value.size1 * value.size2;
+    if (size > AUTODIFF_MAX_ELEMENTS)
+    {
+        throw std::invalid_argument("AutoDiffFactor: value has too many elements");
+    }
+    for (size_t k = 0; k < size; k++)
+    {
+        out[k] = Dual<N>(value.data[(k / value.size2) * value.prd + k % value.size2]);
+    }
+    if (value.dimension == size)
+    {
+        for (size_t k = 0; k < size; k++)
+            out[k].v[offset + k] = 1.0;
+    }
+    else if (value.size1 == 2 && value.size2 == 1 && value.dimension == 1)
+    {
+        const double c = out[0].a, s = out[1].a;
+        out[0].v[offset] = -s;
+        out[1].v[offset] = c;
+    }
+    else if (value.size1 == 4 && value.size2 == 1 && value.dimension == 3)
+    {
+        const double c = out[0].a, s = out[1].a;
+        out[0].v[offset + 2] = -s;
+        out[1].v[offset + 2] = c;
+        out[2].v[offset] = c;
+        out[2].v[offset + 1] = -s;
+        out[3].v[offset] = s;
+        out[3].v[offset + 1] = c;
+    }
+    else if ((value.size1 == 3 || value.size1 == 4) && value.size2 == 3
+             && value.dimension == 3 * (value.size1 - 2))
+    {
+        // R [w]x: column j of [w]x is e_j x w, so d R(i,j) / d w_k = (R(i,:) x e_j)_k
+        for (int i = 0; i < 3; i++)
+        {
+            const double r0 = out[3 * i].a, r1 = out[3 * i + 1].a, r2 = out[3 * i + 2].a;
+            double* d0 = out[3 * i].v + offset;
+            double* d1 = out[3 * i + 1].v + offset;
+            double* d2 = out[3 * i + 2].v + offset;
+            d0[1] = -r2;
+            d0[2] = r1;
+            d1[0] = r2;
+            d1[2] = -r0;
+            d2[0] = -r1;
+            d2[1] = r0;
+        }
+        if (value.size1 == 4)
+        {
+            // t + R v
+            for (int i = 0; i < 3; i++)
+            {
+                for (int k = 0; k < 3; k++)
+                    out[9 + i].v[offset + 3 + k] = out[3 * i + k].a;
+            }
+        }
+    }
+    else
+    {
+        throw std::invalid_argument("AutoDiffFactor: no tangent parametrization for this value");
+    }
+}
+
+/**
+ * A FixedNoiseModelFactor whose Jacobians come from automatic
+ * differentiation of \c Functor, which only computes the error:
+ *
+ *   struct RangeError
+ *   {
+ *       double measured;
+ *       // x[0]: Pose2 (c, s, x, y), x[1]: Point2, e[0]: h(x) - z
+ *       template<typename T> void operator()(const T* const* x, T* e) const
+ *       {
+ *           T dx = x[1][0] - x[0][2], dy = x[1][1] - x[0][3];
+ *           e[0] = sqrt(dx * dx + dy * dy) - measured;
+ *       }
+ *   };
+ *   graph.push_back(new AutoDiffFactor<RangeError, 1, 3, 2>(model, keys, RangeError{4.0}));
+ *
+ * The functor sees every value in its stored layout (see AutoDiff_seed) and
+ * is called with T = double for the error alone, and once with
+ * T = Dual<TotalDim> for the error and every Jacobian together. The
+ * derivatives are taken with respect to the tangent space of each value, the
+ * Jacobians hand-written factors return, so AutoDiffFactors mix with them in
+ * one graph. All storage is on the stack, linearization and whitening are
+ * those of FixedNoiseModelFactor.
+ */
+template<class Functor, int Dim, int... VarDims>
+class AutoDiffFactor : public FixedNoiseModelFactor<Dim, VarDims...>
+{
+public:
+    typedef FixedNoiseModelFactor<Dim, VarDims...> Base;
+    typedef Dual<Base::TotalDim> Scalar;
+
+    AutoDiffFactor(GaussianNoiseModel* noiseModel, const std::vector<int>& keys, const Functor& functor = Functor())
+        : Base(noiseModel, keys), functor_(functor)
+    {
+    }
+
+    virtual ~AutoDiffFactor() {}
+
+    virtual NoiseModelFactor* clone() const
+    {
+        return new AutoDiffFactor(this->noiseModel_, this->keys_, functor_);
+    }
+
+    const Functor& functor() const
+    {
+        return functor_;
+    }
+
+    virtual void evaluateFixed(const minimatrix* const* x, double* e, double* const* H) const
+    {
+        static const int dims[Base::N] = {VarDims...};
+        if (H == NULL)
+        {
+            double values[Base::N][AUTODIFF_MAX_ELEMENTS];
+            const double* args[Base::N];
+            for (int i = 0; i < Base::N; i++)
+            {
+                const minimatrix& xi = *x[i];
+                if (xi.size1 * xi.size2 > AUTODIFF_MAX_ELEMENTS)
+                {
+                    throw std::invalid_argument("AutoDiffFactor: value has too many elements");
+                }
+                for (size_t k = 0; k < xi.size1 * xi.size2; k++)
+                {
+                    values[i][k] = xi.data[(k / xi.size2) * xi.prd + k % xi.size2];
+                }
+                args[i] = values[i];
+            }
+            functor_(args, e);
+            return;
+        }
+
+        Scalar values[Base::N][AUTODIFF_MAX_ELEMENTS];
+        const Scalar* args[Base::N];
+        int offsets[Base::N];
+        int offset = 0;
+        for (int i = 0; i < Base::N; i++)
+        {
+            AutoDiff_seed(*x[i], offset, values[i]);
+            args[i] = values[i];
+            offsets[i] = offset;
+            offset += dims[i];
+        }
+        Scalar error[Dim];
+        functor_(args, error);
+
+        for (int r = 0; r < Dim; r++)
+        {
+            e[r] = error[r].a;
+            for (int i = 0; i < Base::N; i++)
+            {
+                for (int c = 0; c < dims[i]; c++)
+                {
+                    H[i][r * dims[i] + c] = error[r].v[offsets[i] + c];
+                }
+            }
+        }
+    }
+
+private:
+    Functor functor_;
+};
+
+};
+
+#endif // AUTODIFFFACTOR_H
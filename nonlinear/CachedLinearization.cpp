@@ -0,0 +1,257 @@
+/**
+ * @file    CachedLinearization.cpp
+ * @brief   Relinearize only the factors whose variables moved
+ */
+
+#include "CachedLinearization.h"
+#include "NonlinearOptimizerState.h"
+#include "ValuesRetract.h"
+#include "../linear/mEstimator.h"
+#include "../mat/MatCal.h"
+#include "../slam/PriorFactor.h"
+#include <math.h>
+#include <typeinfo>
+
+namespace minisam
+{
+
+CachedLinearization::CachedLinearization(const NonlinearFactorGraph& graph, double relinearizeThreshold)
+    : graph_(graph), threshold_(relinearizeThreshold), relinearized_(0), residualUpdates_(0)
+{
+    if (relinearizeThreshold < 0.0)
+    {
+        throw std::invalid_argument("CachedLinearization: relinearize threshold is negative");
+    }
+    factors_.resize(graph.size());
+    for (int i = 0; i < graph.size(); i++)
+    {
+        FactorCache& cache = factors_[i];
+        cache.workspace = NULL;
+        cache.constrained = NULL;
+        cache.mode = CACHE_NONE;
+        cache.constantJacobian = false;
+        cache.valid = false;
+
+        const NoiseModelFactor* factor = graph.at(i);
+        if (factor == NULL)
+            continue;
+        const GaussianNoiseModel* model = factor->noiseModel();
+        // the elimination takes the noise model of a constrained JacobianFactor, never copy one
+        if (model != NULL && model->isConstrained())
+            continue;
+        cache.workspace = new LinearizationWorkspace();
+        if (dynamic_cast<const RobustNoiseModel*>(model) != NULL)
+        {
+            cache.mode = CACHE_UNCHANGED;
+        }
+        else
+        {
+            cache.mode = CACHE_JACOBIAN;
+            cache.constantJacobian = typeid(*factor) == typeid(PriorFactor);
+        }
+        for (size_t k = 0; k < factor->keys().size(); k++)
+        {
+            keys_[factor->keys()[k]].state = KEY_DIRTY;
+        }
+    }
+}
+
+CachedLinearization::~CachedLinearization()
+{
+    for (size_t i = 0; i < factors_.size(); i++)
+    {
+        delete factors_[i].workspace;
+        delete factors_[i].constrained;
+    }
+}
+
+void CachedLinearization::invalidate()
+{
+    for (size_t i = 0; i < factors_.size(); i++)
+    {
+        factors_[i].valid = false;
+    }
+    for (std::unordered_map<int, KeyCache>::iterator key = keys_.begin(); key != keys_.end(); ++key)
+    {
+        key->second.value.clear();
+    }
+}
+
+/// compare every value with its snapshot, the largest element change sets the state
+void CachedLinearization::updateKeys(const std::map<int, minimatrix*>& x)
+{
+    for (std::unordered_map<int, KeyCache>::iterator key = keys_.begin(); key != keys_.end(); ++key)
+    {
+        KeyCache& cache = key->second;
+        std::map<int, minimatrix*>::const_iterator xi = x.find(key->first);
+        if (xi == x.end())
+        {
+            throw std::invalid_argument("CachedLinearization: value is missing for a key of the graph");
+        }
+        const minimatrix& value = *xi->second;
+        if (cache.value.size() != value.size1 * value.size2)
+        {
+            cache.state = KEY_DIRTY;
+            continue;
+        }
+        double change = 0.0;
+        const double* snapshot = cache.value.data();
+        for (size_t i = 0; i < value.size1; i++)
+        {
+            for (size_t j = 0; j < value.size2; j++)
+            {
+                change = std::max(change, fabs(value.data[i * value.prd + j] - *snapshot++));
+            }
+        }
+        if (change > threshold_)
+            cache.state = KEY_DIRTY;
+        else if (change > 0.0)
+            cache.state = KEY_MOVED;
+        else
+            cache.state = KEY_UNCHANGED;
+    }
+}
+
+/// keep the whitened Jacobian, write b = -R*e(x) into the last column
+void CachedLinearization::updateResidual(const NoiseModelFactor& factor, const std::map<int, minimatrix*>& x,
+                                         JacobianFactor* jf) const
+{
+    minivector b = factor.unwhitenedError(x);
+    minimatrix_scale(&b, -1.0);
+    const GaussianNoiseModel* model = factor.noiseModel();
+    if (model != NULL && !model->isUnit())
+    {
+        GaussianNoiseModel_WhitenInPlace(*model, &b);
+    }
+    minimatrix& Ab = jf->Ab_.matrix_;
+    const size_t col = Ab.size2 - 1;
+    for (size_t r = 0; r < b.size1; r++)
+    {
+        Ab.data[r * Ab.prd + col] = b.data[r * b.prd];
+    }
+}
+
+int CachedLinearization::linearize(const std::map<int, minimatrix*>& x, GaussianFactorGraph& lng)
+{
+    return linearizeInto(x, lng, true);
+}
+
+int CachedLinearization::linearizeShared(const std::map<int, minimatrix*>& x, GaussianFactorGraph& lng)
+{
+    return linearizeInto(x, lng, false);
+}
+
+int CachedLinearization::linearizeInto(const std::map<int, minimatrix*>& x, GaussianFactorGraph& lng, bool copy)
+{
+    updateKeys(x);
+    relinearized_ = 0;
+    residualUpdates_ = 0;
+    lng.reserve(lng.size() + factors_.size());
+    for (size_t i = 0; i < factors_.size(); i++)
+    {
+        const NoiseModelFactor* factor = graph_.at(i);
+        if (factor == NULL)
+            continue;
+        FactorCache& cache = factors_[i];
+        if (cache.workspace == NULL)
+        {
+            delete cache.constrained;
+            cache.constrained = factor->linearize(x);
+            lng.push_back(cache.constrained);
+            // a new linearization, the caller of a copy takes it over
+            if (copy)
+                cache.constrained = NULL;
+            relinearized_++;
+            continue;
+        }
+
+        bool dirty = !cache.valid, moved = false;
+        const std::vector<int>& keys = factor->keys();
+        for (size_t k = 0; k < keys.size(); k++)
+        {
+            const int state = keys_[keys[k]].state;
+            dirty = dirty || state == KEY_DIRTY;
+            moved = moved || state != KEY_UNCHANGED;
+        }
+        if (cache.valid && cache.mode == CACHE_JACOBIAN && cache.constantJacobian)
+            dirty = false;
+        if (cache.mode == CACHE_UNCHANGED && moved)
+            dirty = true;
+
+        if (dirty)
+        {
+            cache.workspace->linearize(*factor, x);
+            cache.valid = true;
+            relinearized_++;
+        }
+        else if (moved)
+        {
+            updateResidual(*factor, x, cache.workspace->jacobian());
+            residualUpdates_++;
+        }
+        if (copy)
+            lng.push_back(new JacobianFactor(*cache.workspace->jacobian()));
+        else
+            lng.push_back(cache.workspace->jacobian());
+    }
+
+    // a dirty value has now been relinearized by all of its factors
+    for (std::unordered_map<int, KeyCache>::iterator key = keys_.begin(); key != keys_.end(); ++key)
+    {
+        KeyCache& cache = key->second;
+        if (cache.state != KEY_DIRTY)
+            continue;
+        const minimatrix& value = *x.find(key->first)->second;
+        cache.value.resize(value.size1 * value.size2);
+        double* snapshot = cache.value.data();
+        for (size_t i = 0; i < value.size1; i++)
+        {
+            for (size_t j = 0; j < value.size2; j++)
+            {
+                *snapshot++ = value.data[i * value.prd + j];
+            }
+        }
+        cache.state = KEY_UNCHANGED;
+    }
+    return MINI_SUCCESS;
+}
+
+CachedGaussNewtonOptimizer::CachedGaussNewtonOptimizer(const NonlinearFactorGraph& graph,
+        const std::map<int, minimatrix*>& initialValues,
+        const GaussNewtonParams& params,
+        double relinearizeThreshold)
+    : GaussNewtonOptimizer(graph, initialValues, params), cache_(graph_, relinearizeThreshold)
+{
+    // iterate() retracts in place, never into the caller's values
+    state_->values = ValuesCopyForRetractInPlace(initialValues);
+}
+
+GaussianFactorGraph CachedGaussNewtonOptimizer::iterate()
+{
+    GaussianFactorGraph linear;
+    cache_.linearizeShared(state_->values, linear);
+    std::map<int, minivector> delta = solve(linear, params_);
+    // Gauss-Newton always takes the step, the values of the state are updated in place
+    ValuesRetractInPlace(state_->values, delta, 0);
+    state_->error = graph_.error(state_->values);
+    state_->iterations++;
+    // the factors of linear belong to cache_, the caller may clear what is returned
+    return GaussianFactorGraph();
+}
+
+CachedLevenbergMarquardtOptimizer::CachedLevenbergMarquardtOptimizer(const NonlinearFactorGraph& graph,
+        const std::map<int, minimatrix*>& initialValues,
+        const LevenbergMarquardtParams& params,
+        double relinearizeThreshold)
+    : LevenbergMarquardtOptimizer(graph, initialValues, params), cache_(graph_, relinearizeThreshold)
+{
+}
+
+GaussianFactorGraph CachedLevenbergMarquardtOptimizer::linearize() const
+{
+    GaussianFactorGraph linear;
+    cache_.linearize(state_->values, linear);
+    return linear;
+}
+
+};
@@ -0,0 +1,184 @@
+#ifndef CACHEDLINEARIZATION_H
+#define CACHEDLINEARIZATION_H
+
+/**
+ * @file    CachedLinearization.h
+ * @brief   Relinearize only the factors whose variables moved
+ */
+
+#include "../nonlinear/LinearizationWorkspace.h"
+#include "../nonlinear/NonlinearFactorGraph.h"
+#include "../nonlinear/GaussNewtonOptimizer.h"
+#include "../nonlinear/LevenbergMarquardtOptimizer.h"
+#include "../linear/GaussianFactorGraph.h"
+#include <unordered_map>
+
+namespace minisam
+{
+
+/**
+ * Batch optimizers relinearize every factor of the graph in every iteration,
+ * even when most variables have converged. CachedLinearization keeps the
+ * linearization of each factor and the values of its variables at that point.
+ * A variable is dirty when some element of its value moved by more than the
+ * threshold since its factors were last linearized. Each call then:
+ * - relinearizes the factors that touch a dirty variable,
+ * - reuses the whitened Jacobian of the other factors, re-evaluating only
+ *   their residual when one of their variables moved at all,
+ * - reuses the cached factor as-is when none of its variables moved.
+ * PriorFactor Jacobians do not depend on the value, so priors only ever
+ * update their residual.
+ *
+ * A threshold of 0 relinearizes every factor whose variables changed, which
+ * gives the same result as NonlinearFactorGraph::linearize. Robust factors
+ * relinearize on any change, since their weights depend on the residual.
+ * Constrained factors are linearized on every call.
+ *
+ * Like NonlinearFactorGraph::linearize, linearize appends new factors that
+ * belong to the caller. linearizeShared appends the cached factors
+ * themselves, so that unchanged factors are handed out again without a copy:
+ * they are valid until the next call or the destruction of the cache, and
+ * must not be deleted, e.g. by clearmemory() or clearall() of the graph.
+ */
+class CachedLinearization
+{
+public:
+    CachedLinearization(const NonlinearFactorGraph& graph, double relinearizeThreshold = 0.0);
+    ~CachedLinearization();
+
+    /// Linearize every factor of the graph at \c x, appended to \c lng in graph order as new factors
+    int linearize(const std::map<int, minimatrix*>& x, GaussianFactorGraph& lng);
+
+    /// As linearize, but the appended factors are the cache's own and must not be deleted
+    int linearizeShared(const std::map<int, minimatrix*>& x, GaussianFactorGraph& lng);
+
+    /// Largest element change of a value that keeps its factors' Jacobians
+    double relinearizeThreshold() const
+    {
+        return threshold_;
+    }
+    void setRelinearizeThreshold(double threshold)
+    {
+        threshold_ = threshold;
+    }
+
+    /// Drop every cached linearization
+    void invalidate();
+
+    /// Factors relinearized by the last call
+    size_t relinearized() const
+    {
+        return relinearized_;
+    }
+
+    /// Factors whose cached Jacobian was kept with a new residual by the last call
+    size_t residualUpdates() const
+    {
+        return residualUpdates_;
+    }
+
+private:
+    CachedLinearization(const CachedLinearization&);
+    CachedLinearization& operator=(const CachedLinearization&);
+
+    enum KeyState { KEY_UNCHANGED, KEY_MOVED, KEY_DIRTY };
+
+    /// value of a variable at its last linearization
+    struct KeyCache
+    {
+        std::vector<double> value;
+        int state;
+    };
+
+    /// what a cached factor may reuse: its Jacobian, only an unchanged result, nothing
+    enum FactorMode { CACHE_JACOBIAN, CACHE_UNCHANGED, CACHE_NONE };
+
+    struct FactorCache
+    {
+        LinearizationWorkspace* workspace;
+        RealGaussianFactor* constrained;   ///< last linearization of a constrained factor
+        int mode;
+        bool constantJacobian;   ///< the Jacobian does not depend on the values (priors)
+        bool valid;
+    };
+
+    int linearizeInto(const std::map<int, minimatrix*>& x, GaussianFactorGraph& lng, bool copy);
+    void updateKeys(const std::map<int, minimatrix*>& x);
+    void updateResidual(const NoiseModelFactor& factor, const std::map<int, minimatrix*>& x, JacobianFactor* jf) const;
+
+    const NonlinearFactorGraph& graph_;
+    double threshold_;
+    std::unordered_map<int, KeyCache> keys_;
+    std::vector<FactorCache> factors_;
+    size_t relinearized_;
+    size_t residualUpdates_;
+};
+
+/**
+ * Gauss-Newton with a CachedLinearization in place of the full
+ * relinearization of the graph in each iteration. The values are copied
+ * by ValuesCopyForRetractInPlace at construction and then retracted in
+ * place by each iteration, so \c initialValues are never changed; the
+ * copies belong to the caller, like the new values of each iteration of the
+ * other optimizers. The constructor throws if a value has a type without
+ * in-place retraction.
+ *
+ * Rot2 and Rot3 variables are retracted by composing with the step, see
+ * Value_RetractInPlace, where the Retract used by GaussNewtonOptimizer
+ * replaces them by the chart of the step alone. On graphs with Rot2 or Rot3
+ * variables the iterates, and so the result, differ from those of
+ * GaussNewtonOptimizer; on the other types they are the same.
+ *
+ * The linear system of an iteration is the cache's, see
+ * CachedLinearization::linearizeShared, so iterate() returns an empty
+ * GaussianFactorGraph, which defaultOptimize may clear.
+ */
+class CachedGaussNewtonOptimizer : public GaussNewtonOptimizer
+{
+public:
+    CachedGaussNewtonOptimizer(const NonlinearFactorGraph& graph,
+                               const std::map<int, minimatrix*>& initialValues,
+                               const GaussNewtonParams& params = GaussNewtonParams(),
+                               double relinearizeThreshold = 0.0);
+    virtual ~CachedGaussNewtonOptimizer() {}
+
+    GaussianFactorGraph iterate() override;
+
+    CachedLinearization& cache()
+    {
+        return cache_;
+    }
+
+private:
+    CachedLinearization cache_;
+};
+
+/**
+ * Levenberg-Marquardt with a CachedLinearization in place of the full
+ * relinearization of the graph in each iteration. LevenbergMarquardtOptimizer
+ * deletes the factors returned by linearize(), which are therefore copies of
+ * the cached ones, see CachedLinearization::linearize.
+ */
+class CachedLevenbergMarquardtOptimizer : public LevenbergMarquardtOptimizer
+{
+public:
+    CachedLevenbergMarquardtOptimizer(const NonlinearFactorGraph& graph,
+                                      const std::map<int, minimatrix*>& initialValues,
+                                      const LevenbergMarquardtParams& params = LevenbergMarquardtParams(),
+                                      double relinearizeThreshold = 0.0);
+    virtual ~CachedLevenbergMarquardtOptimizer() {}
+
+    GaussianFactorGraph linearize() const override;
+
+    CachedLinearization& cache()
+    {
+        return cache_;
+    }
+
+private:
+    mutable CachedLinearization cache_;
+};
+
+};
+
+#endif // CACHEDLINEARIZATION_H
@@ -0,0 +1,201 @@
+#ifndef FACTORPOOL_H
+#define FACTORPOOL_H
+
+/**
+ * @file    FactorPool.h
+ * @brief   Contiguous storage of factors by concrete type
+ */
+
+#include "../nonlinear/NonlinearFactorGraph.h"
+#include <cstddef>
+#include <new>
+#include <typeindex>
+#include <typeinfo>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace minisam
+{
+
+/// Factors per chunk of a FactorPool
+#define FACTORPOOL_CHUNK 1024
+
+/// The type-independent side of a FactorPool
+class FactorPoolBase
+{
+public:
+    virtual ~FactorPoolBase() {}
+    virtual size_t size() const = 0;
+    /// push every factor of the pool to \c graph, in pool order
+    virtual void appendTo(NonlinearFactorGraph& graph) const = 0;
+};
+
+/**
+ * Factors of one concrete type T constructed in place in chunks of
+ * FACTORPOOL_CHUNK, instead of one heap block each. Neighbouring factors are
+ * neighbours in memory, and a factor never moves, so its address is the
+ * handle stored in a NonlinearFactorGraph. The pool owns and destroys its
+ * factors, so the pool must outlive the graphs holding them, and
+ * clearmemory() or clearall(), which delete every factor of a graph, must
+ * never be called on such a graph: its factors were not allocated by new.
+ */
+template<class T>
+class FactorPool : public FactorPoolBase
+{
+    static_assert(std::is_base_of<NoiseModelFactor, T>::value, "FactorPool holds NoiseModelFactors");
+    static_assert(alignof(T) <= alignof(std::max_align_t), "FactorPool chunks are not aligned for this factor");
+
+public:
+    FactorPool() : size_(0) {}
+
+    virtual ~FactorPool()
+    {
+        for (size_t i = 0; i < size_; i++)
+        {
+            at(i)->~T();
+        }
+        for (size_t c = 0; c < chunks_.size(); c++)
+        {
+            ::operator delete(chunks_[c]);
+        }
+    }
+
+    /// Construct a factor in the pool
+    template<class... Args>
+    T* emplace(Args&&... args)
+    {
+        if (size_ == chunks_.size() * FACTORPOOL_CHUNK)
+        {
+            chunks_.push_back(static_cast<T*>(::operator new(sizeof(T) * FACTORPOOL_CHUNK)));
+        }
+        T* factor = chunks_[size_ / FACTORPOOL_CHUNK] + size_ % FACTORPOOL_CHUNK;
+        new (factor) T(std::forward<Args>(args)...);
+        size_++;
+        return factor;
+    }
+
+    T* at(size_t i) const
+    {
+        return chunks_[i / FACTORPOOL_CHUNK] + i % FACTORPOOL_CHUNK;
+    }
+
+    virtual size_t size() const
+    {
+        return size_;
+    }
+
+    virtual void appendTo(NonlinearFactorGraph& graph) const
+    {
+        graph.reserve(graph.size() + size_);
+        for (size_t i = 0; i < size_; i++)
+        {
+            graph.push_back(at(i));
+        }
+    }
+
+private:
+    FactorPool(const FactorPool&);
+    FactorPool& operator=(const FactorPool&);
+
+    std::vector<T*> chunks_;
+    size_t size_;
+};
+
+/**
+ * One FactorPool per concrete factor type. Build a graph with
+ *
+ *   FactorPools pools;
+ *   pools.add<BetweenFactor>(graph, key1, key2, measured, model);
+ *
+ * in place of graph.push_back(new BetweenFactor(...)). graph() returns the
+ * factors pool by pool, so loops over it (error, linearize) run through each
+ * type's factors contiguously and keep calling the same virtual functions.
+ * Factor order does not change the linear system, only its factor order.
+ *
+ * Keys and measurements stay the members of each factor class, on the heap
+ * as before; only the factor objects themselves are pooled. What is saved is
+ * memory, not time: a pooled BetweenFactor costs no allocation and 80 bytes
+ * of heap with its keys instead of 96, while error and linearize times are
+ * dominated by the allocations inside each evaluation and do not change.
+ * Graphs built with add() hold pooled factors, see FactorPool for what they
+ * must not do.
+ */
+class FactorPools
+{
+public:
+    FactorPools() {}
+
+    ~FactorPools()
+    {
+        for (size_t i = 0; i < pools_.size(); i++)
+        {
+            delete pools_[i];
+        }
+    }
+
+    /// The pool of factors of type T, created on first use
+    template<class T>
+    FactorPool<T>& pool()
+    {
+        std::unordered_map<std::type_index, size_t>::const_iterator found = index_.find(typeid(T));
+        if (found != index_.end())
+        {
+            return *static_cast<FactorPool<T>*>(pools_[found->second]);
+        }
+        FactorPool<T>* created = new FactorPool<T>();
+        index_[typeid(T)] = pools_.size();
+        pools_.push_back(created);
+        return *created;
+    }
+
+    /// Construct a factor in its pool
+    template<class T, class... Args>
+    T* emplace(Args&&... args)
+    {
+        return pool<T>().emplace(std::forward<Args>(args)...);
+    }
+
+    /// Construct a factor in its pool and add it to \c graph
+    template<class T, class... Args>
+    T* add(NonlinearFactorGraph& graph, Args&&... args)
+    {
+        T* factor = emplace<T>(std::forward<Args>(args)...);
+        graph.push_back(factor);
+        return factor;
+    }
+
+    /// Number of factors in all pools
+    size_t size() const
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < pools_.size(); i++)
+        {
+            n += pools_[i]->size();
+        }
+        return n;
+    }
+
+    /// Every factor, pool by pool in creation order of the pools
+    NonlinearFactorGraph graph() const
+    {
+        NonlinearFactorGraph graph;
+        graph.reserve(size());
+        for (size_t i = 0; i < pools_.size(); i++)
+        {
+            pools_[i]->appendTo(graph);
+        }
+        return graph;
+    }
+
+private:
+    FactorPools(const FactorPools&);
+    FactorPools& operator=(const FactorPools&);
+
+    std::vector<FactorPoolBase*> pools_;
+    std::unordered_map<std::type_index, size_t> index_;
+};
+
+};
+
+#endif // FACTORPOOL_H
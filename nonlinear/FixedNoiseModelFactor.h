@@ -0,0 +1,261 @@
+#ifndef FIXEDNOISEMODELFACTOR_H
+#define FIXEDNOISEMODELFACTOR_H
+
+/**
+ * @file    FixedNoiseModelFactor.h
+ * @brief   NoiseModelFactor with compile-time error and variable dimensions
+ */
+
+#include "../nonlinear/NonlinearFactor.h"
+#include "../linear/JacobianFactor.h"
+#include <stdexcept>
+
+namespace minisam
+{
+
+/// Sum of a pack of dimensions
+template<int... Dims> struct FixedDimSum;
+template<> struct FixedDimSum<>
+{
+    enum { value = 0 };
+};
+template<int D, int... Dims> struct FixedDimSum<D, Dims...>
+{
+    enum { value = D + FixedDimSum<Dims...>::value };
+};
+
+/**
+ * A NoiseModelFactor whose error dimension \c Dim and variable dimensions
+ * \c VarDims are known at compile time. Derived factors implement
+ * evaluateFixed on raw arrays:
+ *
+ *   class MyBetween : public FixedNoiseModelFactor<6, 6, 6>
+ *   {
+ *       void evaluateFixed(const minimatrix* const* x, double* e, double* const* H) const;
+ *   };
+ *
+ * The error and Jacobians live in stack arrays, and linearize writes the
+ * whitened blocks straight into a JacobianFactor sized once from the template
+ * arguments. Unit, diagonal, isotropic and full Gaussian models are whitened
+ * on the stack. Robust and constrained models go through
+ * NoiseModelFactor::linearize, which calls the unwhitenedError overloads
+ * implemented here. The factor is a NoiseModelFactor, so it is added to a
+ * NonlinearFactorGraph like any other.
+ */
+template<int Dim, int... VarDims>
+class FixedNoiseModelFactor : public NoiseModelFactor
+{
+public:
+    enum { N = sizeof...(VarDims), TotalDim = FixedDimSum<VarDims...>::value };
+    static_assert(Dim > 0 && sizeof...(VarDims) > 0, "FixedNoiseModelFactor needs an error and at least one variable");
+
+    FixedNoiseModelFactor() : NoiseModelFactor() {}
+
+    FixedNoiseModelFactor(GaussianNoiseModel* noiseModel, const std::vector<int>& keys)
+        : NoiseModelFactor(noiseModel, keys)
+    {
+        if (keys.size() != (size_t)N)
+        {
+            throw std::invalid_argument("FixedNoiseModelFactor: wrong number of keys");
+        }
+    }
+
+    virtual ~FixedNoiseModelFactor() {}
+
+    /**
+     * Unwhitened error h(x)-z into e[Dim]. \c x holds the N values in key order.
+     * When \c H is not NULL, H[i] is a row-major Dim x VarDims[i] array for the
+     * Jacobian of variable i.
+     */
+    virtual void evaluateFixed(const minimatrix* const* x, double* e, double* const* H) const = 0;
+
+    virtual int dim() const
+    {
+        return Dim;
+    }
+
+    virtual minivector unwhitenedError(const std::map<int, minimatrix*>& x) const
+    {
+        const minimatrix* values[N];
+        lookup(x, values);
+        minivector error(Dim);
+        evaluateFixed(values, error.data, NULL);
+        return error;
+    }
+
+    virtual minivector unwhitenedError(const std::map<int, minimatrix*>& x, std::vector<minimatrix>& H) const
+    {
+        const minimatrix* values[N];
+        lookup(x, values);
+        double J[Dim * TotalDim];
+        double* blocks[N];
+        jacobianBlocks(J, blocks);
+        minivector error(Dim);
+        evaluateFixed(values, error.data, blocks);
+
+        static const int dims[N] = {VarDims...};
+        for (int i = 0; i < N; i++)
+        {
+            minimatrix& Hi = H[i];
+            if (Hi.size1 != (size_t)Dim || Hi.size2 != (size_t)dims[i])
+            {
+                minimatrix_resize(&Hi, Dim, dims[i]);
+            }
+            for (int r = 0; r < Dim; r++)
+            {
+                for (int c = 0; c < dims[i]; c++)
+                {
+                    Hi.data[r * Hi.prd + c] = blocks[i][r * dims[i] + c];
+                }
+            }
+        }
+        return error;
+    }
+
+    virtual RealGaussianFactor* linearize(const std::map<int, minimatrix*>& x, int factorization = 0) const
+    {
+        if (factorization != 0 || !whitenedOnStack())
+        {
+            return NoiseModelFactor::linearize(x, factorization);
+        }
+        static const int dims[N] = {VarDims...};
+        JacobianFactor* jf = new JacobianFactor(keys_, std::vector<int>(dims, dims + N), Dim);
+        linearizeInto(x, jf);
+        return jf;
+    }
+
+    /**
+     * Linearize into \c jf, a JacobianFactor with the keys, block sizes and
+     * rows of this factor and no noise model, e.g. the result of an earlier
+     * linearize. Only for noise models that are whitened on the stack.
+     */
+    void linearizeInto(const std::map<int, minimatrix*>& x, JacobianFactor* jf) const
+    {
+        if (!whitenedOnStack())
+        {
+            throw std::invalid_argument("FixedNoiseModelFactor::linearizeInto: noise model is robust or constrained");
+        }
+        minimatrix& Ab = jf->Ab_.matrix_;
+        if (Ab.size1 != (size_t)Dim || Ab.size2 != (size_t)TotalDim + 1)
+        {
+            throw std::invalid_argument("FixedNoiseModelFactor::linearizeInto: JacobianFactor has the wrong size");
+        }
+
+        const minimatrix* values[N];
+        lookup(x, values);
+        double J[Dim * TotalDim];
+        double* blocks[N];
+        jacobianBlocks(J, blocks);
+        double e[Dim];
+        evaluateFixed(values, e, blocks);
+
+        // [A | b] with b = -error, then whiten the rows
+        static const int dims[N] = {VarDims...};
+        for (int r = 0; r < Dim; r++)
+        {
+            double* row = Ab.data + r * Ab.prd;
+            int col = 0;
+            for (int i = 0; i < N; i++)
+            {
+                for (int c = 0; c < dims[i]; c++)
+                {
+                    row[col++] = blocks[i][r * dims[i] + c];
+                }
+            }
+            row[TotalDim] = -e[r];
+        }
+        whiten(&Ab);
+    }
+
+private:
+    void lookup(const std::map<int, minimatrix*>& x, const minimatrix** values) const
+    {
+        static const int dims[N] = {VarDims...};
+        for (int i = 0; i < N; i++)
+        {
+            std::map<int, minimatrix*>::const_iterator xi = x.find(keys_[i]);
+            if (xi == x.end())
+            {
+                throw std::invalid_argument("FixedNoiseModelFactor: value is missing for a key of the factor");
+            }
+            if (xi->second->dimension != (size_t)dims[i])
+            {
+                throw std::invalid_argument("FixedNoiseModelFactor: value has the wrong dimension");
+            }
+            values[i] = xi->second;
+        }
+    }
+
+    static void jacobianBlocks(double* J, double** blocks)
+    {
+        static const int dims[N] = {VarDims...};
+        int offset = 0;
+        for (int i = 0; i < N; i++)
+        {
+            blocks[i] = J + Dim * offset;
+            offset += dims[i];
+        }
+    }
+
+    /// unit, diagonal, isotropic and full Gaussian models
+    bool whitenedOnStack() const
+    {
+        const GaussianNoiseModel* model = noiseModel_;
+        if (model == NULL || model->isUnit())
+            return true;
+        if (model->isConstrained() || model->dim() != Dim)
+            return false;
+        double scales[Dim];
+        if (GaussianNoiseModel_RowScales(*model, scales))
+            return true;
+        return !model->isdiagonal_ && model->sqrt_information_.size1 == (size_t)Dim
+               && model->sqrt_information_.size2 == (size_t)Dim;
+    }
+
+    /// Ab = R * Ab, R diagonal or a full square root information matrix
+    void whiten(minimatrix* Ab) const
+    {
+        const GaussianNoiseModel* model = noiseModel_;
+        if (model == NULL || model->isUnit())
+            return;
+        const size_t cols = Ab->size2;
+        double scales[Dim];
+        if (GaussianNoiseModel_RowScales(*model, scales))
+        {
+            for (int r = 0; r < Dim; r++)
+            {
+                double* row = Ab->data + r * Ab->prd;
+                for (size_t c = 0; c < cols; c++)
+                {
+                    row[c] *= scales[r];
+                }
+            }
+            return;
+        }
+        const minimatrix& R = model->sqrt_information_;
+        double W[Dim * (TotalDim + 1)];
+        for (int r = 0; r < Dim; r++)
+        {
+            for (size_t c = 0; c < cols; c++)
+            {
+                double s = 0.0;
+                for (int k = 0; k < Dim; k++)
+                {
+                    s += R.data[r * R.prd + k] * Ab->data[k * Ab->prd + c];
+                }
+                W[r * cols + c] = s;
+            }
+        }
+        for (int r = 0; r < Dim; r++)
+        {
+            for (size_t c = 0; c < cols; c++)
+            {
+                Ab->data[r * Ab->prd + c] = W[r * cols + c];
+            }
+        }
+    }
+};
+
+};
+
+#endif // FIXEDNOISEMODELFACTOR_H
@@ -0,0 +1,112 @@
+/**
+ * @file    LinearizationWorkspace.cpp
+ * @brief   Reusable storage for relinearizing one NoiseModelFactor
+ */
+
+#include "LinearizationWorkspace.h"
+#include "../linear/mEstimator.h"
+
+namespace minisam
+{
+
+LinearizationWorkspace::LinearizationWorkspace():jacobian_(NULL)
+{
+}
+
+LinearizationWorkspace::~LinearizationWorkspace()
+{
+    delete jacobian_;
+}
+
+/// the kept JacobianFactor has the keys, block sizes and row count of this linearization
+bool LinearizationWorkspace::matches(const NoiseModelFactor& factor, size_t rows) const
+{
+    if (jacobian_ == NULL || jacobian_->keys() != factor.keys() || jacobian_->model_ != NULL)
+        return false;
+    const GaussianBlockMatrix& Ab = jacobian_->Ab_;
+    if (Ab.rowStart_ != 0 || Ab.rowEnd_ != (int)rows || Ab.matrix_.size1 != rows)
+        return false;
+    std::vector<int>::const_iterator key = jacobian_->keys().begin();
+    for (size_t i = 0; i < H_.size(); i++, key++)
+    {
+        if (H_[i].size1 != rows || jacobian_->getDim(key) != (int)H_[i].size2)
+            return false;
+    }
+    return true;
+}
+
+JacobianFactor* LinearizationWorkspace::linearize(const NoiseModelFactor& factor, const std::map<int, minimatrix*>& x)
+{
+    const GaussianNoiseModel* model = factor.noiseModel();
+    if (model != NULL && model->isConstrained())
+    {
+        delete jacobian_;
+        RealGaussianFactor* gf = factor.linearize(x);
+        jacobian_ = dynamic_cast<JacobianFactor*>(gf);
+        if (jacobian_ == NULL)
+        {
+            jacobian_ = new JacobianFactor(*gf);
+            delete gf;
+        }
+        return jacobian_;
+    }
+
+    // size the Jacobian blocks once, evaluateError fills them in place from then on;
+    // they are not views of [A|b], since evaluateError indexes its blocks with their
+    // own width as row stride and reallocates blocks that are not of its size
+    const std::vector<int>& keys = factor.keys();
+    if (H_.size() != keys.size())
+    {
+        H_.clear();
+        H_.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            std::map<int, minimatrix*>::const_iterator xi = x.find(keys[i]);
+            if (xi == x.end())
+            {
+                throw std::invalid_argument("LinearizationWorkspace: value is missing for a key of the factor");
+            }
+            H_.emplace_back(factor.dim(), xi->second->dimension);
+        }
+    }
+
+    minivector b = factor.unwhitenedError(x, H_);
+    minimatrix_scale(&b, -1.0);
+
+    // robust models reweight with the residual, so they whiten the blocks first
+    const RobustNoiseModel* robust = dynamic_cast<const RobustNoiseModel*>(model);
+    if (robust != NULL)
+    {
+        robust->WhitenReweight(H_, b);
+    }
+
+    if (!matches(factor, b.size1))
+    {
+        delete jacobian_;
+        jacobian_ = new JacobianFactor(keys, H_, b, NULL);
+    }
+    else
+    {
+        minimatrix& Ab = jacobian_->Ab_.matrix_;
+        size_t col = 0;
+        for (size_t i = 0; i < H_.size(); i++)
+        {
+            minimatrix Ai = minimatrix_blockmatrix_var(&Ab, 0, col, H_[i].size1, H_[i].size2);
+            minimatrix_memcpy(&Ai, H_[i]);
+            col += H_[i].size2;
+        }
+        for (size_t r = 0; r < b.size1; r++)
+        {
+            Ab.data[r * Ab.prd + col] = b.data[r * b.prd];
+        }
+    }
+
+    // [A|b] is whitened in one pass, row scaling applies to b like to A
+    if (model != NULL && robust == NULL && !model->isUnit())
+    {
+        GaussianNoiseModel_WhitenInPlace(*model, &jacobian_->Ab_.matrix_);
+    }
+    return jacobian_;
+}
+
+};
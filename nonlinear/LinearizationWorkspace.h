@@ -0,0 +1,55 @@
+#ifndef LINEARIZATIONWORKSPACE_H
+#define LINEARIZATIONWORKSPACE_H
+
+/**
+ * @file    LinearizationWorkspace.h
+ * @brief   Reusable storage for relinearizing one NoiseModelFactor
+ */
+
+#include "../nonlinear/NonlinearFactor.h"
+#include "../linear/JacobianFactor.h"
+
+namespace minisam
+{
+
+/**
+ * NoiseModelFactor::linearize allocates the Jacobian blocks, the whitened
+ * system and a new JacobianFactor on every call. A LinearizationWorkspace
+ * keeps the Jacobian blocks and one JacobianFactor for a factor, sized on the
+ * first call: later calls evaluate the Jacobians into the same blocks, copy
+ * them and b into the augmented matrix of the kept JacobianFactor and whiten
+ * it in place. Only the error vector returned by unwhitenedError is still
+ * allocated per call.
+ *
+ * The returned JacobianFactor belongs to the workspace and is overwritten by
+ * the next call, use JacobianFactor's copy constructor to keep a snapshot.
+ * Constrained noise models are passed on to NoiseModelFactor::linearize.
+ */
+class LinearizationWorkspace
+{
+public:
+    LinearizationWorkspace();
+    ~LinearizationWorkspace();
+
+    /// Linearize \c factor at \c x into the workspace
+    JacobianFactor* linearize(const NoiseModelFactor& factor, const std::map<int, minimatrix*>& x);
+
+    /// The result of the last call, NULL before the first one
+    JacobianFactor* jacobian() const
+    {
+        return jacobian_;
+    }
+
+private:
+    LinearizationWorkspace(const LinearizationWorkspace&);
+    LinearizationWorkspace& operator=(const LinearizationWorkspace&);
+
+    bool matches(const NoiseModelFactor& factor, size_t rows) const;
+
+    std::vector<minimatrix> H_;   ///< Jacobian blocks, reused by unwhitenedError
+    JacobianFactor* jacobian_;    ///< [A|b] of the last linearization
+};
+
+};
+
+#endif // LINEARIZATIONWORKSPACE_H
@@ -61,6 +61,17 @@ public:
 
     /** unnormalized error, \f$ 0.5 \sum_i (h_i(X_i)-z)^2/\sigma^2 \f$ in the most common case */
     double error(const std::map<int,minimatrix*>& values) const;
+    /**
+     * error(values) for trial steps: each factor contributes its error-only
+     * NoiseModelFactor::error, summed in a fixed order (Kahan within blocks of
+     * factors, pairwise across blocks), so the result does not depend on
+     * \c threads. Returns infinity as soon as a sum of the first blocks, in
+     * block order, exceeds \c bound, the error to beat, since factor errors
+     * are never negative; blocks that finish out of order wait for the ones
+     * before them, so the result does not depend on the timing either.
+     * \c threads <= 0 uses every hardware thread.
+     */
+    double error(const std::map<int,minimatrix*>& values, double bound, int threads = 1) const;
     /// Linearize a nonlinear factor graph
     int linearize(const std::map<int,minimatrix*>& linearizationPoint,GaussianFactorGraph& lng,int factorization=0) const;
 
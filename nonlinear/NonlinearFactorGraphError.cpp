@@ -0,0 +1,135 @@
+/**
+ * @file    NonlinearFactorGraphError.cpp
+ * @brief   Bounded, deterministic and parallel error of a NonlinearFactorGraph
+ */
+
+#include "NonlinearFactorGraph.h"
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace minisam
+{
+
+/// Factors summed sequentially, the blocks are the unit of work and of the pairwise sum.
+#define NONLINEARERROR_BLOCK 64
+
+/// Kahan sum of the errors of factors [begin, end)
+static double blockError(const NonlinearFactorGraph& graph, const std::map<int, minimatrix*>& values,
+                         int begin, int end)
+{
+    double sum = 0.0, compensation = 0.0;
+    for (int i = begin; i < end; i++)
+    {
+        const NoiseModelFactor* factor = graph.at(i);
+        if (factor == NULL)
+            continue;
+        const double y = factor->error(values) - compensation;
+        const double t = sum + y;
+        compensation = (t - sum) - y;
+        sum = t;
+    }
+    return sum;
+}
+
+/// pairwise sum of s[begin, end)
+static double pairwiseSum(const double* s, size_t begin, size_t end)
+{
+    if (end - begin == 1)
+        return s[begin];
+    const size_t middle = begin + (end - begin) / 2;
+    return pairwiseSum(s, begin, middle) + pairwiseSum(s, middle, end);
+}
+
+double NonlinearFactorGraph::error(const std::map<int, minimatrix*>& values, double bound, int threads) const
+{
+    const int n = size();
+    const int blocks = (n + NONLINEARERROR_BLOCK - 1) / NONLINEARERROR_BLOCK;
+    if (blocks == 0)
+        return 0.0;
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, blocks);
+
+    std::vector<double> sums(blocks);
+    std::vector<char> done(blocks, 0);
+    std::atomic<int> next(0);
+    std::atomic<bool> exceeded(false);
+    std::mutex prefixMutex;
+    int prefixEnd = 0;
+    double prefix = 0.0;
+
+    // every block is summed alone and stored in its slot, whichever thread takes it;
+    // the bound is checked on the sums of blocks [0, prefixEnd) added in block
+    // order, so whether it is exceeded does not depend on which blocks finish first
+    auto work = [&]()
+    {
+        for (int b = next++; b < blocks && !exceeded.load(std::memory_order_relaxed); b = next++)
+        {
+            const int begin = b * NONLINEARERROR_BLOCK;
+            sums[b] = blockError(*this, values, begin, std::min(n, begin + NONLINEARERROR_BLOCK));
+            std::lock_guard<std::mutex> lock(prefixMutex);
+            done[b] = 1;
+            for (; prefixEnd < blocks && done[prefixEnd]; prefixEnd++)
+            {
+                prefix += sums[prefixEnd];
+                if (prefix > bound)
+                    exceeded = true;
+            }
+        }
+    };
+
+    if (threads == 1)
+    {
+        work();
+    }
+    else
+    {
+        std::vector<std::exception_ptr> errors(threads);
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for (int t = 1; t < threads; t++)
+        {
+            pool.emplace_back([&, t]()
+            {
+                try
+                {
+                    work();
+                }
+                catch (...)
+                {
+                    errors[t] = std::current_exception();
+                    exceeded = true;
+                }
+            });
+        }
+        try
+        {
+            work();
+        }
+        catch (...)
+        {
+            errors[0] = std::current_exception();
+            exceeded = true;
+        }
+        for (size_t t = 0; t < pool.size(); t++)
+        {
+            pool[t].join();
+        }
+        for (int t = 0; t < threads; t++)
+        {
+            if (errors[t])
+                std::rethrow_exception(errors[t]);
+        }
+    }
+
+    if (exceeded)
+        return std::numeric_limits<double>::infinity();
+    const double sum = pairwiseSum(sums.data(), 0, sums.size());
+    return sum > bound ? std::numeric_limits<double>::infinity() : sum;
+}
+
+};
@@ -0,0 +1,254 @@
+/**
+ * @file    ValuesRetract.cpp
+ * @brief   Retraction of values in their existing storage
+ */
+
+#include "ValuesRetract.h"
+#include "../geometry/Cal3_S2.h"
+#include "../geometry/Pose2.h"
+#include "../geometry/Pose3.h"
+#include "../geometry/Rot2.h"
+#include "../geometry/Rot3.h"
+#include <math.h>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace minisam
+{
+
+/// Variables retracted sequentially, the unit of work of the threads
+#define VALUESRETRACT_BLOCK 1024
+
+static inline double& at(minimatrix* m, size_t i, size_t j)
+{
+    return m->data[i * m->prd + j];
+}
+
+static inline double deltaAt(const minimatrix& d, size_t k)
+{
+    return d.size2 == 1 ? d.data[k * d.prd] : d.data[(k / d.size2) * d.prd + k % d.size2];
+}
+
+/// R = R * C for the top 3x3 block of m
+static void rotateRight(minimatrix* m, const double* C)
+{
+    for (size_t i = 0; i < 3; i++)
+    {
+        const double r0 = at(m, i, 0), r1 = at(m, i, 1), r2 = at(m, i, 2);
+        at(m, i, 0) = r0 * C[0] + r1 * C[3] + r2 * C[6];
+        at(m, i, 1) = r0 * C[1] + r1 * C[4] + r2 * C[7];
+        at(m, i, 2) = r0 * C[2] + r1 * C[5] + r2 * C[8];
+    }
+}
+
+/// The Cayley chart of Rot3, (I - W/2)^-1 (I + W/2) = I + 2 f (X + X^2) with X = W/2
+static void cayley(const double* w, double* C)
+{
+    const double x = 0.5 * w[0], y = 0.5 * w[1], z = 0.5 * w[2];
+    const double f = 2.0 / (1.0 + x * x + y * y + z * z);
+    C[0] = 1.0 - f * (y * y + z * z);
+    C[4] = 1.0 - f * (x * x + z * z);
+    C[8] = 1.0 - f * (x * x + y * y);
+    C[1] = f * (x * y - z);
+    C[3] = f * (x * y + z);
+    C[2] = f * (x * z + y);
+    C[6] = f * (x * z - y);
+    C[5] = f * (y * z - x);
+    C[7] = f * (y * z + x);
+}
+
+/// the dimension of each type, the dimension member is not kept by every copy constructor
+static inline void checkDimension(const minimatrix& delta, size_t dimension)
+{
+    if (delta.size1 * delta.size2 != dimension)
+    {
+        throw std::invalid_argument("Value_RetractInPlace: delta does not have the dimension of the value");
+    }
+}
+
+bool Value_RetractInPlace(minimatrix* value, const minimatrix& delta)
+{
+    const size_t n = delta.size1 * delta.size2;
+    const std::type_info& type = typeid(*value);
+    if (type == typeid(minimatrix) || type == typeid(minivector) || type == typeid(Cal3_S2))
+    {
+        checkDimension(delta, value->size1 * value->size2);
+        for (size_t k = 0; k < n; k++)
+        {
+            at(value, k / value->size2, k % value->size2) += deltaAt(delta, k);
+        }
+    }
+    else if (type == typeid(Rot2))
+    {
+        checkDimension(delta, 1);
+        const double c = at(value, 0, 0), s = at(value, 1, 0);
+        const double dc = cos(deltaAt(delta, 0)), ds = sin(deltaAt(delta, 0));
+        at(value, 0, 0) = c * dc - s * ds;
+        at(value, 1, 0) = s * dc + c * ds;
+    }
+    else if (type == typeid(Pose2))
+    {
+        checkDimension(delta, 3);
+        const double c = at(value, 0, 0), s = at(value, 1, 0);
+        const double vx = deltaAt(delta, 0), vy = deltaAt(delta, 1), w = deltaAt(delta, 2);
+        const double dc = cos(w), ds = sin(w);
+        at(value, 0, 0) = c * dc - s * ds;
+        at(value, 1, 0) = s * dc + c * ds;
+        at(value, 2, 0) += c * vx - s * vy;
+        at(value, 3, 0) += s * vx + c * vy;
+    }
+    else if (type == typeid(Rot3) || type == typeid(Pose3))
+    {
+        checkDimension(delta, type == typeid(Pose3) ? 6 : 3);
+        double w[3], C[9];
+        for (int k = 0; k < 3; k++)
+            w[k] = deltaAt(delta, k);
+        cayley(w, C);
+        if (type == typeid(Pose3))
+        {
+            // t + R v with the rotation before the update
+            const double vx = deltaAt(delta, 3), vy = deltaAt(delta, 4), vz = deltaAt(delta, 5);
+            for (size_t i = 0; i < 3; i++)
+            {
+                at(value, 3, i) += at(value, i, 0) * vx + at(value, i, 1) * vy + at(value, i, 2) * vz;
+            }
+        }
+        rotateRight(value, C);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+template <class T>
+static minimatrix* copyAs(const minimatrix& value)
+{
+    return new T(static_cast<const T&>(value));
+}
+
+std::map<int, minimatrix*> ValuesCopyForRetractInPlace(const std::map<int, minimatrix*>& values)
+{
+    std::map<int, minimatrix*> copy;
+    for (std::map<int, minimatrix*>::const_iterator it = values.begin(); it != values.end(); ++it)
+    {
+        const minimatrix& value = *it->second;
+        const std::type_info& type = typeid(value);
+        minimatrix* c;
+        if (type == typeid(minimatrix))
+            c = copyAs<minimatrix>(value);
+        else if (type == typeid(minivector))
+            c = copyAs<minivector>(value);
+        else if (type == typeid(Cal3_S2))
+            c = copyAs<Cal3_S2>(value);
+        else if (type == typeid(Rot2))
+            c = copyAs<Rot2>(value);
+        else if (type == typeid(Pose2))
+            c = copyAs<Pose2>(value);
+        else if (type == typeid(Rot3))
+            c = copyAs<Rot3>(value);
+        else if (type == typeid(Pose3))
+            c = copyAs<Pose3>(value);
+        else
+        {
+            for (std::map<int, minimatrix*>::iterator done = copy.begin(); done != copy.end(); ++done)
+            {
+                delete done->second;
+            }
+            throw std::invalid_argument("ValuesCopyForRetractInPlace: a value has a type without in-place retraction");
+        }
+        copy.insert(copy.end(), std::make_pair(it->first, c));
+    }
+    return copy;
+}
+
+
+void ValuesRetractInPlace(std::map<int, minimatrix*>& values, const std::map<int, minivector>& delta,
+                          int threads)
+{
+    std::vector<std::pair<minimatrix**, const minivector*> > work;
+    work.reserve(delta.size());
+    for (std::map<int, minivector>::const_iterator d = delta.begin(); d != delta.end(); ++d)
+    {
+        std::map<int, minimatrix*>::iterator value = values.find(d->first);
+        if (value == values.end())
+        {
+            throw std::invalid_argument("ValuesRetractInPlace: delta has a key without a value");
+        }
+        work.push_back(std::make_pair(&value->second, &d->second));
+    }
+
+    const size_t n = work.size();
+    const int blocks = (int)((n + VALUESRETRACT_BLOCK - 1) / VALUESRETRACT_BLOCK);
+    if (blocks == 0)
+        return;
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, blocks);
+
+    std::atomic<int> next(0);
+    std::atomic<bool> failed(false);
+    auto retract = [&]()
+    {
+        for (int b = next++; b < blocks && !failed.load(std::memory_order_relaxed); b = next++)
+        {
+            const size_t end = std::min(n, (size_t)(b + 1) * VALUESRETRACT_BLOCK);
+            for (size_t i = (size_t)b * VALUESRETRACT_BLOCK; i < end; i++)
+            {
+                // the map does not own its values, a replaced one is left to its owner like in ValuesRetract
+                minimatrix*& value = *work[i].first;
+                if (!Value_RetractInPlace(value, *work[i].second))
+                    value = value->Retract(work[i].second);
+            }
+        }
+    };
+
+    if (threads == 1)
+    {
+        retract();
+        return;
+    }
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (int t = 1; t < threads; t++)
+    {
+        pool.emplace_back([&, t]()
+        {
+            try
+            {
+                retract();
+            }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+                failed = true;
+            }
+        });
+    }
+    try
+    {
+        retract();
+    }
+    catch (...)
+    {
+        errors[0] = std::current_exception();
+        failed = true;
+    }
+    for (size_t t = 0; t < pool.size(); t++)
+    {
+        pool[t].join();
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        if (errors[t])
+            std::rethrow_exception(errors[t]);
+    }
+}
+
+};
@@ -0,0 +1,56 @@
+#ifndef VALUESRETRACT_H
+#define VALUESRETRACT_H
+
+/**
+ * @file    ValuesRetract.h
+ * @brief   Retraction of values in their existing storage
+ */
+
+#include "../mat/Matrix.h"
+#include <map>
+
+namespace minisam
+{
+
+/**
+ * value = retract(value, delta), written over the storage of \c value.
+ * Matrices, vectors and calibrations add delta, the Lie groups compose with
+ * the chart of delta, without allocating:
+ * - Rot2: value * Rot2(delta)
+ * - Pose2: value * Pose2(vx, vy, w), the first-order chart of Pose2::Retract
+ * - Rot3: value * Cayley(w), the chart of Rot3
+ * - Pose3: value * Pose3(Cayley(w), v), the chart of Pose3::Retract
+ * This differs from the library for Rot2 and Rot3: Rot2::Retract and
+ * Rot3::Retract return the chart of delta alone, without the current value,
+ * where here they compose like Pose2 and Pose3. The other types match
+ * their Retract. The types above throw if delta does not have their
+ * dimension.
+ * @return false, with \c value unchanged, for any other type
+ */
+bool Value_RetractInPlace(minimatrix* value, const minimatrix& delta);
+
+/**
+ * ValuesRetract without reallocating: each value with an entry in \c delta is
+ * retracted in place by Value_RetractInPlace, so the pointers in \c values and
+ * everything holding them stay valid. A value of a type without in-place
+ * retraction is replaced by the result of its Retract, as ValuesRetract
+ * does, and the old value is left to its owner. Values without a delta are
+ * unchanged. Variables are split over \c threads in blocks of
+ * VALUESRETRACT_BLOCK, \c threads <= 0 uses every hardware thread. Throws
+ * if a key of \c delta has no value.
+ */
+void ValuesRetractInPlace(std::map<int, minimatrix*>& values, const std::map<int, minivector>& delta,
+                          int threads = 1);
+
+/**
+ * A deep copy of \c values, which belongs to the caller, for
+ * ValuesRetractInPlace to retract while \c values stay unchanged. Throws,
+ * without copying anything, if a value has a type that Value_RetractInPlace
+ * does not handle: ValuesRetractInPlace would replace it by a new value the
+ * map could not tell from the copies it owns.
+ */
+std::map<int, minimatrix*> ValuesCopyForRetractInPlace(const std::map<int, minimatrix*>& values);
+
+};
+
+#endif // VALUESRETRACT_H
@@ -0,0 +1,474 @@
+/**
+ * @file    BatchLinearizer.cpp
+ * @brief   Structure-of-arrays linearization of pose graph factors
+ *
+ * The kernels run over all lanes of a batch with the lane index outermost and
+ * every per-pose quantity in locals, so the compiler vectorizes across
+ * factors. Inputs and outputs are distinct minibatch allocations, passed as
+ * restrict pointers with the minibatch stride; the rows of one minibatch never
+ * overlap, which the lane loops declare with ivdep. The small loops over pose
+ * elements are unrolled so that only the lane loop remains. Padding lanes are
+ * computed on zeros and never read back.
+ */
+
+#include "BatchLinearizer.h"
+#include "../gmfconfig.h"
+#include "BetweenFactor.h"
+#include "PriorFactor.h"
+#include <math.h>
+#include <typeinfo>
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define BATCHLINEARIZER_LANES _Pragma("GCC ivdep")
+#define BATCHLINEARIZER_UNROLL _Pragma("GCC unroll 9")
+#else
+#define BATCHLINEARIZER_LANES
+#define BATCHLINEARIZER_UNROLL
+#endif
+
+namespace minisam
+{
+
+/// Cayley chart of a row-major rotation, the Rot3 local coordinates at identity
+static inline void cayleyLocal(const double *A, double *omega)
+{
+    const double a = A[0], b = A[1], c = A[2];
+    const double d = A[3], e = A[4], f = A[5];
+    const double g = A[6], h = A[7], i = A[8];
+    const double di = d * i, ce = c * e, cd = c * d, fg = f * g;
+    const double M = 1 + e - f * h + i + e * i;
+    const double K = -4.0 / (cd * h + M + a * M - g * (c + ce) - b * (d + di - fg));
+    omega[0] = K * (a * f - cd + f);
+    omega[1] = K * (b * f - ce - c);
+    omega[2] = K * (fg - di - d);
+}
+
+/// R = A' * B and t = A' * (u - v) for row-major 3x3 A, B
+static inline void relative3(const double *A, const double *u, const double *B, const double *v,
+                             double *R, double *t)
+{
+    BATCHLINEARIZER_UNROLL
+    for (int i = 0; i < 3; i++)
+    {
+        BATCHLINEARIZER_UNROLL
+        for (int j = 0; j < 3; j++)
+        {
+            R[i * 3 + j] = A[i] * B[j] + A[3 + i] * B[3 + j] + A[6 + i] * B[6 + j];
+        }
+    }
+    const double d0 = v[0] - u[0], d1 = v[1] - u[1], d2 = v[2] - u[2];
+    BATCHLINEARIZER_UNROLL
+    for (int i = 0; i < 3; i++)
+    {
+        t[i] = A[i] * d0 + A[3 + i] * d1 + A[6 + i] * d2;
+    }
+}
+
+/// whitened -error and key1 Jacobian of BetweenFactor on Pose3, the key2 Jacobian is I
+MINISAM_CLONES
+static void betweenPose3(size_t stride, const double *__restrict meas, const double *__restrict p1,
+                         const double *__restrict p2, const double *__restrict scale,
+                         double *__restrict b, double *__restrict H1)
+{
+    BATCHLINEARIZER_LANES
+    for (size_t k = 0; k < stride; k++)
+    {
+        double Rm[9], R1[9], R2[9], tm[3], t1[3], t2[3];
+        BATCHLINEARIZER_UNROLL
+        for (int e = 0; e < 9; e++)
+        {
+            Rm[e] = meas[e * stride + k];
+            R1[e] = p1[e * stride + k];
+            R2[e] = p2[e * stride + k];
+        }
+        BATCHLINEARIZER_UNROLL
+        for (int e = 0; e < 3; e++)
+        {
+            tm[e] = meas[(9 + e) * stride + k];
+            t1[e] = p1[(9 + e) * stride + k];
+            t2[e] = p2[(9 + e) * stride + k];
+        }
+
+        // hx = p1^-1 * p2, error = Local(measured^-1 * hx)
+        double R[9], t[3], Rr[9], tr[3], err[6];
+        relative3(R1, t1, R2, t2, R, t);
+        relative3(Rm, tm, R, t, Rr, tr);
+        cayleyLocal(Rr, err);
+        err[3] = tr[0];
+        err[4] = tr[1];
+        err[5] = tr[2];
+
+        // H1 = -Ad(hx^-1) = -[Ri 0; [ti]x*Ri Ri] with Ri = R', ti = -R'*t
+        double ti[3];
+        BATCHLINEARIZER_UNROLL
+        for (int i = 0; i < 3; i++)
+        {
+            ti[i] = -(R[i] * t[0] + R[3 + i] * t[1] + R[6 + i] * t[2]);
+        }
+        const double S[9] = {0.0, -ti[2], ti[1], ti[2], 0.0, -ti[0], -ti[1], ti[0], 0.0};
+        BATCHLINEARIZER_UNROLL
+        for (int r = 0; r < 3; r++)
+        {
+            const double su = scale[r * stride + k];
+            const double sl = scale[(r + 3) * stride + k];
+            b[r * stride + k] = -err[r] * su;
+            b[(r + 3) * stride + k] = -err[r + 3] * sl;
+            BATCHLINEARIZER_UNROLL
+            for (int c = 0; c < 3; c++)
+            {
+                const double Ri = R[c * 3 + r];
+                const double SRi = S[r * 3] * R[c * 3] + S[r * 3 + 1] * R[c * 3 + 1] + S[r * 3 + 2] * R[c * 3 + 2];
+                H1[(r * 6 + c) * stride + k] = -Ri * su;
+                H1[(r * 6 + 3 + c) * stride + k] = 0.0;
+                H1[((r + 3) * 6 + c) * stride + k] = -SRi * sl;
+                H1[((r + 3) * 6 + 3 + c) * stride + k] = -Ri * sl;
+            }
+        }
+    }
+}
+
+/// whitened -error of PriorFactor on Pose3, its Jacobian is I
+MINISAM_CLONES
+static void priorPose3(size_t stride, const double *__restrict prior, const double *__restrict p1,
+                       const double *__restrict scale, double *__restrict b)
+{
+    BATCHLINEARIZER_LANES
+    for (size_t k = 0; k < stride; k++)
+    {
+        double Rp[9], R1[9], tp[3], t1[3];
+        for (int e = 0; e < 9; e++)
+        {
+            Rp[e] = prior[e * stride + k];
+            R1[e] = p1[e * stride + k];
+        }
+        for (int e = 0; e < 3; e++)
+        {
+            tp[e] = prior[(9 + e) * stride + k];
+            t1[e] = p1[(9 + e) * stride + k];
+        }
+        // error = -Local(x^-1 * prior)
+        double Rr[9], tr[3], err[6];
+        relative3(R1, t1, Rp, tp, Rr, tr);
+        cayleyLocal(Rr, err);
+        err[3] = tr[0];
+        err[4] = tr[1];
+        err[5] = tr[2];
+        for (int r = 0; r < 6; r++)
+        {
+            b[r * stride + k] = err[r] * scale[r * stride + k];
+        }
+    }
+}
+
+/**
+ * Pose2 is stored as (cos, sin, x, y). The kernel leaves the relative
+ * rotation as (cos, sin) in b rows 2 and \c sine, the angle is taken in a
+ * second, scalar pass since atan2 does not vectorize.
+ */
+MINISAM_CLONES
+static void betweenPose2(size_t stride, const double *__restrict meas, const double *__restrict p1,
+                         const double *__restrict p2, const double *__restrict scale,
+                         double *__restrict b, double *__restrict sine, double *__restrict H1)
+{
+    BATCHLINEARIZER_LANES
+    for (size_t k = 0; k < stride; k++)
+    {
+        const double cm = meas[k], sm = meas[stride + k], xm = meas[2 * stride + k], ym = meas[3 * stride + k];
+        const double c1 = p1[k], s1 = p1[stride + k], x1 = p1[2 * stride + k], y1 = p1[3 * stride + k];
+        const double c2 = p2[k], s2 = p2[stride + k], x2 = p2[2 * stride + k], y2 = p2[3 * stride + k];
+
+        // hx = p1^-1 * p2
+        const double c = c1 * c2 + s1 * s2;
+        const double s = c1 * s2 - s1 * c2;
+        const double dx = x2 - x1, dy = y2 - y1;
+        const double tx = c1 * dx + s1 * dy;
+        const double ty = -s1 * dx + c1 * dy;
+
+        // measured^-1 * hx
+        const double cr = cm * c + sm * s;
+        const double sr = cm * s - sm * c;
+        const double rx = tx - xm, ry = ty - ym;
+        const double xr = cm * rx + sm * ry;
+        const double yr = -sm * rx + cm * ry;
+
+        // H1 = -Ad(hx^-1) = [-c, -s, -yi; s, -c, xi; 0, 0, -1]
+        const double xi = -(c * tx + s * ty);
+        const double yi = s * tx - c * ty;
+
+        const double s0 = scale[k], s1w = scale[stride + k], s2w = scale[2 * stride + k];
+        b[k] = -xr * s0;
+        b[stride + k] = -yr * s1w;
+        b[2 * stride + k] = cr;
+        sine[k] = sr;
+
+        H1[k] = -c * s0;
+        H1[stride + k] = -s * s0;
+        H1[2 * stride + k] = -yi * s0;
+        H1[3 * stride + k] = s * s1w;
+        H1[4 * stride + k] = -c * s1w;
+        H1[5 * stride + k] = xi * s1w;
+        H1[6 * stride + k] = 0.0;
+        H1[7 * stride + k] = 0.0;
+        H1[8 * stride + k] = -s2w;
+    }
+}
+
+/// whitened -error of PriorFactor on Pose2, angle as in betweenPose2
+MINISAM_CLONES
+static void priorPose2(size_t stride, const double *__restrict prior, const double *__restrict p1,
+                       const double *__restrict scale, double *__restrict b, double *__restrict sine)
+{
+    BATCHLINEARIZER_LANES
+    for (size_t k = 0; k < stride; k++)
+    {
+        const double cp = prior[k], sp = prior[stride + k], xp = prior[2 * stride + k], yp = prior[3 * stride + k];
+        const double c1 = p1[k], s1 = p1[stride + k], x1 = p1[2 * stride + k], y1 = p1[3 * stride + k];
+
+        // error = -Local(x^-1 * prior)
+        const double dx = xp - x1, dy = yp - y1;
+        b[k] = (c1 * dx + s1 * dy) * scale[k];
+        b[stride + k] = (-s1 * dx + c1 * dy) * scale[stride + k];
+        b[2 * stride + k] = c1 * cp + s1 * sp;
+        sine[k] = c1 * sp - s1 * cp;
+    }
+}
+
+/// b row 2 = sign * atan2(sine, cos) * scale
+static void pose2Angles(size_t count, size_t stride, double sign, const double *scale, double *b, const double *sine)
+{
+    for (size_t k = 0; k < count; k++)
+    {
+        b[2 * stride + k] = sign * atan2(sine[k], b[2 * stride + k]) * scale[2 * stride + k];
+    }
+}
+
+int BatchLinearizer::batchKind(const NoiseModelFactor* factor)
+{
+    const GaussianNoiseModel* model = factor->noiseModel_;
+    double scales[6];
+    const minimatrix* measured = NULL;
+    int kind = -1;
+    if (typeid(*factor) == typeid(BetweenFactor))
+    {
+        measured = static_cast<const BetweenFactor*>(factor)->measured_;
+        if (measured != NULL && dynamic_cast<const Pose2*>(measured) != NULL)
+            kind = BETWEEN_POSE2;
+        else if (measured != NULL && dynamic_cast<const Pose3*>(measured) != NULL)
+            kind = BETWEEN_POSE3;
+    }
+    else if (typeid(*factor) == typeid(PriorFactor))
+    {
+        measured = static_cast<const PriorFactor*>(factor)->prior_;
+        if (measured != NULL && dynamic_cast<const Pose2*>(measured) != NULL)
+            kind = PRIOR_POSE2;
+        else if (measured != NULL && dynamic_cast<const Pose3*>(measured) != NULL)
+            kind = PRIOR_POSE3;
+    }
+    if (kind < 0)
+        return -1;
+    const int dim = (kind == BETWEEN_POSE2 || kind == PRIOR_POSE2) ? 3 : 6;
+    if (model != NULL && (model->dim() != dim || model->isConstrained() || !GaussianNoiseModel_RowScales(*model, scales)))
+        return -1;
+    return kind;
+}
+
+BatchLinearizer::Batch::Batch(BatchKind kind_, const std::vector<int>& factors_, const NonlinearFactorGraph& graph)
+    : kind(kind_), dim((kind_ == BETWEEN_POSE2 || kind_ == PRIOR_POSE2) ? 3 : 6), factors(factors_),
+      measured(4, dim == 3 ? 1 : 3, factors_.size()), scale(dim, 1, factors_.size()),
+      pose1(4, dim == 3 ? 1 : 3, factors_.size()), pose2(4, dim == 3 ? 1 : 3, kind_ <= BETWEEN_POSE3 ? factors_.size() : 0),
+      b(dim, 1, factors_.size()), sine(1, 1, dim == 3 ? factors_.size() : 0),
+      H1(dim, dim, kind_ <= BETWEEN_POSE3 ? factors_.size() : 0)
+{
+    const bool between = kind <= BETWEEN_POSE3;
+    double scales[6];
+    for (size_t k = 0; k < factors.size(); k++)
+    {
+        const NoiseModelFactor* factor = graph.at(factors[k]);
+        const minimatrix* m = between ? static_cast<const BetweenFactor*>(factor)->measured_
+                              : static_cast<const PriorFactor*>(factor)->prior_;
+        minibatch_set(&measured, k, *m);
+
+        const GaussianNoiseModel* model = factor->noiseModel_;
+        if (model == NULL)
+        {
+            for (size_t r = 0; r < dim; r++)
+                scales[r] = 1.0;
+        }
+        else
+        {
+            GaussianNoiseModel_RowScales(*model, scales);
+        }
+        for (size_t r = 0; r < dim; r++)
+        {
+            scale.element(r, 0)[k] = scales[r];
+        }
+
+        // the key2 block stays the whitened identity, written once
+        key1.push_back(factor->keys()[0]);
+        std::vector<minimatrix> blocks;
+        blocks.emplace_back(dim, dim);
+        minimatrix_set_zero(&blocks.back());
+        if (between)
+        {
+            key2.push_back(factor->keys()[1]);
+            blocks.emplace_back(dim, dim);
+            minimatrix_set_zero(&blocks.back());
+        }
+        minimatrix& identity = blocks.back();
+        for (size_t r = 0; r < dim; r++)
+        {
+            identity.data[r * identity.prd + r] = scales[r];
+        }
+        jacobians.push_back(new JacobianFactor(factor->keys(), blocks, minivector(dim, 0.0), NULL));
+    }
+}
+
+BatchLinearizer::Batch::~Batch()
+{
+    for (size_t k = 0; k < jacobians.size(); k++)
+    {
+        delete jacobians[k];
+    }
+}
+
+static void gather(const std::map<int, minimatrix*>& x, const std::vector<int>& keys, minibatch* poses)
+{
+    for (size_t k = 0; k < keys.size(); k++)
+    {
+        std::map<int, minimatrix*>::const_iterator xi = x.find(keys[k]);
+        if (xi == x.end())
+        {
+            throw std::invalid_argument("BatchLinearizer: value is missing for a key of the graph");
+        }
+        const minimatrix* p = xi->second;
+        if (p->size1 != poses->size1 || p->size2 != poses->size2)
+        {
+            throw std::invalid_argument("BatchLinearizer: value does not match the type of the measurement");
+        }
+        for (size_t i = 0; i < p->size1; i++)
+        {
+            for (size_t j = 0; j < p->size2; j++)
+            {
+                poses->element(i, j)[k] = p->data[i * p->prd + j];
+            }
+        }
+    }
+}
+
+void BatchLinearizer::Batch::evaluate(const std::map<int, minimatrix*>& x)
+{
+    const bool between = kind <= BETWEEN_POSE3;
+    gather(x, key1, &pose1);
+    if (between)
+    {
+        gather(x, key2, &pose2);
+    }
+
+    const size_t stride = b.stride;
+    switch (kind)
+    {
+    case BETWEEN_POSE2:
+        betweenPose2(stride, measured.data, pose1.data, pose2.data, scale.data, b.data, sine.data, H1.data);
+        pose2Angles(b.count, stride, -1.0, scale.data, b.data, sine.data);
+        break;
+    case BETWEEN_POSE3:
+        betweenPose3(stride, measured.data, pose1.data, pose2.data, scale.data, b.data, H1.data);
+        break;
+    case PRIOR_POSE2:
+        priorPose2(stride, measured.data, pose1.data, scale.data, b.data, sine.data);
+        pose2Angles(b.count, stride, 1.0, scale.data, b.data, sine.data);
+        break;
+    case PRIOR_POSE3:
+        priorPose3(stride, measured.data, pose1.data, scale.data, b.data);
+        break;
+    }
+
+    // scatter into [H1 | I | b] or [I | b], the identity block is fixed
+    const size_t bcol = between ? 2 * dim : dim;
+    for (size_t k = 0; k < jacobians.size(); k++)
+    {
+        minimatrix& Ab = jacobians[k]->Ab_.matrix_;
+        for (size_t r = 0; r < dim; r++)
+        {
+            double* row = Ab.data + r * Ab.prd;
+            if (between)
+            {
+                for (size_t c = 0; c < dim; c++)
+                {
+                    row[c] = H1.element(r, c)[k];
+                }
+            }
+            row[bcol] = b.element(r, 0)[k];
+        }
+    }
+}
+
+BatchLinearizer::BatchLinearizer(const NonlinearFactorGraph& graph)
+    : workspaces_(graph.size(), (LinearizationWorkspace*)NULL),
+      ordered_(graph.size(), (JacobianFactor*)NULL), graph_(graph)
+{
+    std::vector<int> members[4];
+    for (int i = 0; i < graph.size(); i++)
+    {
+        const NoiseModelFactor* factor = graph.at(i);
+        const int kind = (factor != NULL) ? batchKind(factor) : -1;
+        if (kind >= 0)
+            members[kind].push_back(i);
+        else if (factor != NULL)
+            workspaces_[i] = new LinearizationWorkspace();
+    }
+    for (int kind = 0; kind < 4; kind++)
+    {
+        if (!members[kind].empty())
+            batches_.push_back(new Batch((BatchKind)kind, members[kind], graph));
+    }
+}
+
+BatchLinearizer::~BatchLinearizer()
+{
+    for (size_t i = 0; i < batches_.size(); i++)
+    {
+        delete batches_[i];
+    }
+    for (size_t i = 0; i < workspaces_.size(); i++)
+    {
+        delete workspaces_[i];
+    }
+}
+
+int BatchLinearizer::linearize(const std::map<int, minimatrix*>& x, GaussianFactorGraph& lng)
+{
+    for (size_t i = 0; i < batches_.size(); i++)
+    {
+        Batch& batch = *batches_[i];
+        batch.evaluate(x);
+        for (size_t k = 0; k < batch.factors.size(); k++)
+        {
+            ordered_[batch.factors[k]] = batch.jacobians[k];
+        }
+    }
+    for (size_t i = 0; i < workspaces_.size(); i++)
+    {
+        if (workspaces_[i] != NULL)
+            ordered_[i] = workspaces_[i]->linearize(*graph_.at(i), x);
+    }
+    lng.reserve(lng.size() + ordered_.size());
+    for (size_t i = 0; i < ordered_.size(); i++)
+    {
+        if (ordered_[i] != NULL)
+            lng.push_back(ordered_[i]);
+    }
+    return MINI_SUCCESS;
+}
+
+size_t BatchLinearizer::batched() const
+{
+    size_t n = 0;
+    for (size_t i = 0; i < batches_.size(); i++)
+    {
+        n += batches_[i]->factors.size();
+    }
+    return n;
+}
+
+};
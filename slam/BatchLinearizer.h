@@ -0,0 +1,90 @@
+#ifndef BATCHLINEARIZER_H
+#define BATCHLINEARIZER_H
+
+/**
+ * @file    BatchLinearizer.h
+ * @brief   Structure-of-arrays linearization of pose graph factors
+ */
+
+#include "../nonlinear/NonlinearFactorGraph.h"
+#include "../nonlinear/LinearizationWorkspace.h"
+#include "../linear/GaussianFactorGraph.h"
+#include "../miniblas/minibatch_double.h"
+
+namespace minisam
+{
+
+/**
+ * Pose graphs are almost entirely BetweenFactor and PriorFactor on Pose2 or
+ * Pose3, linearized one by one through virtual calls and heap Jacobians. A
+ * BatchLinearizer groups these factors by type once. Each linearization
+ * gathers the poses of a group into minibatch structure-of-arrays blocks,
+ * computes the whitened errors and Jacobians of the whole group with
+ * vectorized kernels, and writes them into JacobianFactors kept from the
+ * previous call.
+ *
+ * A factor is batched when it is exactly a BetweenFactor or PriorFactor, its
+ * measurement is a Pose2 or Pose3, and its noise model is unit, diagonal or
+ * isotropic. Every other factor is linearized through its own
+ * LinearizationWorkspace. The result is NonlinearFactorGraph::linearize up to
+ * rounding: errors use the same charts (x, y, theta for Pose2, Cayley
+ * rotation and translation for Pose3) and the Jacobians -Ad(hx^-1) and I.
+ *
+ * The JacobianFactors added to the GaussianFactorGraph belong to the
+ * linearizer and are overwritten by the next call. The graph must not change
+ * while a linearizer built from it is in use.
+ */
+class BatchLinearizer
+{
+public:
+    explicit BatchLinearizer(const NonlinearFactorGraph& graph);
+    ~BatchLinearizer();
+
+    /// Linearize every factor of the graph at \c x, appended to \c lng in graph order
+    int linearize(const std::map<int, minimatrix*>& x, GaussianFactorGraph& lng);
+
+    /// Number of factors evaluated by the batch kernels
+    size_t batched() const;
+
+private:
+    BatchLinearizer(const BatchLinearizer&);
+    BatchLinearizer& operator=(const BatchLinearizer&);
+
+    enum BatchKind { BETWEEN_POSE2, BETWEEN_POSE3, PRIOR_POSE2, PRIOR_POSE3 };
+
+    /// The factors of one kind and their structure-of-arrays storage
+    struct Batch
+    {
+        Batch(BatchKind kind, const std::vector<int>& factors, const NonlinearFactorGraph& graph);
+        ~Batch();
+
+        void evaluate(const std::map<int, minimatrix*>& x);
+
+        BatchKind kind;
+        size_t dim;                       ///< tangent dimension of the pose
+        std::vector<int> factors;         ///< indices in the graph
+        std::vector<int> key1, key2;      ///< key2 is empty for priors
+        minibatch measured;               ///< 4x1 (Pose2) or 4x3 (Pose3) measurements
+        minibatch scale;                  ///< dim x 1 whitening row scales
+        minibatch pose1, pose2;           ///< gathered values
+        minibatch b;                      ///< dim x 1 whitened -error
+        minibatch sine;                   ///< sine of the relative angle (Pose2)
+        minibatch H1;                     ///< dim x dim whitened Jacobian of key1 (between)
+        std::vector<JacobianFactor*> jacobians;
+
+    private:
+        Batch(const Batch&);
+        Batch& operator=(const Batch&);
+    };
+
+    static int batchKind(const NoiseModelFactor* factor);
+
+    std::vector<Batch*> batches_;
+    std::vector<LinearizationWorkspace*> workspaces_;   ///< NULL for batched factors
+    std::vector<JacobianFactor*> ordered_;              ///< results in graph order
+    const NonlinearFactorGraph& graph_;
+};
+
+};
+
+#endif // BATCHLINEARIZER_H
@@ -0,0 +1,67 @@
+#ifndef MINITEST_H
+#define MINITEST_H
+
+/**
+ * @file    minitest.h
+ * @brief   Checks shared by the programs of tests/, each one a ctest case
+ */
+
+#include "miniblas/minimatrix_double.h"
+#include <iostream>
+#include <math.h>
+
+static int minitest_failures = 0;
+
+#define EXPECT(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": EXPECT(" #condition ") failed" << std::endl; \
+            minitest_failures++; \
+        } \
+    } while (0)
+
+#define EXPECT_CLOSE(expected, actual, tol) \
+    do { \
+        const double expected_ = (expected), actual_ = (actual); \
+        if (!(fabs(expected_ - actual_) <= (tol))) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #actual " is " << actual_ \
+                      << ", expected " << expected_ << std::endl; \
+            minitest_failures++; \
+        } \
+    } while (0)
+
+/// exit status of a test program
+#define MINITEST_RESULT() (minitest_failures == 0 ? 0 : 1)
+
+/// largest element difference of two matrices of the same size
+static inline double minitest_maxdiff(const minimatrix& A, const minimatrix& B)
+{
+    if (A.size1 != B.size1 || A.size2 != B.size2)
+        return HUGE_VAL;
+    double d = 0.0;
+    for (size_t i = 0; i < A.size1; i++)
+    {
+        for (size_t j = 0; j < A.size2; j++)
+        {
+            d = fmax(d, fabs(A.data[i * A.prd + j] - B.data[i * B.prd + j]));
+        }
+    }
+    return d;
+}
+
+/// fill with uniform values in [-1, 1) from a fixed seed
+static inline void minitest_fill(minimatrix* A, unsigned int* seed)
+{
+    for (size_t i = 0; i < A->size1; i++)
+    {
+        for (size_t j = 0; j < A->size2; j++)
+        {
+            *seed = *seed * 1664525u + 1013904223u;
+            A->data[i * A->prd + j] = (*seed >> 8) * (2.0 / 16777216.0) - 1.0;
+        }
+    }
+}
+
+#endif // MINITEST_H
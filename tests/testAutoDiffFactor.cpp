@@ -0,0 +1,131 @@
+/**
+ * @file    testAutoDiffFactor.cpp
+ * @brief   AutoDiffFactors against the library PriorFactor and BetweenFactor on Pose2
+ */
+
+#include "tests/minitest.h"
+#include "nonlinear/AutoDiffFactor.h"
+#include "slam/PriorFactor.h"
+#include "slam/BetweenFactor.h"
+#include "geometry/Pose2.h"
+
+using namespace minisam;
+
+/// local coordinates (x, y, theta) of b in the frame of a, both Pose2 stored as (c, s, x, y)
+template<typename T>
+static void localPose2(const T* a, const T* b, T* e)
+{
+    const T dx = b[2] - a[2], dy = b[3] - a[3];
+    e[0] = a[0] * dx + a[1] * dy;
+    e[1] = a[0] * dy - a[1] * dx;
+    e[2] = atan2(a[0] * b[1] - a[1] * b[0], a[0] * b[0] + a[1] * b[1]);
+}
+
+/// x * y of Pose2 stored as (c, s, x, y)
+template<typename T>
+static void composePose2(const T* x, const T* y, T* out)
+{
+    out[0] = x[0] * y[0] - x[1] * y[1];
+    out[1] = x[1] * y[0] + x[0] * y[1];
+    out[2] = x[2] + x[0] * y[2] - x[1] * y[3];
+    out[3] = x[3] + x[1] * y[2] + x[0] * y[3];
+}
+
+/// the error of the library PriorFactor: minus the local coordinates of the prior in the frame of x
+struct Pose2PriorError
+{
+    double prior[4];
+    template<typename T> void operator()(const T* const* x, T* e) const
+    {
+        T p[4];
+        for (int k = 0; k < 4; k++)
+            p[k] = T(prior[k]);
+        localPose2(x[0], p, e);
+        for (int k = 0; k < 3; k++)
+            e[k] = -e[k];
+    }
+};
+
+/// the error of the library BetweenFactor: the local coordinates of x1 in the frame of x0 * measured
+struct Pose2BetweenError
+{
+    double measured[4];
+    template<typename T> void operator()(const T* const* x, T* e) const
+    {
+        T m[4], predicted[4];
+        for (int k = 0; k < 4; k++)
+            m[k] = T(measured[k]);
+        composePose2(x[0], m, predicted);
+        localPose2(predicted, x[1], e);
+    }
+};
+
+static void stored(const Pose2& pose, double* out)
+{
+    for (int k = 0; k < 4; k++)
+        out[k] = pose.data[k * pose.prd];
+}
+
+/**
+ * The errors of both factors at \c x, and their linearizations at \c zero,
+ * where the error vanishes: the library drops the derivative of the local
+ * coordinates, which is the identity only there.
+ */
+static void compare(const NoiseModelFactor& autodiff, const NoiseModelFactor& library,
+                    const std::map<int, minimatrix*>& x, const std::map<int, minimatrix*>& zero)
+{
+    EXPECT_CLOSE(library.error(x), autodiff.error(x), 1e-10);
+    EXPECT_CLOSE(0.0, autodiff.error(zero), 1e-20);
+    RealGaussianFactor* a = autodiff.linearize(zero);
+    RealGaussianFactor* b = library.linearize(zero);
+    EXPECT(a->keys_ == b->keys_);
+    EXPECT_CLOSE(0.0, minitest_maxdiff(a->Ab_.matrix_, b->Ab_.matrix_), 1e-9);
+    delete a;
+    delete b;
+}
+
+int main()
+{
+    minivector sigmas(3);
+    sigmas.data[0] = 0.1;
+    sigmas.data[1] = 0.2;
+    sigmas.data[2] = 0.05;
+    GaussianNoiseModel* model = new GaussianNoiseModel(sigmas);
+
+    Pose2 x0(1.0, -0.5, 0.3), x1(2.2, 0.4, 1.1);
+    Pose2 measured(1.1, 0.7, 0.75);
+    std::map<int, minimatrix*> x;
+    x[0] = &x0;
+    x[1] = &x1;
+    // x1 = x0 * measured and x1 = prior
+    double x0Stored[4], measuredStored[4], x1Stored[4];
+    stored(x0, x0Stored);
+    stored(measured, measuredStored);
+    composePose2(x0Stored, measuredStored, x1Stored);
+    Pose2 z0(x0), z1(x0);
+    for (int k = 0; k < 4; k++)
+        z1.data[k * z1.prd] = x1Stored[k];
+    std::map<int, minimatrix*> zero;
+    zero[0] = &z0;
+    zero[1] = &z1;
+
+    Pose2PriorError priorError;
+    stored(z1, priorError.prior);
+    AutoDiffFactor<Pose2PriorError, 3, 3> autoPrior(model, std::vector<int>(1, 1), priorError);
+    PriorFactor libraryPrior(1, new Pose2(z1), model);
+    compare(autoPrior, libraryPrior, x, zero);
+
+    Pose2BetweenError betweenError;
+    stored(measured, betweenError.measured);
+    std::vector<int> keys(2);
+    keys[0] = 0;
+    keys[1] = 1;
+    AutoDiffFactor<Pose2BetweenError, 3, 3, 3> autoBetween(model, keys, betweenError);
+    BetweenFactor libraryBetween(0, 1, new Pose2(measured), model);
+    compare(autoBetween, libraryBetween, x, zero);
+
+    NoiseModelFactor* copy = autoBetween.clone();
+    compare(*copy, libraryBetween, x, zero);
+    delete copy;
+    return MINITEST_RESULT();
+}
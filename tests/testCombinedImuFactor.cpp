@@ -0,0 +1,166 @@
+/**
+ * @file    testCombinedImuFactor.cpp
+ * @brief   CombinedImuFactor against the library ImuFactor on the same preintegration
+ */
+
+#include "tests/minitest.h"
+#include "gmfconfig.h"
+#include "navigation/CombinedImuFactor.h"
+#include "navigation/ImuPreintegrationBatch.h"
+#include "navigation/ImuFactor.h"
+#include "navigation/ImuBias.h"
+#include "geometry/Pose3.h"
+
+using namespace minisam;
+
+#define MEASUREMENTS 200
+
+/// diagonal 3x3 covariance
+static minimatrix isotropic(double variance)
+{
+    minimatrix cov(3, 3);
+    for (size_t i = 0; i < 3; i++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            cov.data[i * cov.prd + j] = (i == j) ? variance : 0.0;
+        }
+    }
+    return cov;
+}
+
+/// largest difference of the rows [begin, end) of A and B
+static double rows_maxdiff(const minimatrix& A, const minimatrix& B, size_t begin, size_t end)
+{
+    if (A.size2 != B.size2)
+        return HUGE_VAL;
+    double d = 0.0;
+    for (size_t i = begin; i < end; i++)
+    {
+        for (size_t j = 0; j < A.size2; j++)
+        {
+            d = fmax(d, fabs(A.data[i * A.prd + j] - B.data[(i - begin) * B.prd + j]));
+        }
+    }
+    return d;
+}
+
+/**
+ * The first 9 rows of \c combined against \c imu, and the bias rows against
+ * bias_i - bias_j, with the identity and minus the identity as Jacobians
+ */
+static void compare(const CombinedImuFactor& combined, const ImuFactor& imu, const std::map<int, minimatrix*>& x)
+{
+    std::vector<minimatrix> Hc(6), Hl(5);
+    const minivector ec = combined.unwhitenedError(x, Hc);
+    const minivector el = imu.unwhitenedError(x, Hl);
+    EXPECT(ec.size1 == 15);
+    EXPECT_CLOSE(0.0, rows_maxdiff(ec, el, 0, 9), 1e-9);
+    for (int k = 0; k < 5; k++)
+    {
+        EXPECT_CLOSE(0.0, rows_maxdiff(Hc[k], Hl[k], 0, 9), 1e-9);
+    }
+
+    const minimatrix& bias_i = *x.find(4)->second;
+    const minimatrix& bias_j = *x.find(5)->second;
+    double d = 0.0;
+    for (size_t r = 0; r < 6; r++)
+    {
+        // ConstantBias holds the accelerometer and the gyroscope bias in two rows
+        const double difference = bias_i.data[(r / 3) * bias_i.prd + r % 3] - bias_j.data[(r / 3) * bias_j.prd + r % 3];
+        d = fmax(d, fabs(ec.data[(9 + r) * ec.prd] - difference));
+        for (int k = 0; k < 6; k++)
+        {
+            for (size_t c = 0; c < Hc[k].size2; c++)
+            {
+                const double expected = (k == 4 && c == r) ? 1.0 : (k == 5 && c == r) ? -1.0 : 0.0;
+                d = fmax(d, fabs(Hc[k].data[(9 + r) * Hc[k].prd + c] - expected));
+            }
+        }
+    }
+    for (size_t r = 0; r < 9; r++)
+    {
+        for (size_t c = 0; c < 6; c++)
+        {
+            d = fmax(d, fabs(Hc[5].data[r * Hc[5].prd + c]));
+        }
+    }
+    EXPECT(d == 0.0);
+
+    // the whitened system holds the error: 0.5 |b|^2
+    RealGaussianFactor* linear = combined.linearize(x);
+    const minimatrix& Ab = linear->Ab_.matrix_;
+    double sum = 0.0;
+    for (size_t r = 0; r < Ab.size1; r++)
+    {
+        sum += Ab.data[r * Ab.prd + Ab.size2 - 1] * Ab.data[r * Ab.prd + Ab.size2 - 1];
+    }
+    EXPECT_CLOSE(combined.error(x), 0.5 * sum, 1e-9 * combined.error(x));
+    delete linear;
+}
+
+int main()
+{
+    PreintegrationParams params = PreintegrationParams::MakeSharedU(9.81);
+    params.setAccelerometerCovariance(isotropic(1e-3));
+    params.setGyroscopeCovariance(isotropic(1e-4));
+    params.setIntegrationCovariance(isotropic(1e-6));
+    std::shared_ptr<const ImuParams> imuParams = ImuParams_Make(params, isotropic(1e-5), isotropic(1e-7));
+
+    double accs[3 * MEASUREMENTS], omegas[3 * MEASUREMENTS], dts[MEASUREMENTS];
+    for (int k = 0; k < MEASUREMENTS; k++)
+    {
+        const double t = 0.005 * k;
+        accs[3 * k] = 0.2 * sin(t);
+        accs[3 * k + 1] = 0.1;
+        accs[3 * k + 2] = 9.81 + 0.05 * cos(t);
+        omegas[3 * k] = 0.01;
+        omegas[3 * k + 1] = -0.02 * t;
+        omegas[3 * k + 2] = 0.3;
+        dts[k] = 0.005;
+    }
+    const double biasAcc[3] = {0.01, -0.02, 0.03}, biasOmega[3] = {0.001, 0.002, -0.001};
+    CombinedPreintegrationState state;
+    CombinedPreintegrationState_Reset(&state, biasAcc, biasOmega);
+    CombinedPreintegrationState_IntegrateBatch(&state, *imuParams, accs, omegas, dts, MEASUREMENTS);
+
+    // the library factor on the same preintegrated vector, bias Jacobians and 9x9 covariance
+    PreintegratedImuMeasurements pim(params);
+    PreintegrationState_ToMeasurements(state.nav, &pim);
+    ImuFactor imu(0, 1, 2, 3, 4, pim);
+
+    Pose3 pose_i(Rot3::Rz(0.1), minivector(1.0, 2.0, 0.5));
+    Pose3 pose_j(Rot3::Rz(0.4), minivector(1.4, 2.1, 0.45));
+    minivector vel_i(0.5, 0.1, 0.0), vel_j(0.6, 0.2, -0.05);
+    ConstantBias bias_i(minivector(0.02, -0.01, 0.025), minivector(0.002, 0.001, 0.0));
+    ConstantBias bias_j(minivector(0.021, -0.012, 0.024), minivector(0.0021, 0.0009, 0.0001));
+    std::map<int, minimatrix*> x;
+    x[0] = &pose_i;
+    x[1] = &vel_i;
+    x[2] = &pose_j;
+    x[3] = &vel_j;
+    x[4] = &bias_i;
+    x[5] = &bias_j;
+
+    CombinedImuFactor combined(0, 1, 2, 3, 4, 5, state, imuParams);
+    compare(combined, imu, x);
+    // again from the bias cache
+    compare(combined, imu, x);
+    bias_i.data[0] += 1e-3;
+    bias_i.data[bias_i.prd + 2] -= 1e-3;
+    compare(combined, imu, x);
+
+    NoiseModelFactor* copy = combined.clone();
+    compare(*static_cast<CombinedImuFactor*>(copy), imu, x);
+    delete copy;
+
+    // a tolerance keeps the cached bias correction for small bias changes
+    CombinedImuFactor tolerant(0, 1, 2, 3, 4, 5, state, imuParams, 1e-3);
+    const minivector before = tolerant.unwhitenedError(x);
+    bias_i.data[0] += 1e-4;
+    const minivector cached = tolerant.unwhitenedError(x);
+    const minivector exact = combined.unwhitenedError(x);
+    EXPECT_CLOSE(0.0, rows_maxdiff(cached, before, 0, 9), 0.0);
+    EXPECT_CLOSE(0.0, minitest_maxdiff(cached, exact), 1e-3);
+    return MINITEST_RESULT();
+}
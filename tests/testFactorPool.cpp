@@ -0,0 +1,84 @@
+/**
+ * @file    testFactorPool.cpp
+ * @brief   Graphs of pooled factors against the same graphs of heap allocated factors
+ */
+
+#include "tests/minitest.h"
+#include "nonlinear/FactorPool.h"
+#include "slam/PriorFactor.h"
+#include "slam/BetweenFactor.h"
+#include "geometry/Pose2.h"
+
+using namespace minisam;
+
+#define CHAIN 2500
+
+int main()
+{
+    minivector sigmas(3);
+    sigmas.data[0] = 0.1;
+    sigmas.data[1] = 0.1;
+    sigmas.data[2] = 0.05;
+    GaussianNoiseModel* model = new GaussianNoiseModel(sigmas);
+
+    std::map<int, minimatrix*> x;
+    for (int i = 0; i <= CHAIN; i++)
+    {
+        x[i] = new Pose2(1.01 * i, 0.02 * i, 0.003 * i);
+    }
+
+    // a prior every 100 poses between the odometry, so the two types interleave
+    NonlinearFactorGraph heap, pooled;
+    FactorPools pools;
+    for (int i = 0; i < CHAIN; i++)
+    {
+        if (i % 100 == 0)
+        {
+            heap.push_back(new PriorFactor(i, new Pose2(1.0 * i, 0.0, 0.0), model));
+            pools.add<PriorFactor>(pooled, i, new Pose2(1.0 * i, 0.0, 0.0), model);
+        }
+        heap.push_back(new BetweenFactor(i, i + 1, new Pose2(1.0, 0.0, 0.001), model));
+        pools.add<BetweenFactor>(pooled, i, i + 1, new Pose2(1.0, 0.0, 0.001), model);
+    }
+    EXPECT(pools.size() == (size_t)heap.size());
+    EXPECT(pools.pool<PriorFactor>().size() == CHAIN / 100);
+    EXPECT(pools.pool<BetweenFactor>().size() == CHAIN);
+
+    // factors of a type are neighbours in memory, across chunks too
+    FactorPool<BetweenFactor>& between = pools.pool<BetweenFactor>();
+    EXPECT(between.at(1) == between.at(0) + 1);
+    EXPECT(between.at(FACTORPOOL_CHUNK) != NULL && between.at(CHAIN - 1)->keys_[0] == CHAIN - 1);
+
+    // add keeps the order of the graph, so both linearize to the same system
+    EXPECT(pooled.size() == heap.size());
+    EXPECT(pooled.error(x) == heap.error(x));
+    double d = 0.0;
+    for (int i = 0; i < heap.size(); i++)
+    {
+        RealGaussianFactor* a = pooled.at(i)->linearize(x);
+        RealGaussianFactor* b = heap.at(i)->linearize(x);
+        EXPECT(a->keys_ == b->keys_);
+        d = fmax(d, minitest_maxdiff(a->Ab_.matrix_, b->Ab_.matrix_));
+        delete a;
+        delete b;
+    }
+    EXPECT(d == 0.0);
+
+    // graph() lists the factors pool by pool, the priors first
+    NonlinearFactorGraph byType = pools.graph();
+    EXPECT(byType.size() == heap.size());
+    EXPECT(byType.at(0) == pools.pool<PriorFactor>().at(0));
+    EXPECT(byType.at(CHAIN / 100) == between.at(0));
+    EXPECT_CLOSE(heap.error(x), byType.error(x), 1e-9 * heap.error(x));
+
+    for (int i = 0; i < heap.size(); i++)
+    {
+        delete heap.at(i);
+    }
+    for (std::map<int, minimatrix*>::iterator it = x.begin(); it != x.end(); ++it)
+    {
+        delete it->second;
+    }
+    delete model;
+    return MINITEST_RESULT();
+}
@@ -0,0 +1,95 @@
+/**
+ * @file    testFixedImuFactor.cpp
+ * @brief   FixedImuFactor against the library ImuFactor
+ */
+
+#include "tests/minitest.h"
+#include "gmfconfig.h"
+#include "navigation/FixedImuFactor.h"
+#include "navigation/ImuFactor.h"
+#include "navigation/ImuBias.h"
+#include "geometry/Pose3.h"
+
+using namespace minisam;
+
+/// diagonal 3x3 covariance
+static minimatrix isotropic(double variance)
+{
+    minimatrix cov(3, 3);
+    for (size_t i = 0; i < 3; i++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            cov.data[i * cov.prd + j] = (i == j) ? variance : 0.0;
+        }
+    }
+    return cov;
+}
+
+/// the unwhitened errors and Jacobians of both factors at \c x, and their linearizations
+static void compare(const NoiseModelFactor& fixed, const NoiseModelFactor& library,
+                    const std::map<int, minimatrix*>& x)
+{
+    std::vector<minimatrix> Hf(5), Hl(5);
+    const minivector ef = fixed.unwhitenedError(x, Hf);
+    const minivector el = library.unwhitenedError(x, Hl);
+    EXPECT_CLOSE(0.0, minitest_maxdiff(ef, el), 1e-9);
+    for (int i = 0; i < 5; i++)
+    {
+        EXPECT_CLOSE(0.0, minitest_maxdiff(Hf[i], Hl[i]), 1e-9);
+    }
+    EXPECT_CLOSE(library.error(x), fixed.error(x), 1e-7 * library.error(x));
+
+    RealGaussianFactor* a = fixed.linearize(x);
+    RealGaussianFactor* b = library.linearize(x);
+    EXPECT(a->keys_ == b->keys_);
+    EXPECT_CLOSE(0.0, minitest_maxdiff(a->Ab_.matrix_, b->Ab_.matrix_), 1e-6);
+    delete a;
+    delete b;
+}
+
+int main()
+{
+    PreintegrationParams params = PreintegrationParams::MakeSharedU(9.81);
+    params.setAccelerometerCovariance(isotropic(1e-3));
+    params.setGyroscopeCovariance(isotropic(1e-4));
+    params.setIntegrationCovariance(isotropic(1e-6));
+    PreintegratedImuMeasurements pim(params, ConstantBias(minivector(0.01, -0.02, 0.03), minivector(0.001, 0.002, -0.001)));
+    for (int k = 0; k < 200; k++)
+    {
+        const double t = 0.005 * k;
+        pim.integrateMeasurement(minivector(0.2 * sin(t), 0.1, 9.81 + 0.05 * cos(t)),
+                                 minivector(0.01, -0.02 * t, 0.3), 0.005);
+    }
+
+    Pose3 pose_i(Rot3::Rz(0.1), minivector(1.0, 2.0, 0.5));
+    Pose3 pose_j(Rot3::Rz(0.4), minivector(1.4, 2.1, 0.45));
+    minivector vel_i(0.5, 0.1, 0.0), vel_j(0.6, 0.2, -0.05);
+    ConstantBias bias(minivector(0.02, -0.01, 0.025), minivector(0.002, 0.001, 0.0));
+    std::map<int, minimatrix*> x;
+    x[0] = &pose_i;
+    x[1] = &vel_i;
+    x[2] = &pose_j;
+    x[3] = &vel_j;
+    x[4] = &bias;
+
+    ImuFactor library(0, 1, 2, 3, 4, pim);
+    FixedImuFactor fixed(0, 1, 2, 3, 4, pim);
+    compare(fixed, library, x);
+
+    NoiseModelFactor* copy = fixed.clone();
+    compare(*copy, library, x);
+    delete copy;
+
+    // factors on the same preintegration share one pooled noise model
+    NoiseModelPool pool;
+    {
+        FixedImuFactor a(0, 1, 2, 3, 4, pim, &pool);
+        FixedImuFactor b(0, 1, 2, 3, 4, pim, &pool);
+        EXPECT(a.noiseModel_ == b.noiseModel_);
+        EXPECT(pool.size() == 1 && pool.useCount(a.noiseModel_) == 2);
+        compare(a, library, x);
+    }
+    EXPECT(pool.size() == 0);
+    return MINITEST_RESULT();
+}
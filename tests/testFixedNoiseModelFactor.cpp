@@ -0,0 +1,138 @@
+/**
+ * @file    testFixedNoiseModelFactor.cpp
+ * @brief   A FixedNoiseModelFactor against the library BetweenFactor on vectors
+ */
+
+#include "tests/minitest.h"
+#include "nonlinear/FixedNoiseModelFactor.h"
+#include "slam/BetweenFactor.h"
+#include "linear/mEstimator.h"
+
+using namespace minisam;
+
+static unsigned int seed = 36u;
+
+/// x1 - x0 - z on 3-vectors, the error of a BetweenFactor on minivectors
+class VectorBetween : public FixedNoiseModelFactor<3, 3, 3>
+{
+public:
+    VectorBetween(int key0, int key1, const minivector& z, GaussianNoiseModel* model)
+        : FixedNoiseModelFactor<3, 3, 3>(model, keys(key0, key1)), z_(z)
+    {
+    }
+
+    virtual NoiseModelFactor* clone() const
+    {
+        return new VectorBetween(keys_[0], keys_[1], z_, noiseModel_);
+    }
+
+    virtual void evaluateFixed(const minimatrix* const* x, double* e, double* const* H) const
+    {
+        for (int r = 0; r < 3; r++)
+        {
+            e[r] = x[1]->data[r * x[1]->prd] - x[0]->data[r * x[0]->prd] - z_.data[r];
+            if (H == NULL)
+                continue;
+            for (int c = 0; c < 3; c++)
+            {
+                H[0][r * 3 + c] = (r == c) ? -1.0 : 0.0;
+                H[1][r * 3 + c] = (r == c) ? 1.0 : 0.0;
+            }
+        }
+    }
+
+private:
+    minivector z_;
+
+    static std::vector<int> keys(int key0, int key1)
+    {
+        std::vector<int> k(2);
+        k[0] = key0;
+        k[1] = key1;
+        return k;
+    }
+};
+
+/// the linearizations and errors of both factors at \c x
+static void compare(const NoiseModelFactor& fixed, const NoiseModelFactor& library,
+                    const std::map<int, minimatrix*>& x)
+{
+    EXPECT_CLOSE(library.error(x), fixed.error(x), 1e-12);
+    RealGaussianFactor* a = fixed.linearize(x);
+    RealGaussianFactor* b = library.linearize(x);
+    EXPECT(a->keys_ == b->keys_);
+    EXPECT_CLOSE(0.0, minitest_maxdiff(a->Ab_.matrix_, b->Ab_.matrix_), 1e-12);
+    delete a;
+    delete b;
+}
+
+int main()
+{
+    minivector x0(3), x1(3), z(3), sigmas(3);
+    minitest_fill(&x0, &seed);
+    minitest_fill(&x1, &seed);
+    minitest_fill(&z, &seed);
+    for (size_t i = 0; i < 3; i++)
+    {
+        sigmas.data[i] = 0.1 * (i + 1);
+    }
+    minimatrix cov(3, 3);
+    for (size_t i = 0; i < 3; i++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            cov.data[i * cov.prd + j] = (i == j) ? 1.0 : 0.2;
+        }
+    }
+    std::map<int, minimatrix*> x;
+    x[3] = &x0;
+    x[8] = &x1;
+
+    minivector ones(3);
+    for (size_t i = 0; i < 3; i++)
+    {
+        ones.data[i] = 1.0;
+    }
+    // diagonal and full models are whitened on the stack, robust ones by NoiseModelFactor::linearize
+    GaussianNoiseModel* models[4] =
+    {
+        new GaussianNoiseModel(ones),
+        new GaussianNoiseModel(sigmas),
+        GaussianNoiseModel::Covariance(cov),
+        new RobustNoiseModel(Huber_mEstimator::Create(0.5), new GaussianNoiseModel(sigmas))
+    };
+    for (int m = 0; m < 4; m++)
+    {
+        VectorBetween fixed(3, 8, z, models[m]);
+        BetweenFactor library(3, 8, new minivector(z), models[m]);
+        compare(fixed, library, x);
+
+        NoiseModelFactor* copy = fixed.clone();
+        compare(*copy, library, x);
+        delete copy;
+
+        if (m < 3)
+        {
+            RealGaussianFactor* linear = fixed.linearize(x);
+            x0.data[1] += 0.25;
+            fixed.linearizeInto(x, static_cast<JacobianFactor*>(linear));
+            RealGaussianFactor* expected = library.linearize(x);
+            EXPECT_CLOSE(0.0, minitest_maxdiff(linear->Ab_.matrix_, expected->Ab_.matrix_), 1e-12);
+            delete linear;
+            delete expected;
+        }
+    }
+
+    // keys and value dimensions are checked
+    bool threw = false;
+    try
+    {
+        VectorBetween(3, 9, z, models[0]).error(x);
+    }
+    catch (const std::invalid_argument&)
+    {
+        threw = true;
+    }
+    EXPECT(threw);
+    return MINITEST_RESULT();
+}
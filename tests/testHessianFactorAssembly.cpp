@@ -0,0 +1,114 @@
+/**
+ * @file    testHessianFactorAssembly.cpp
+ * @brief   assembleHessian against the products of the stacked Jacobians
+ */
+
+#include "tests/minitest.h"
+#include "linear/HessianFactor.h"
+#include "linear/JacobianFactor.h"
+#include "linear/Scatter.h"
+
+using namespace minisam;
+
+static unsigned int seed = 2024u;
+
+/// upper triangle of the assembled [A b]'[A b] against the one of \c Ab
+static double upper_maxdiff(const HessianFactor& hf, const minimatrix& Ab)
+{
+    const minimatrix& info = hf.Ab_.matrix_;
+    double d = (info.size1 == Ab.size2) ? 0.0 : HUGE_VAL;
+    for (size_t i = 0; i < Ab.size2 && d < HUGE_VAL; i++)
+    {
+        for (size_t j = i; j < Ab.size2; j++)
+        {
+            double e = 0.0;
+            for (size_t r = 0; r < Ab.size1; r++)
+            {
+                e += Ab.data[r * Ab.prd + i] * Ab.data[r * Ab.prd + j];
+            }
+            d = fmax(d, fabs(e - info.data[i * info.prd + j]));
+        }
+    }
+    return d;
+}
+
+static GaussianNoiseModel* unitModel(size_t rows)
+{
+    minivector sigmas(rows);
+    for (size_t i = 0; i < rows; i++)
+    {
+        sigmas.data[i] = 1.0;
+    }
+    return new GaussianNoiseModel(sigmas);
+}
+
+int main()
+{
+    // keys 5 and 7, then a factor repeating key 5: its two blocks act as their sum
+    std::vector<minimatrix> H1, H2;
+    H1.emplace_back(3, 2);
+    H1.emplace_back(3, 3);
+    H2.emplace_back(4, 2);
+    H2.emplace_back(4, 2);
+    H2.emplace_back(4, 3);
+    minivector b1(3), b2(4);
+    for (size_t i = 0; i < H1.size(); i++)
+        minitest_fill(&H1[i], &seed);
+    for (size_t i = 0; i < H2.size(); i++)
+        minitest_fill(&H2[i], &seed);
+    minitest_fill(&b1, &seed);
+    minitest_fill(&b2, &seed);
+
+    std::vector<int> keys1, keys2;
+    keys1.push_back(5);
+    keys1.push_back(7);
+    keys2.push_back(5);
+    keys2.push_back(5);
+    keys2.push_back(7);
+    JacobianFactor f1(keys1, H1, b1, unitModel(3));
+    JacobianFactor f2(keys2, H2, b2, unitModel(4));
+
+    std::vector<int> ordering;
+    ordering.push_back(5);
+    ordering.push_back(7);
+    std::vector<const RealGaussianFactor*> factors;
+    factors.push_back(&f1);
+    factors.push_back(&f2);
+
+    // [A b] of both factors stacked, with the blocks of the repeated key added
+    minimatrix Ab(7, 6);
+    for (size_t r = 0; r < 3; r++)
+    {
+        for (size_t c = 0; c < 2; c++)
+            Ab.data[r * Ab.prd + c] = H1[0].data[r * H1[0].prd + c];
+        for (size_t c = 0; c < 3; c++)
+            Ab.data[r * Ab.prd + 2 + c] = H1[1].data[r * H1[1].prd + c];
+        Ab.data[r * Ab.prd + 5] = b1.data[r * b1.prd];
+    }
+    for (size_t r = 0; r < 4; r++)
+    {
+        double* row = Ab.data + (3 + r) * Ab.prd;
+        for (size_t c = 0; c < 2; c++)
+            row[c] = H2[0].data[r * H2[0].prd + c] + H2[1].data[r * H2[1].prd + c];
+        for (size_t c = 0; c < 3; c++)
+            row[2 + c] = H2[2].data[r * H2[2].prd + c];
+        row[5] = b2.data[r * b2.prd];
+    }
+
+    Scatter scatter(factors, ordering);
+    EXPECT(scatter.size() == 2);
+    SlotMap slots(scatter);
+    HessianFactor joint(scatter);
+    assembleHessian(factors, slots, &joint);
+    EXPECT_CLOSE(0.0, upper_maxdiff(joint, Ab), 1e-12);
+
+    // the same with the repeated key first to reach its diagonal block
+    std::vector<const RealGaussianFactor*> reversed;
+    reversed.push_back(&f2);
+    reversed.push_back(&f1);
+    HessianFactor joint2(scatter);
+    assembleHessian(reversed, slots, &joint2);
+    EXPECT_CLOSE(0.0, upper_maxdiff(joint2, Ab), 1e-12);
+
+    return MINITEST_RESULT();
+}
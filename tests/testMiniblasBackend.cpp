@@ -0,0 +1,194 @@
+/**
+ * @file    testMiniblasBackend.cpp
+ * @brief   Every miniblas backend against the scalar one, and the routing of the library entry points
+ */
+
+#include "tests/minitest.h"
+#include "miniblas/miniblas_backend.h"
+#include <dlfcn.h>
+#include <vector>
+
+static unsigned int seed = 12345u;
+
+/// well conditioned triangular matrix, both triangles filled
+static minimatrix triangular(size_t n)
+{
+    minimatrix A(n, n);
+    minitest_fill(&A, &seed);
+    for (size_t i = 0; i < n; i++)
+    {
+        A.data[i * A.prd + i] += (A.data[i * A.prd + i] < 0.0) ? -4.0 : 4.0;
+    }
+    return A;
+}
+
+/// symmetric positive definite matrix
+static minimatrix spd(size_t n)
+{
+    minimatrix G(n, n), A(n, n);
+    minitest_fill(&G, &seed);
+    miniblas_scalar_backend()->dgemm(blasNoTrans, blasTrans, 1.0, G, G, 0.0, &A);
+    for (size_t i = 0; i < n; i++)
+    {
+        A.data[i * A.prd + i] += n;
+    }
+    return A;
+}
+
+static double triangle_maxdiff(const minimatrix& A, const minimatrix& B, MINIBLAS_UPORLOWER Uplo)
+{
+    double d = 0.0;
+    for (size_t i = 0; i < A.size1; i++)
+    {
+        for (size_t j = 0; j < A.size2; j++)
+        {
+            if ((Uplo == blasLower) ? (j <= i) : (j >= i))
+                d = fmax(d, fabs(A.data[i * A.prd + j] - B.data[i * B.prd + j]));
+        }
+    }
+    return d;
+}
+
+static void check_backend(const miniblas_backend* backend)
+{
+    const miniblas_backend* scalar = miniblas_scalar_backend();
+    const MINIBLAS_TRANS trans[2] = {blasNoTrans, blasTrans};
+    const MINIBLAS_UPORLOWER uplos[2] = {blasUpper, blasLower};
+    const MINIBLAS_UNIT diags[2] = {blasNonUnit, blasUnit};
+    const size_t sizes[5][3] = {{1, 1, 1}, {7, 5, 3}, {16, 16, 16}, {33, 17, 65}, {70, 71, 69}};
+
+    for (int s = 0; s < 5; s++)
+    {
+        const size_t M = sizes[s][0], N = sizes[s][1], K = sizes[s][2];
+        for (int ta = 0; ta < 2; ta++)
+        {
+            for (int tb = 0; tb < 2; tb++)
+            {
+                minimatrix A = ta ? minimatrix(K, M) : minimatrix(M, K);
+                minimatrix B = tb ? minimatrix(N, K) : minimatrix(K, N);
+                minimatrix C(M, N);
+                minitest_fill(&A, &seed);
+                minitest_fill(&B, &seed);
+                minitest_fill(&C, &seed);
+                minimatrix Cs(C);
+                backend->dgemm(trans[ta], trans[tb], 0.7, A, B, 0.3, &C);
+                scalar->dgemm(trans[ta], trans[tb], 0.7, A, B, 0.3, &Cs);
+                EXPECT_CLOSE(0.0, minitest_maxdiff(C, Cs), 1e-12 * K);
+            }
+        }
+
+        for (int u = 0; u < 2; u++)
+        {
+            for (int t = 0; t < 2; t++)
+            {
+                minimatrix A = t ? minimatrix(K, N) : minimatrix(N, K);
+                minimatrix C(N, N);
+                minitest_fill(&A, &seed);
+                minitest_fill(&C, &seed);
+                minimatrix Cs(C);
+                backend->dsyrk(uplos[u], trans[t], 1.1, A, 0.5, &C);
+                scalar->dsyrk(uplos[u], trans[t], 1.1, A, 0.5, &Cs);
+                EXPECT_CLOSE(0.0, triangle_maxdiff(C, Cs, uplos[u]), 1e-12 * K);
+            }
+        }
+
+        for (int u = 0; u < 2; u++)
+        {
+            for (int t = 0; t < 2; t++)
+            {
+                for (int d = 0; d < 2; d++)
+                {
+                    minimatrix A = triangular(M);
+                    minivector x(M);
+                    minitest_fill(&x, &seed);
+                    minivector xs(x);
+                    backend->dtrsv(uplos[u], trans[t], diags[d], A, &x);
+                    scalar->dtrsv(uplos[u], trans[t], diags[d], A, &xs);
+                    EXPECT_CLOSE(0.0, minitest_maxdiff(x, xs), 1e-10);
+
+                    for (int side = 0; side < 2; side++)
+                    {
+                        minimatrix B = side ? minimatrix(N, M) : minimatrix(M, N);
+                        minitest_fill(&B, &seed);
+                        minimatrix Bs(B);
+                        const MINIBLAS_SIDE sd = side ? blasRight : blasLeft;
+                        backend->dtrsm(sd, uplos[u], trans[t], diags[d], 0.9, A, &B);
+                        scalar->dtrsm(sd, uplos[u], trans[t], diags[d], 0.9, A, &Bs);
+                        EXPECT_CLOSE(0.0, minitest_maxdiff(B, Bs), 1e-10);
+                    }
+                }
+            }
+        }
+
+        minimatrix S = spd(M);
+        minimatrix L(S), Ls(S);
+        EXPECT(backend->cholesky(&L) == MINI_SUCCESS);
+        EXPECT(scalar->cholesky(&Ls) == MINI_SUCCESS);
+        EXPECT_CLOSE(0.0, triangle_maxdiff(L, Ls, blasLower), 1e-10);
+
+        const size_t rows = M + N, cols = M;
+        minimatrix Q(rows, cols);
+        minitest_fill(&Q, &seed);
+        minimatrix Qs(Q);
+        minivector tau(cols), taus(cols);
+        EXPECT(backend->qr(&Q, &tau) == MINI_SUCCESS);
+        EXPECT(scalar->qr(&Qs, &taus) == MINI_SUCCESS);
+        EXPECT_CLOSE(0.0, minitest_maxdiff(Q, Qs), 1e-10);
+        EXPECT_CLOSE(0.0, minitest_maxdiff(tau, taus), 1e-10);
+    }
+
+    minimatrix notspd(3, 3);
+    minitest_fill(&notspd, &seed);
+    notspd.data[0] = -1.0;
+    EXPECT(backend->cholesky(&notspd) == MINI_FAILURE);
+}
+
+/// the library resolves the entry points to the definitions of minisam_ext, which call the active backend
+static void check_routing()
+{
+    EXPECT(dlsym(RTLD_DEFAULT, "_Z14miniblas_dgemm14MINIBLAS_TRANSS_dRK10minimatrixS2_dPS0_") == (void*)&miniblas_dgemm);
+    EXPECT(dlsym(RTLD_DEFAULT, "_Z29minilinalg_nr_cholesky_decompP10minimatrixb") == (void*)&minilinalg_nr_cholesky_decomp);
+    EXPECT(dlsym(RTLD_DEFAULT, "_Z26minilinalg_Golub_QR_decompP10minimatrixP10minivector") == (void*)&minilinalg_Golub_QR_decomp);
+
+    const MINIBLAS_BACKEND kinds[4] = {blasBackendScalar, blasBackendAVX2, blasBackendAVX512, blasBackendCBLAS};
+    const MINIBLAS_BACKEND initial = miniblas_get_backend()->kind;
+    for (int k = 0; k < 4; k++)
+    {
+        const miniblas_backend* backend = miniblas_find_backend(kinds[k]);
+        if (backend == NULL)
+            continue;
+        EXPECT(miniblas_set_backend(kinds[k]) == MINI_SUCCESS);
+        minimatrix A(40, 50), B(50, 30), C(40, 30), Cb(40, 30);
+        minitest_fill(&A, &seed);
+        minitest_fill(&B, &seed);
+        miniblas_dgemm(blasNoTrans, blasNoTrans, 1.0, A, B, 0.0, &C);
+        backend->dgemm(blasNoTrans, blasNoTrans, 1.0, A, B, 0.0, &Cb);
+        EXPECT(minitest_maxdiff(C, Cb) == 0.0);
+
+        minimatrix S = spd(40);
+        minimatrix L(S), Lb(S);
+        EXPECT(minilinalg_nr_cholesky_decomp(&L) == MINI_SUCCESS);
+        backend->cholesky(&Lb);
+        EXPECT(triangle_maxdiff(L, Lb, blasLower) == 0.0);
+    }
+    miniblas_set_backend(initial);
+}
+
+int main()
+{
+    EXPECT(miniblas_get_backend() != NULL);
+    EXPECT(miniblas_find_backend(miniblas_best_backend()) != NULL);
+
+    const MINIBLAS_BACKEND kinds[3] = {blasBackendAVX2, blasBackendAVX512, blasBackendCBLAS};
+    for (int k = 0; k < 3; k++)
+    {
+        const miniblas_backend* backend = miniblas_find_backend(kinds[k]);
+        if (backend != NULL)
+        {
+            std::cout << "checking the " << backend->name << " backend" << std::endl;
+            check_backend(backend);
+        }
+    }
+    check_routing();
+    return MINITEST_RESULT();
+}
@@ -0,0 +1,84 @@
+/**
+ * @file    testNoiseModelPool.cpp
+ * @brief   Pooling of equal noise models, including full covariance ones
+ */
+
+#include "tests/minitest.h"
+#include "linear/NoiseModelPool.h"
+#include <stdlib.h>
+#include <string.h>
+
+using namespace minisam;
+
+/// leave garbage in the freed chunks the next models are allocated from, so
+/// members GaussianNoiseModel::Covariance leaves uninitialized differ
+static void dirtyHeap(unsigned char byte)
+{
+    void* chunks[64];
+    for (int k = 0; k < 64; k++)
+    {
+        chunks[k] = malloc(sizeof(GaussianNoiseModel));
+        memset(chunks[k], byte, sizeof(GaussianNoiseModel));
+    }
+    for (int k = 0; k < 64; k++)
+    {
+        free(chunks[k]);
+    }
+}
+
+static void checkCovariance()
+{
+    minimatrix C(9, 9);
+    for (size_t i = 0; i < 9; i++)
+    {
+        for (size_t j = 0; j < 9; j++)
+        {
+            C.data[i * C.prd + j] = (i == j) ? 2.0 : 0.1;
+        }
+    }
+    NoiseModelPool pool;
+    dirtyHeap(0xbc);
+    GaussianNoiseModel* a = pool.intern(GaussianNoiseModel::Covariance(C));
+    dirtyHeap(0x29);
+    GaussianNoiseModel* b = pool.intern(GaussianNoiseModel::Covariance(C));
+    EXPECT(a == b);
+    EXPECT(pool.useCount(a) == 2);
+    EXPECT(pool.size() == 1);
+
+    C.data[1] = C.data[C.prd] = 0.2;
+    GaussianNoiseModel* c = pool.intern(GaussianNoiseModel::Covariance(C));
+    EXPECT(c != a);
+    EXPECT(pool.size() == 2);
+}
+
+static void checkDiagonalAndConstrained()
+{
+    minivector sigmas(3), zeros(3), mu(3);
+    for (size_t i = 0; i < 3; i++)
+    {
+        sigmas.data[i] = 1.0 + i;
+        zeros.data[i] = 0.0;
+        mu.data[i] = 1000.0;
+    }
+    NoiseModelPool pool;
+    GaussianNoiseModel* a = pool.intern(GaussianNoiseModel::Variances(sigmas));
+    GaussianNoiseModel* b = pool.intern(GaussianNoiseModel::Variances(sigmas));
+    EXPECT(a == b);
+
+    GaussianNoiseModel* c = pool.intern(ConstrainedNoiseModel::MixedSigmas(mu, zeros));
+    GaussianNoiseModel* d = pool.intern(ConstrainedNoiseModel::MixedSigmas(mu, zeros));
+    EXPECT(c == d);
+    EXPECT(c != a);
+
+    mu.data[0] = 10.0;
+    GaussianNoiseModel* e = pool.intern(ConstrainedNoiseModel::MixedSigmas(mu, zeros));
+    EXPECT(e != c);
+    EXPECT(pool.size() == 3);
+}
+
+int main()
+{
+    checkCovariance();
+    checkDiagonalAndConstrained();
+    return MINITEST_RESULT();
+}